@@ -0,0 +1,178 @@
+#include "alloc_tracking.h"
+#include "logging.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <malloc.h>
+#include <new>
+
+namespace {
+
+constexpr size_t kBuckets = static_cast<size_t>(ProfileRegion::Count) + 1;
+
+std::atomic<bool> tracking{false};
+
+struct BucketTotals {
+    std::atomic<uint64_t> calls{0};
+    std::atomic<uint64_t> allocations{0};
+    std::atomic<uint64_t> deallocations{0};
+    std::atomic<uint64_t> bytes_allocated{0};
+    std::atomic<uint64_t> bytes_freed{0};
+};
+
+BucketTotals buckets[kBuckets];
+
+// Тривиальная thread_local переменная: обращение к ней не выделяет память
+thread_local ProfileRegion current_region = ProfileRegion::Count;
+
+void noteAllocation(void* ptr) {
+    if (ptr == nullptr || !tracking.load(std::memory_order_relaxed)) {
+        return;
+    }
+    BucketTotals& b = buckets[static_cast<size_t>(current_region)];
+    b.allocations.fetch_add(1, std::memory_order_relaxed);
+    b.bytes_allocated.fetch_add(malloc_usable_size(ptr), std::memory_order_relaxed);
+}
+
+void noteDeallocation(void* ptr) {
+    if (ptr == nullptr || !tracking.load(std::memory_order_relaxed)) {
+        return;
+    }
+    BucketTotals& b = buckets[static_cast<size_t>(current_region)];
+    b.deallocations.fetch_add(1, std::memory_order_relaxed);
+    b.bytes_freed.fetch_add(malloc_usable_size(ptr), std::memory_order_relaxed);
+}
+
+void* allocate(std::size_t size) {
+    void* ptr = std::malloc(size == 0 ? 1 : size);
+    noteAllocation(ptr);
+    return ptr;
+}
+
+void* allocateAligned(std::size_t size, std::align_val_t alignment) {
+    void* ptr = nullptr;
+    size_t align = static_cast<size_t>(alignment);
+    if (posix_memalign(&ptr, align < sizeof(void*) ? sizeof(void*) : align, size == 0 ? 1 : size) != 0) {
+        ptr = nullptr;
+    }
+    noteAllocation(ptr);
+    return ptr;
+}
+
+void release(void* ptr) {
+    noteDeallocation(ptr);
+    std::free(ptr);
+}
+
+} // namespace
+
+void* operator new(std::size_t size) {
+    if (void* ptr = allocate(size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    return allocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return allocate(size);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    if (void* ptr = allocateAligned(size, alignment)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+    return operator new(size, alignment);
+}
+
+void operator delete(void* ptr) noexcept { release(ptr); }
+void operator delete[](void* ptr) noexcept { release(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { release(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { release(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { release(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { release(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { release(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { release(ptr); }
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept { release(ptr); }
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept { release(ptr); }
+
+namespace alloc {
+
+void enable(bool on) {
+    tracking.store(on, std::memory_order_relaxed);
+}
+
+bool enabled() {
+    return tracking.load(std::memory_order_relaxed);
+}
+
+AllocTotals totals(ProfileRegion region) {
+    const BucketTotals& b = buckets[static_cast<size_t>(region)];
+    AllocTotals t;
+    t.calls = b.calls.load(std::memory_order_relaxed);
+    t.allocations = b.allocations.load(std::memory_order_relaxed);
+    t.deallocations = b.deallocations.load(std::memory_order_relaxed);
+    t.bytes_allocated = b.bytes_allocated.load(std::memory_order_relaxed);
+    t.bytes_freed = b.bytes_freed.load(std::memory_order_relaxed);
+    return t;
+}
+
+void reset() {
+    for (auto& b : buckets) {
+        b.calls = 0;
+        b.allocations = 0;
+        b.deallocations = 0;
+        b.bytes_allocated = 0;
+        b.bytes_freed = 0;
+    }
+}
+
+void printReport(bool steady_state) {
+    console() << "Выделения памяти (на одну операцию, без вложенных участков"
+              << (steady_state ? ", после прогрева" : "") << "):\n";
+    for (size_t r = 0; r < kBuckets; ++r) {
+        auto region = static_cast<ProfileRegion>(r);
+        AllocTotals t = totals(region);
+        if (t.allocations == 0 && t.calls == 0) {
+            continue;
+        }
+        const char* title = region == ProfileRegion::Count ? "вне участков" : profileRegionName(region);
+        console() << title << ": выделений " << t.allocations << " (" << t.bytes_allocated << " байт), освобождений "
+                  << t.deallocations << " (" << t.bytes_freed << " байт)";
+        if (t.calls > 0) {
+            double calls = static_cast<double>(t.calls);
+            console() << ", на вызов " << static_cast<double>(t.allocations) / calls << " выделений / "
+                      << static_cast<double>(t.bytes_allocated) / calls << " байт";
+            if (steady_state && t.allocations > 0) {
+                console() << "  <- выделения в установившемся режиме";
+            }
+        }
+        console() << "\n";
+    }
+}
+
+ProfileRegion enterRegion(ProfileRegion region) {
+    ProfileRegion previous = current_region;
+    current_region = region;
+    if (tracking.load(std::memory_order_relaxed)) {
+        buckets[static_cast<size_t>(region)].calls.fetch_add(1, std::memory_order_relaxed);
+    }
+    return previous;
+}
+
+void leaveRegion(ProfileRegion previous) {
+    current_region = previous;
+}
+
+} // namespace alloc
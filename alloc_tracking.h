@@ -0,0 +1,33 @@
+#ifndef ALLOC_TRACKING_H
+#define ALLOC_TRACKING_H
+
+#include <cstdint>
+#include "perf_counters.h"
+
+struct AllocTotals {
+    uint64_t calls = 0;          // входы в участок за время учёта
+    uint64_t allocations = 0;
+    uint64_t deallocations = 0;
+    uint64_t bytes_allocated = 0;
+    uint64_t bytes_freed = 0;
+};
+
+// Учёт выделений памяти через подменённые глобальные operator new/delete.
+// Выделение относится к самому внутреннему участку ProfileRegion текущего потока
+// (метки ставит PerfScope); всё остальное попадает в ProfileRegion::Count - "вне участков".
+namespace alloc {
+
+void enable(bool on);
+bool enabled();
+AllocTotals totals(ProfileRegion region);
+void reset();
+// steady_state - учёт включён после прогрева: любое выделение на вызов помечается
+void printReport(bool steady_state);
+
+// Метка текущего потока; возвращает предыдущую для восстановления
+ProfileRegion enterRegion(ProfileRegion region);
+void leaveRegion(ProfileRegion previous);
+
+} // namespace alloc
+
+#endif // ALLOC_TRACKING_H
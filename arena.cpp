@@ -0,0 +1,37 @@
+#include "arena.h"
+
+#include <cstddef>
+
+namespace {
+
+// Обычный заказ укладывается в буфер целиком; при переполнении арена
+// добирает блоки из кучи и возвращает их при сбросе
+constexpr size_t kArenaBytes = 64 * 1024;
+
+struct ThreadArena {
+    alignas(std::max_align_t) std::byte buffer[kArenaBytes];
+    std::pmr::monotonic_buffer_resource resource{buffer, sizeof(buffer), std::pmr::new_delete_resource()};
+    size_t depth = 0;
+};
+
+ThreadArena& threadArena() {
+    thread_local ThreadArena arena;
+    return arena;
+}
+
+} // namespace
+
+std::pmr::memory_resource* orderArena() {
+    return &threadArena().resource;
+}
+
+ArenaScope::ArenaScope() {
+    ++threadArena().depth;
+}
+
+ArenaScope::~ArenaScope() {
+    ThreadArena& arena = threadArena();
+    if (--arena.depth == 0) {
+        arena.resource.release();
+    }
+}
@@ -0,0 +1,22 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <memory_resource>
+
+// Монотонная арена текущего потока для временных объектов одного заказа
+// или одного прохода авторазгрузки. Память берётся сдвигом указателя
+// из буфера потока и освобождается разом, когда закрывается внешний ArenaScope.
+// Пользоваться ею можно только внутри ArenaScope.
+std::pmr::memory_resource* orderArena();
+
+// Область использования арены. Вложенные области (deliver внутри дозаказа
+// внутри storeProduct) ничего не сбрасывают - сброс делает только внешняя.
+class ArenaScope {
+public:
+    ArenaScope();
+    ~ArenaScope();
+    ArenaScope(const ArenaScope&) = delete;
+    ArenaScope& operator=(const ArenaScope&) = delete;
+};
+
+#endif // ARENA_H
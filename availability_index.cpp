@@ -0,0 +1,213 @@
+#include "availability_index.h"
+#include "classes.h"
+
+void WarehouseSet::set(uint32_t id) {
+    if (words.size() <= id / 64) {
+        words.resize(id / 64 + 1, 0);
+    }
+    words[id / 64] |= uint64_t{1} << (id % 64);
+}
+
+void WarehouseSet::reset(uint32_t id) {
+    if (id / 64 < words.size()) {
+        words[id / 64] &= ~(uint64_t{1} << (id % 64));
+    }
+}
+
+bool WarehouseSet::test(uint32_t id) const {
+    return id / 64 < words.size() && (words[id / 64] >> (id % 64)) & 1;
+}
+
+bool WarehouseSet::empty() const {
+    return std::all_of(words.begin(), words.end(), [](uint64_t w) { return w == 0; });
+}
+
+size_t WarehouseSet::count() const {
+    size_t n = 0;
+    for (uint64_t w : words) {
+        n += static_cast<size_t>(__builtin_popcountll(w));
+    }
+    return n;
+}
+
+WarehouseSet& WarehouseSet::operator&=(const WarehouseSet& other) {
+    if (words.size() > other.words.size()) {
+        words.resize(other.words.size());
+    }
+    for (size_t i = 0; i < words.size(); ++i) {
+        words[i] &= other.words[i];
+    }
+    return *this;
+}
+
+WarehouseSet& WarehouseSet::operator|=(const WarehouseSet& other) {
+    if (words.size() < other.words.size()) {
+        words.resize(other.words.size(), 0);
+    }
+    for (size_t i = 0; i < other.words.size(); ++i) {
+        words[i] |= other.words[i];
+    }
+    return *this;
+}
+
+uint32_t AvailabilityIndex::registerWarehouse(Warehouse* warehouse) {
+    uint32_t id;
+    {
+        std::unique_lock<std::shared_mutex> lock(registry_mtx);
+        id = static_cast<uint32_t>(warehouses.size());
+        warehouses.push_back(warehouse);
+    }
+    warehouse->attachIndex(this, id); // склад сразу публикует текущие остатки
+    registry_version.fetch_add(1, std::memory_order_release);
+    return id;
+}
+
+void AvailabilityIndex::unregisterWarehouse(uint32_t warehouse_id) {
+    std::unique_lock<std::shared_mutex> registry(registry_mtx);
+    if (warehouse_id >= warehouses.size()) {
+        return;
+    }
+    warehouses[warehouse_id] = nullptr;
+    registry_version.fetch_add(1, std::memory_order_release);
+    // Шарды по одному: update, прошедший шард до вывода, отсюда же и вычищается
+    for (Shard& shard : shards) {
+        std::unique_lock<std::shared_mutex> lock(shard.mtx);
+        shard.retired.set(warehouse_id);
+        for (auto& product : shard.products) {
+            Entry& entry = product.second;
+            auto it = std::find_if(entry.holders.begin(), entry.holders.end(),
+                                   [&](const auto& h) { return h.first == warehouse_id; });
+            if (it != entry.holders.end()) {
+                entry.total -= it->second;
+                *it = entry.holders.back();
+                entry.holders.pop_back();
+                entry.mask.reset(warehouse_id);
+            }
+        }
+    }
+}
+
+void AvailabilityIndex::update(uint32_t warehouse_id, const std::string& product_name, size_t quantity) {
+    Shard& shard = shardOf(product_name);
+    std::unique_lock<std::shared_mutex> lock(shard.mtx);
+    if (shard.retired.test(warehouse_id)) {
+        return; // склад выведен из сети
+    }
+    Entry& entry = shard.products[product_name];
+    auto it = std::find_if(entry.holders.begin(), entry.holders.end(),
+                           [&](const auto& h) { return h.first == warehouse_id; });
+    if (it != entry.holders.end()) {
+        entry.total -= it->second;
+        if (quantity > 0) {
+            it->second = quantity;
+        } else {
+            *it = entry.holders.back(); // склад больше не держит продукт
+            entry.holders.pop_back();
+            entry.mask.reset(warehouse_id);
+        }
+    } else if (quantity > 0) {
+        entry.holders.emplace_back(warehouse_id, quantity);
+        entry.mask.set(warehouse_id);
+    }
+    entry.total += quantity;
+}
+
+std::vector<StockHolder> AvailabilityIndex::holders(const std::string& product_name) const {
+    std::vector<StockHolder> result;
+    collectHolders(product_name, result);
+    return result;
+}
+
+void AvailabilityIndex::holders(const std::string& product_name, std::pmr::vector<StockHolder>& out) const {
+    out.clear();
+    collectHolders(product_name, out);
+}
+
+template <class Holders>
+void AvailabilityIndex::collectHolders(const std::string& product_name, Holders& result) const {
+    const Shard& shard = shardOf(product_name);
+    std::shared_lock<std::shared_mutex> registry(registry_mtx);
+    std::shared_lock<std::shared_mutex> lock(shard.mtx);
+    auto it = shard.products.find(product_name);
+    if (it == shard.products.end()) {
+        return;
+    }
+    result.reserve(it->second.holders.size());
+    for (const auto& h : it->second.holders) {
+        result.push_back({warehouses[h.first], h.first, h.second});
+    }
+    lock.unlock();
+    registry.unlock();
+    std::sort(result.begin(), result.end(),
+              [](const StockHolder& a, const StockHolder& b) { return a.warehouse_id < b.warehouse_id; });
+}
+
+size_t AvailabilityIndex::quantity(uint32_t warehouse_id, const std::string& product_name) const {
+    const Shard& shard = shardOf(product_name);
+    std::shared_lock<std::shared_mutex> lock(shard.mtx);
+    auto it = shard.products.find(product_name);
+    if (it == shard.products.end()) {
+        return 0;
+    }
+    for (const auto& h : it->second.holders) {
+        if (h.first == warehouse_id) {
+            return h.second;
+        }
+    }
+    return 0;
+}
+
+size_t AvailabilityIndex::totalQuantity(const std::string& product_name) const {
+    const Shard& shard = shardOf(product_name);
+    std::shared_lock<std::shared_mutex> lock(shard.mtx);
+    auto it = shard.products.find(product_name);
+    return it != shard.products.end() ? it->second.total : 0;
+}
+
+WarehouseSet AvailabilityIndex::holderSet(const std::string& product_name) const {
+    const Shard& shard = shardOf(product_name);
+    std::shared_lock<std::shared_mutex> lock(shard.mtx);
+    auto it = shard.products.find(product_name);
+    return it != shard.products.end() ? it->second.mask : WarehouseSet();
+}
+
+WarehouseSet AvailabilityIndex::holderSet(const std::map<std::string, size_t>& requests) const {
+    // Продукты заказа - в разных шардах: маска собирается по одному шарду за раз,
+    // как и остальные запросы, это снимок-подсказка, а не гарантия остатка
+    WarehouseSet result;
+    bool first = true;
+    for (const auto& request : requests) {
+        const Shard& shard = shardOf(request.first);
+        std::shared_lock<std::shared_mutex> lock(shard.mtx);
+        auto it = shard.products.find(request.first);
+        if (it == shard.products.end()) {
+            return WarehouseSet();
+        }
+        WarehouseSet enough;
+        for (const auto& h : it->second.holders) {
+            if (h.second >= request.second) {
+                enough.set(h.first);
+            }
+        }
+        if (first) {
+            result = std::move(enough);
+            first = false;
+        } else {
+            result &= enough;
+        }
+        if (result.empty()) {
+            break;
+        }
+    }
+    return result;
+}
+
+WarehouseSet AvailabilityIndex::setOf(const std::vector<Warehouse*>& list) const {
+    WarehouseSet result;
+    for (auto* warehouse : list) {
+        if (warehouse->getIndex() == this) {
+            result.set(warehouse->getIndexId());
+        }
+    }
+    return result;
+}
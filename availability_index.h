@@ -0,0 +1,102 @@
+#ifndef AVAILABILITY_INDEX_H
+#define AVAILABILITY_INDEX_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory_resource>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class Warehouse;
+
+// Множество складов в виде битовой маски по номерам складов в индексе
+class WarehouseSet {
+public:
+    void set(uint32_t id);
+    void reset(uint32_t id);
+    bool test(uint32_t id) const;
+    bool empty() const;
+    size_t count() const;
+    WarehouseSet& operator&=(const WarehouseSet& other);
+    WarehouseSet& operator|=(const WarehouseSet& other);
+
+    template <typename F>
+    void forEach(F f) const {
+        for (size_t w = 0; w < words.size(); ++w) {
+            for (uint64_t bits = words[w]; bits != 0; bits &= bits - 1) {
+                f(static_cast<uint32_t>(w * 64 + __builtin_ctzll(bits)));
+            }
+        }
+    }
+
+private:
+    std::vector<uint64_t> words;
+};
+
+struct StockHolder {
+    Warehouse* warehouse;
+    uint32_t warehouse_id;
+    size_t quantity;
+};
+
+// Обратный индекс наличия: продукт -> склады с ненулевым остатком.
+// Склады сами сообщают новые остатки при storeProduct, unload и autoUnload,
+// поэтому запрос стоит пропорционально числу держателей, а не всех складов.
+// Продукты разложены по kShards шардам по хешу имени, у каждого шарда своя
+// блокировка: склады, обновляющие разные продукты, не ждут друг друга.
+class AvailabilityIndex {
+public:
+    // Регистрирует склад и подключает к нему индекс; возвращает номер склада
+    uint32_t registerWarehouse(Warehouse* warehouse);
+    // Выведенный склад пропадает из держателей; его номер больше не выдаётся,
+    // а запоздавшие update от него игнорируются
+    void unregisterWarehouse(uint32_t warehouse_id);
+    void update(uint32_t warehouse_id, const std::string& product_name, size_t quantity);
+
+    // Держатели продукта в порядке регистрации складов
+    std::vector<StockHolder> holders(const std::string& product_name) const;
+    // То же в контейнер вызывающего (например, в арене заказа)
+    void holders(const std::string& product_name, std::pmr::vector<StockHolder>& out) const;
+    size_t quantity(uint32_t warehouse_id, const std::string& product_name) const;
+    size_t totalQuantity(const std::string& product_name) const;
+    WarehouseSet holderSet(const std::string& product_name) const;
+    // Склады, на которых каждого продукта заказа хватает целиком
+    WarehouseSet holderSet(const std::map<std::string, size_t>& requests) const;
+    WarehouseSet setOf(const std::vector<Warehouse*>& warehouses) const;
+    // Растёт при каждой регистрации и выводе склада: по ней потребители
+    // узнают, что построенные по setOf множества пора пересчитать
+    uint64_t registryVersion() const { return registry_version.load(std::memory_order_acquire); }
+
+private:
+    static constexpr size_t kShards = 64;
+
+    struct Entry {
+        std::vector<std::pair<uint32_t, size_t>> holders; // (номер склада, количество)
+        WarehouseSet mask;
+        size_t total = 0;
+    };
+    // Шард на отдельной кеш-линии, чтобы блокировки соседних шардов не делили линию
+    struct alignas(64) Shard {
+        mutable std::shared_mutex mtx;
+        std::unordered_map<std::string, Entry> products;
+        WarehouseSet retired; // выведенные склады: их update в этом шарде игнорируются
+    };
+
+    mutable std::shared_mutex registry_mtx; // только список складов; update его не берёт
+    std::vector<Warehouse*> warehouses;
+    std::atomic<uint64_t> registry_version{0};
+    std::array<Shard, kShards> shards;
+
+    Shard& shardOf(const std::string& product_name) { return shards[std::hash<std::string>{}(product_name) % kShards]; }
+    const Shard& shardOf(const std::string& product_name) const {
+        return shards[std::hash<std::string>{}(product_name) % kShards];
+    }
+    template <class Holders>
+    void collectHolders(const std::string& product_name, Holders& result) const;
+};
+
+#endif // AVAILABILITY_INDEX_H
@@ -0,0 +1,137 @@
+#include "backorder.h"
+#include "classes.h"
+#include "epoch.h"
+
+BackorderQueue::BackorderQueue(BackorderPolicy policy) : policy(policy) {}
+
+uint64_t BackorderQueue::add(Truck* truck, const std::string& shop_name, const std::string& product_name,
+                             size_t quantity, int priority) {
+    std::lock_guard<std::mutex> lock(mtx);
+    Key key{policy == BackorderPolicy::Priority ? -priority : 0, ++next_seq};
+    Backorder& order = queues[product_name][key];
+    order.id = key.seq;
+    order.truck = truck;
+    order.shop_name = shop_name;
+    order.product_name = product_name;
+    order.remaining = quantity;
+    order.priority = priority;
+    by_id.emplace(order.id, std::make_pair(product_name, key));
+    waiting.fetch_add(1, std::memory_order_relaxed);
+    return order.id;
+}
+
+bool BackorderQueue::cancel(uint64_t id) {
+    std::lock_guard<std::mutex> lock(mtx);
+    auto it = by_id.find(id);
+    if (it == by_id.end()) {
+        return false;
+    }
+    queues[it->second.first].erase(it->second.second);
+    by_id.erase(it);
+    waiting.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
+size_t BackorderQueue::reassignTruck(Truck* retired, Truck* replacement) {
+    std::lock_guard<std::mutex> lock(mtx);
+    size_t touched = 0;
+    for (auto& entry : queues) {
+        ProductQueue& queue = entry.second;
+        for (auto it = queue.begin(); it != queue.end();) {
+            if (it->second.truck != retired) {
+                ++it;
+                continue;
+            }
+            ++touched;
+            if (replacement) {
+                it->second.truck = replacement;
+                ++it;
+            } else {
+                by_id.erase(it->second.id);
+                it = queue.erase(it);
+                waiting.fetch_sub(1, std::memory_order_relaxed);
+            }
+        }
+    }
+    return touched;
+}
+
+size_t BackorderQueue::pendingQuantity(const std::string& product_name) const {
+    std::lock_guard<std::mutex> lock(mtx);
+    auto it = queues.find(product_name);
+    if (it == queues.end()) {
+        return 0;
+    }
+    size_t total = 0;
+    for (const auto& entry : it->second) {
+        total += entry.second.remaining;
+    }
+    return total;
+}
+
+size_t BackorderQueue::size() const {
+    return waiting.load(std::memory_order_relaxed);
+}
+
+void BackorderQueue::onRestock(Warehouse* warehouse, const std::string& product_name, size_t restocked) {
+    if (waiting.load(std::memory_order_relaxed) == 0) {
+        return;
+    }
+
+    struct Claim {
+        Key key;
+        Backorder order;
+        size_t quantity;
+    };
+    std::vector<Claim> claims;
+    // Грузовик из резерва не освободится, даже если его выведут из сети до доставки
+    EpochGuard pinned;
+    {
+        // Резервируем поступивший остаток за дозаказами по порядку очереди
+        std::lock_guard<std::mutex> lock(mtx);
+        auto qit = queues.find(product_name);
+        if (qit == queues.end()) {
+            return;
+        }
+        size_t available = std::min(restocked, warehouse->getProductQuantity(product_name));
+        ProductQueue& queue = qit->second;
+        for (auto it = queue.begin(); it != queue.end() && available > 0;) {
+            size_t take = std::min(available, it->second.remaining);
+            claims.push_back({it->first, it->second, take});
+            available -= take;
+            it->second.remaining -= take;
+            if (it->second.remaining == 0) {
+                by_id.erase(it->second.id);
+                it = queue.erase(it);
+                waiting.fetch_sub(1, std::memory_order_relaxed);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    // Доставка идёт без блокировки очереди: deliver снова обращается к складу.
+    // Грузовик блокируется, как при выдаче заказа (OrderDispatcher::acquireTruck): занятый - ждём
+    for (auto& claim : claims) {
+        console() << "Исполнение дозаказа " << claim.order.id << ": " << claim.quantity << " ед. продукта "
+                  << product_name << " для магазина " << claim.order.shop_name << ".\n";
+        size_t delivered;
+        {
+            std::lock_guard<std::mutex> truck_lock(claim.order.truck->mtx);
+            delivered = claim.order.truck->deliverBackorder(warehouse, claim.order.shop_name, product_name, claim.quantity);
+        }
+        if (delivered < claim.quantity) {
+            // Остаток успели забрать параллельно - возвращаем недостачу на прежнее место в очереди
+            std::lock_guard<std::mutex> lock(mtx);
+            ProductQueue& queue = queues[product_name];
+            auto it = queue.find(claim.key);
+            if (it == queue.end()) {
+                claim.order.remaining = 0;
+                it = queue.emplace(claim.key, claim.order).first;
+                by_id.emplace(claim.order.id, std::make_pair(product_name, claim.key));
+                waiting.fetch_add(1, std::memory_order_relaxed);
+            }
+            it->second.remaining += claim.quantity - delivered;
+        }
+    }
+}
@@ -0,0 +1,69 @@
+#ifndef BACKORDER_H
+#define BACKORDER_H
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+class Truck;
+class Warehouse;
+
+// Порядок исполнения дозаказов по одному продукту
+enum class BackorderPolicy {
+    Fifo,     // в порядке поступления
+    Priority  // сначала больший приоритет, при равенстве - в порядке поступления
+};
+
+// Неисполненная часть строки заказа
+struct Backorder {
+    uint64_t id = 0;
+    Truck* truck = nullptr;
+    std::string shop_name;
+    std::string product_name;
+    size_t remaining = 0;
+    int priority = 0;
+};
+
+// Очереди неудовлетворённого спроса по продуктам. Склад вызывает onRestock
+// после поступления продукции, и ожидающие дозаказы сразу доставляются с него.
+// Дозаказ исполняет его грузовик под своей блокировкой (mtx), поэтому onRestock
+// нельзя вызывать, держа блокировку грузовика или склада.
+class BackorderQueue {
+public:
+    explicit BackorderQueue(BackorderPolicy policy = BackorderPolicy::Fifo);
+
+    uint64_t add(Truck* truck, const std::string& shop_name, const std::string& product_name,
+                 size_t quantity, int priority = 0);
+    bool cancel(uint64_t id);
+    // Дозаказы выводимого грузовика переходят к replacement; без него отменяются.
+    // Возвращает число затронутых дозаказов
+    size_t reassignTruck(Truck* retired, Truck* replacement);
+    size_t pendingQuantity(const std::string& product_name) const;
+    size_t size() const;
+
+    // restocked - сколько единиц продукта только что поступило: дозаказы получают
+    // не больше него, прежний остаток склада за ними не резервируется
+    void onRestock(Warehouse* warehouse, const std::string& product_name, size_t restocked);
+
+private:
+    struct Key {
+        int rank;      // -priority для Priority, 0 для Fifo
+        uint64_t seq;
+        bool operator<(const Key& other) const {
+            return rank != other.rank ? rank < other.rank : seq < other.seq;
+        }
+    };
+    using ProductQueue = std::map<Key, Backorder>;
+
+    BackorderPolicy policy;
+    mutable std::mutex mtx;
+    std::unordered_map<std::string, ProductQueue> queues;
+    std::unordered_map<uint64_t, std::pair<std::string, Key>> by_id;
+    uint64_t next_seq = 0;
+    std::atomic<size_t> waiting{0}; // быстрая проверка без блокировки в onRestock
+};
+
+#endif // BACKORDER_H
@@ -0,0 +1,306 @@
+#ifndef BASIC_WAREHOUSE_H
+#define BASIC_WAREHOUSE_H
+
+#include <algorithm>
+#include <memory_resource>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+#include "arena.h"
+#include "capacity.h"
+#include "fulfilment.h"
+#include "sim_policies.h"
+
+// Ядро склада, грузовика и фабрики для симуляций: размещение, авторазгрузка и
+// сбор заказа - те же алгоритмы fulfilment.h, что у Warehouse/Truck/Factory, но продукты
+// задаются номерами, а синхронизация и хранение - политиками из sim_policies.h.
+// Журнал, индекс наличия, дозаказы и вывод в консоль остаются у живых классов.
+// Порядок блокировок - склад, затем грузовик: авторазгрузка грузит кузов под блокировкой
+// склада, а доставка собирает заказ со складов до блокировки грузовика.
+
+// Строка заказа: номер продукта и количество
+struct SimLine {
+    ProductId product = 0;
+    size_t quantity = 0;
+};
+
+template <class Concurrency = NoLock, class Storage = MapStorage>
+class BasicWarehouse {
+    static_assert(!Concurrency::kSharded || Storage::kStableSlots,
+                  "сегментированные блокировки требуют хранения с неподвижными ячейками");
+
+public:
+    // catalog_size - число продуктов каталога; продукты вне каталога не принимаются.
+    // Для ShardedLock и каталога при компиляции (его размер берётся из Storage) каталог обязателен.
+    // kUnknownProduct не принимается никогда
+    BasicWarehouse(std::string name, const Capacity& limits, size_t catalog_size = 0)
+            : name(std::move(name)), limits(limits),
+              catalog_size(Storage::kFixedProducts ? Storage::kFixedProducts : catalog_size) {
+        storage.reserve(this->catalog_size);
+    }
+
+    const std::string& getName() const { return name; }
+    Capacity getLoad() {
+        typename Concurrency::TotalsGuard guard(sync);
+        return used;
+    }
+
+    // Сколько единиц размером unit ещё помещается на склад
+    size_t fitCount(const Capacity& unit) {
+        typename Concurrency::TotalsGuard guard(sync);
+        return Capacity::fitCount(limits, used, unit);
+    }
+
+    // Размещение партии целиком, как Warehouse::storeProduct
+    bool store(ProductId product, const Capacity& unit, size_t quantity) {
+        if (!known(product)) {
+            return false;
+        }
+        typename Concurrency::KeyGuard key(sync, product);
+        {
+            typename Concurrency::NestedTotalsGuard guard(sync);
+            if (quantity > Capacity::fitCount(limits, used, unit)) {
+                return false;
+            }
+            used += unit * quantity;
+        }
+        StockEntry& entry = storage.slot(product);
+        entry.unit = unit;
+        entry.quantity += quantity;
+        entry.present = true;
+        return true;
+    }
+
+    // Отгрузка до max_quantity единиц; возвращает отгруженное количество
+    size_t take(ProductId product, size_t max_quantity) {
+        if (!known(product)) {
+            return 0;
+        }
+        typename Concurrency::KeyGuard key(sync, product);
+        return takeLocked(product, max_quantity);
+    }
+
+    size_t quantity(ProductId product) {
+        if (!known(product)) {
+            return 0;
+        }
+        typename Concurrency::KeyGuard key(sync, product);
+        const StockEntry* entry = storage.find(product);
+        return entry ? entry->quantity : 0;
+    }
+
+    Capacity unitOf(ProductId product) {
+        if (!known(product)) {
+            return Capacity{};
+        }
+        typename Concurrency::KeyGuard key(sync, product);
+        const StockEntry* entry = storage.find(product);
+        return entry ? entry->unit : Capacity{};
+    }
+
+    bool isOverloaded() {
+        typename Concurrency::TotalsGuard guard(sync);
+        return overloaded();
+    }
+
+    // Синхронная авторазгрузка, как Warehouse::autoUnload: кузова заполняются
+    // first-fit decreasing, пока склад перегружен; один рейс на заполненный кузов
+    template <class Truck>
+    void autoUnload(std::vector<Truck*>& trucks) {
+        typename Concurrency::AllGuard all(sync);
+        ArenaScope arena;
+
+        std::sort(trucks.begin(), trucks.end(), [](Truck* a, Truck* b) {
+            return a->getFreeUnits() > b->getFreeUnits();
+        });
+
+        for (Truck* truck : trucks) {
+            if (!overloadedLocked()) {
+                break;
+            }
+            std::pmr::vector<std::pair<ProductId, StockEntry*>> order(orderArena());
+            storage.forEach([&](ProductId product, StockEntry& entry) {
+                if (entry.quantity > 0) {
+                    order.emplace_back(product, &entry);
+                }
+            });
+            // Равные единицы - по номеру продукта
+            bool loaded = fillTruck(
+                    order, truck->getLimits(), [](const auto& candidate) { return candidate.second->unit; },
+                    [](const auto& a, const auto& b) { return a.first < b.first; },
+                    [&](const auto& candidate) {
+                        // Кузов принимает сколько помещается, склад отдаёт ровно столько
+                        size_t amount = truck->addUnits(candidate.second->unit, candidate.second->quantity);
+                        takeLocked(candidate.first, amount);
+                        return amount;
+                    },
+                    [&] { return overloadedLocked(); });
+            if (loaded) {
+                truck->unloadTrip();
+            }
+        }
+    }
+
+private:
+    std::string name;
+    Capacity limits;
+    Capacity used;
+    size_t catalog_size;
+    Storage storage;
+    Concurrency sync;
+
+    bool overloaded() const {
+        return Capacity::fillRatio(limits, used) * 100 >= 95.0;
+    }
+
+    bool overloadedLocked() {
+        typename Concurrency::NestedTotalsGuard guard(sync);
+        return overloaded();
+    }
+
+    // Номер продукта можно передавать хранению: не kUnknownProduct (он же пустой ключ
+    // FlatHashStorage) и в пределах каталога, если каталог задан или обязателен
+    bool known(ProductId product) const {
+        if (product == kUnknownProduct) {
+            return false;
+        }
+        return !(Concurrency::kSharded || Storage::kFixedProducts || catalog_size != 0) || product < catalog_size;
+    }
+
+    size_t takeLocked(ProductId product, size_t max_quantity) {
+        StockEntry* entry = storage.find(product);
+        if (!entry) {
+            return 0;
+        }
+        size_t taken = std::min(entry->quantity, max_quantity);
+        entry->quantity -= taken;
+        typename Concurrency::NestedTotalsGuard guard(sync);
+        used -= entry->unit * taken;
+        return taken;
+    }
+};
+
+template <class Concurrency = NoLock>
+class BasicTruck {
+public:
+    BasicTruck(std::string name, const Capacity& limits) : name(std::move(name)), limits(limits) {}
+
+    const std::string& getName() const { return name; }
+    Capacity getLimits() const { return limits; }
+    size_t getFreeUnits() {
+        typename Concurrency::AllGuard guard(sync);
+        return limits.units - load.units;
+    }
+    size_t getTotalDelivered() const { return total_delivered; }
+    size_t getTrips() const { return trips; }
+
+    size_t fitCount(const Capacity& unit) {
+        typename Concurrency::AllGuard guard(sync);
+        return Capacity::fitCount(limits, load, unit);
+    }
+
+    // Погрузка при авторазгрузке склада: до count единиц, сколько помещается.
+    // Проверка места и погрузка - под одной блокировкой; возвращает погруженное
+    size_t addUnits(const Capacity& unit, size_t count) {
+        typename Concurrency::AllGuard guard(sync);
+        size_t accepted = std::min(count, Capacity::fitCount(limits, load, unit));
+        load += unit * accepted;
+        total_delivered += accepted;
+        return accepted;
+    }
+
+    // Рейс в магазин: кузов пустеет
+    void unloadTrip() {
+        typename Concurrency::AllGuard guard(sync);
+        load = Capacity{};
+        ++trips;
+    }
+
+    // Доставка заказа, как Truck::deliver по нескольким складам (gatherOrder): сначала склад,
+    // где хватает всего заказа, иначе сбор по складам; собранное раскладывается по рейсам.
+    // Склады опрашиваются до блокировки грузовика. Возвращает количество доставленных единиц.
+    template <class Warehouse>
+    size_t deliver(const std::vector<Warehouse*>& warehouses, std::span<const SimLine> requests) {
+        ArenaScope arena;
+        std::pmr::vector<PackItem> picked(orderArena());
+        size_t delivered = 0;
+        bool product_found = false;
+        bool whole = gatherOrder(
+                warehouses, requests, [](const SimLine& line) { return line.quantity; },
+                [&](Warehouse* warehouse) {
+                    for (const auto& line : requests) {
+                        if (warehouse->quantity(line.product) < line.quantity) {
+                            return false;
+                        }
+                    }
+                    return true;
+                },
+                [&](const SimLine& line, auto&& visit) {
+                    for (Warehouse* warehouse : warehouses) {
+                        size_t available = warehouse->quantity(line.product);
+                        if (available > 0) {
+                            product_found = true;
+                            if (!visit(warehouse, available)) {
+                                break;
+                            }
+                        }
+                    }
+                },
+                [&](Warehouse* warehouse, size_t, const SimLine& line, size_t quantity) {
+                    size_t taken = warehouse->take(line.product, quantity);
+                    if (taken > 0) {
+                        picked.push_back({{}, warehouse->unitOf(line.product), taken});
+                    }
+                    delivered += taken;
+                    return taken;
+                },
+                [](size_t, const SimLine&, size_t) {});
+
+        typename Concurrency::AllGuard guard(sync);
+        if (whole || product_found) {
+            dispatchLoads(picked);
+        }
+        total_delivered += delivered;
+        return delivered;
+    }
+
+private:
+    std::string name;
+    Capacity limits;
+    Capacity load;
+    size_t total_delivered = 0;
+    size_t trips = 0;
+    Concurrency sync;
+
+    // Один рейс на загрузку из packLoads; без погруженного товара рейса нет, как у Truck.
+    // Кузов авторазгрузки (load) не трогается: его рейс завершает unloadTrip
+    void dispatchLoads(std::span<const PackItem> picked) {
+        auto loads = packLoads(picked, limits, orderArena());
+        trips += loads.size();
+    }
+};
+
+// Фабрика: партия одного продукта за вызов, размещение как Factory::storage
+class BasicFactory {
+public:
+    BasicFactory(ProductId product, const Capacity& unit, size_t production_rate)
+            : product(product), unit(unit), production_rate(production_rate) {}
+
+    size_t getProductionRate() const { return production_rate; }
+
+    // Возвращает количество размещённых единиц
+    template <class Warehouse>
+    size_t storage(const std::vector<Warehouse*>& warehouses) const {
+        return placeBatch(
+                warehouses, production_rate, [&](Warehouse* warehouse) { return warehouse->fitCount(unit); },
+                [&](Warehouse* warehouse, size_t quantity, bool) { return warehouse->store(product, unit, quantity); });
+    }
+
+private:
+    ProductId product;
+    Capacity unit;
+    size_t production_rate;
+};
+
+#endif // BASIC_WAREHOUSE_H
@@ -0,0 +1,113 @@
+#include "benchmark.h"
+#include "classes.h"
+#include "alloc_tracking.h"
+#include "fleet_stats.h"
+#include "perf_counters.h"
+
+#include <chrono>
+#include <memory>
+
+BenchReport runBenchmark(const BenchConfig& config) {
+    BenchReport report;
+    using clock = std::chrono::steady_clock;
+
+    // Скорость самого генератора: заказы никуда не передаются
+    {
+        WorkloadGenerator generator(config.workload);
+        uint64_t checksum = 0;
+        auto start = clock::now();
+        for (size_t i = 0; i < config.orders; ++i) {
+            GeneratedOrder order = generator.nextOrder();
+            checksum += order.lines[0].product + order.line_count;
+        }
+        report.generate_seconds = std::chrono::duration<double>(clock::now() - start).count();
+        if (checksum == 0) {
+            console() << "\n"; // не даём компилятору выбросить цикл
+        }
+    }
+
+    ScopedConsole quiet(nullConsole());
+    std::vector<std::unique_ptr<Warehouse>> warehouse_pool;
+    std::vector<Warehouse*> warehouses;
+    for (size_t i = 0; i < config.warehouses; ++i) {
+        warehouse_pool.push_back(std::make_unique<Warehouse>("Склад " + std::to_string(i + 1), config.warehouse_capacity));
+        warehouses.push_back(warehouse_pool.back().get());
+    }
+    auto fleet = std::make_unique<FleetStats>();
+    std::vector<std::unique_ptr<Truck>> trucks;
+    for (size_t i = 0; i < config.trucks; ++i) {
+        trucks.push_back(std::make_unique<Truck>("Грузовик " + std::to_string(i + 1), config.truck_capacity));
+        trucks.back()->attachStats(fleet.get());
+    }
+
+    WorkloadGenerator generator(config.workload);
+    size_t next_truck = 0;
+    if (config.profile) {
+        perf::reset();
+        perf::enable(true);
+    }
+    // Прогрев: склады набирают продукцию, контейнеры и журнал прибытий разрастаются
+    const auto warmup_orders = static_cast<size_t>(static_cast<double>(config.orders) * config.warmup_fraction);
+    auto start = clock::now();
+    while (report.orders < config.orders) {
+        if (config.track_allocations && report.orders == warmup_orders && !alloc::enabled()) {
+            alloc::reset();
+            alloc::enable(true);
+        }
+        WorkloadEvent event = generator.nextEvent();
+        if (!event.is_order) {
+            const ProductionRun& run = event.production;
+            Factory factory(generator.productName(run.product), 10.0, "Коробка", static_cast<int>(run.quantity));
+            factory.storage(warehouses);
+            ++report.production_runs;
+            continue;
+        }
+        Truck* truck = trucks[next_truck++ % trucks.size()].get();
+        size_t before = truck->getTotalDelivered();
+        auto request = generator.toRequest(event.order);
+        for (const auto& line : request) {
+            report.requested += line.second;
+        }
+        truck->deliver(warehouses, generator.shopName(event.order.shop), request);
+        report.delivered += truck->getTotalDelivered() - before;
+        ++report.orders;
+    }
+    report.run_seconds = std::chrono::duration<double>(clock::now() - start).count();
+    if (config.profile) {
+        perf::enable(false);
+        report.profiled = true;
+    }
+    if (config.track_allocations) {
+        alloc::enable(false);
+        report.allocations_tracked = true;
+    }
+    auto products = fleet->ranking(StatDimension::Product, FleetStats::today());
+    for (const auto& product : products) {
+        report.fleet_today += product.second;
+    }
+    if (!products.empty()) {
+        report.top_product = products.front().first;
+        report.top_product_units = fleet->delivered(StatDimension::Product, report.top_product);
+    }
+    return report;
+}
+
+void printBenchReport(const BenchReport& report) {
+    double generated = report.generate_seconds > 0 ? static_cast<double>(report.orders) / report.generate_seconds : 0;
+    double processed = report.run_seconds > 0 ? static_cast<double>(report.orders) / report.run_seconds : 0;
+    console() << "Заказов: " << report.orders << ", партий производства: " << report.production_runs << "\n";
+    console() << "Генерация: " << generated << " заказов/с\n";
+    console() << "Обработка: " << processed << " заказов/с, выполнено "
+              << (report.requested ? 100.0 * static_cast<double>(report.delivered) / static_cast<double>(report.requested) : 100.0)
+              << "% спроса\n";
+    if (!report.top_product.empty()) {
+        console() << "Доставлено по сети за сегодня: " << report.fleet_today << " ед., больше всего - "
+                  << report.top_product << " (" << report.top_product_units << " ед.)\n";
+    }
+    if (report.profiled) {
+        perf::printReport();
+    }
+    if (report.allocations_tracked) {
+        alloc::printReport(true);
+    }
+}
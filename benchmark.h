@@ -0,0 +1,36 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include "workload.h"
+
+struct BenchConfig {
+    size_t orders = 100000;
+    size_t warehouses = 8;
+    size_t warehouse_capacity = 200000;
+    size_t trucks = 16;
+    size_t truck_capacity = 40;
+    bool profile = false;          // счётчики perf_counters.h на время обработки
+    bool track_allocations = false; // учёт выделений alloc_tracking.h после прогрева
+    double warmup_fraction = 0.1;  // доля заказов до начала учёта выделений
+    WorkloadConfig workload;
+};
+
+struct BenchReport {
+    size_t orders = 0;
+    size_t production_runs = 0;
+    size_t requested = 0;
+    size_t delivered = 0;
+    double generate_seconds = 0;   // только генерация заказов
+    double run_seconds = 0;        // генерация и обработка через Factory::storage и Truck::deliver
+    bool profiled = false;
+    bool allocations_tracked = false;
+    uint64_t fleet_today = 0;      // итог FleetStats за сегодня по всем продуктам
+    std::string top_product;       // больше всего доставлено за прогон
+    uint64_t top_product_units = 0;
+};
+
+// Нагрузочный прогон: поток генератора идёт напрямую в путь доставки
+BenchReport runBenchmark(const BenchConfig& config);
+void printBenchReport(const BenchReport& report);
+
+#endif // BENCHMARK_H
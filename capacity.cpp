@@ -0,0 +1,131 @@
+#include "capacity.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <map>
+#include <mutex>
+
+namespace {
+
+// Таблица объёмов почти не меняется: каждый поток читает свою копию и
+// обновляет её только при смене версии, без общего мьютекса на горячем пути
+std::mutex volumes_mtx;
+std::atomic<uint64_t> volumes_version{1};
+
+std::map<std::string, double, std::less<>>& volumes() {
+    static std::map<std::string, double, std::less<>> table = {
+            {"Коробка", 0.05},
+            {"Паллета", 1.2},
+            {"Мешок", 0.03},
+            {"Ящик", 0.08},
+    };
+    return table;
+}
+
+size_t fitDimension(double limit, double used, double per_unit) {
+    if (std::isinf(limit) || per_unit <= 0) {
+        return std::numeric_limits<size_t>::max();
+    }
+    double left = limit - used;
+    return left <= 0 ? 0 : static_cast<size_t>(std::floor(left / per_unit + 1e-9));
+}
+
+double ratio(double value, double limit) {
+    return (std::isinf(limit) || limit <= 0) ? 0 : value / limit;
+}
+
+} // namespace
+
+double packagingVolume(std::string_view packaging) {
+    thread_local uint64_t seen_version = 0;
+    thread_local std::map<std::string, double, std::less<>> local;
+    uint64_t version = volumes_version.load(std::memory_order_acquire);
+    if (version != seen_version) {
+        std::lock_guard<std::mutex> lock(volumes_mtx);
+        local = volumes();
+        seen_version = volumes_version.load(std::memory_order_relaxed);
+    }
+    auto it = local.find(packaging);
+    return it != local.end() ? it->second : 0;
+}
+
+void setPackagingVolume(const std::string& packaging, double volume) {
+    std::lock_guard<std::mutex> lock(volumes_mtx);
+    volumes()[packaging] = volume;
+    volumes_version.fetch_add(1, std::memory_order_release);
+}
+
+Capacity& Capacity::operator+=(const Capacity& other) {
+    units += other.units;
+    kg += other.kg;
+    volume += other.volume;
+    return *this;
+}
+
+Capacity& Capacity::operator-=(const Capacity& other) {
+    units -= other.units;
+    kg = std::max(0.0, kg - other.kg);
+    volume = std::max(0.0, volume - other.volume);
+    return *this;
+}
+
+Capacity Capacity::operator*(size_t count) const {
+    return Capacity{units * count, kg * static_cast<double>(count), volume * static_cast<double>(count)};
+}
+
+size_t Capacity::fitCount(const Capacity& limits, const Capacity& used, const Capacity& unit) {
+    size_t by_units = unit.units == 0 ? std::numeric_limits<size_t>::max()
+                                      : (used.units >= limits.units ? 0 : (limits.units - used.units) / unit.units);
+    return std::min({by_units, fitDimension(limits.kg, used.kg, unit.kg),
+                     fitDimension(limits.volume, used.volume, unit.volume)});
+}
+
+double Capacity::fillRatio(const Capacity& limits, const Capacity& used) {
+    return std::max({ratio(static_cast<double>(used.units), static_cast<double>(limits.units)),
+                     ratio(used.kg, limits.kg), ratio(used.volume, limits.volume)});
+}
+
+std::pmr::vector<PackLoad> packLoads(std::span<const PackItem> items, const Capacity& limits,
+                                     std::pmr::memory_resource* memory) {
+    // Сначала самые «крупные» единицы, затем мелкие добивают остаток кузова
+    std::pmr::vector<size_t> order(memory);
+    std::pmr::vector<size_t> left(items.size(), 0, memory);
+    for (size_t i = 0; i < items.size(); ++i) {
+        left[i] = items[i].quantity;
+        if (left[i] > 0 && Capacity::fitCount(limits, Capacity{}, items[i].unit) > 0) {
+            order.push_back(i);
+        }
+    }
+    // Равные единицы остаются в исходном порядке; std::sort вместо stable_sort,
+    // который выделяет временный буфер в куче
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        double ra = Capacity::fillRatio(limits, items[a].unit);
+        double rb = Capacity::fillRatio(limits, items[b].unit);
+        return ra != rb ? ra > rb : a < b;
+    });
+
+    std::pmr::vector<PackLoad> loads(memory);
+    size_t pending = order.size();
+    while (pending > 0) {
+        PackLoad load(memory);
+        Capacity used;
+        for (size_t i : order) {
+            if (left[i] == 0) {
+                continue;
+            }
+            size_t take = std::min(left[i], Capacity::fitCount(limits, used, items[i].unit));
+            if (take == 0) {
+                continue;
+            }
+            load.emplace_back(i, take);
+            used += items[i].unit * take;
+            left[i] -= take;
+            if (left[i] == 0) {
+                --pending;
+            }
+        }
+        loads.push_back(std::move(load));
+    }
+    return loads;
+}
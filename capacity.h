@@ -0,0 +1,58 @@
+#ifndef CAPACITY_H
+#define CAPACITY_H
+
+#include <limits>
+#include <memory_resource>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Объём единицы продукции по типу упаковки, м³ (неизвестная упаковка - 0)
+double packagingVolume(std::string_view packaging);
+void setPackagingVolume(const std::string& packaging, double volume);
+
+// Вместимость или загрузка в нескольких измерениях: штуки, килограммы, объём.
+// Для ограничений бесконечность означает, что измерение не ограничено.
+struct Capacity {
+    static constexpr double kUnlimited = std::numeric_limits<double>::infinity();
+
+    size_t units = 0;
+    double kg = 0;
+    double volume = 0;
+
+    static Capacity limits(size_t units, double kg = kUnlimited, double volume = kUnlimited) {
+        return Capacity{units, kg, volume};
+    }
+    // Одна единица продукции с весом weight кг
+    static Capacity unit(double weight, std::string_view packaging) {
+        return Capacity{1, weight, packagingVolume(packaging)};
+    }
+
+    Capacity& operator+=(const Capacity& other);
+    Capacity& operator-=(const Capacity& other);
+    Capacity operator*(size_t count) const;
+
+    // Сколько единиц размером unit помещается в остаток limits - used
+    static size_t fitCount(const Capacity& limits, const Capacity& used, const Capacity& unit);
+    // Наибольшая доля заполнения по измерениям
+    static double fillRatio(const Capacity& limits, const Capacity& used);
+};
+
+struct PackItem {
+    std::string_view product_name; // строка принадлежит вызывающему
+    Capacity unit;
+    size_t quantity = 0;
+};
+
+// Раскладка позиций по кузовам с ограничением limits. Позиции делимы:
+// first-fit decreasing по наибольшей доле кузова, которую занимает единица.
+// Возвращает список загрузок, каждая - пары (номер позиции, количество).
+// Единицы, не помещающиеся даже в пустой кузов, пропускаются.
+// Результат и рабочие массивы размещаются в memory (например, в арене заказа).
+using PackLoad = std::pmr::vector<std::pair<size_t, size_t>>;
+std::pmr::vector<PackLoad> packLoads(std::span<const PackItem> items, const Capacity& limits,
+                                     std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+
+#endif // CAPACITY_H
@@ -0,0 +1,104 @@
+#ifndef CATALOG_H
+#define CATALOG_H
+
+#include <array>
+#include <cstddef>
+#include <limits>
+#include <string_view>
+#include "capacity.h"
+#include "sim_policies.h"
+
+// Каталог продуктов, известный при компиляции: для развёртываний с
+// фиксированным списком SKU. Номер продукта - позиция в каталоге, имя
+// превращается в номер при компиляции (constexpr id), вес и объём единицы
+// хранятся в самом каталоге, поэтому на складе с CatalogStorage остатки -
+// массив фиксированного размера без хеширования и сравнения строк.
+//
+//   constexpr ProductCatalog<2> kCatalog{{{{"Продукт A", 10.0, "Коробка", 0.05}, {"Продукт B", 2.0, "Мешок", 0.03}}}};
+//   static_assert(kCatalog.valid());
+//   constexpr ProductId kProductA = kCatalog.id("Продукт A");
+//   BasicWarehouse<NoLock, CatalogStorage<kCatalog>> warehouse("Склад", Capacity::limits(100));
+//   warehouse.store(kProductA, kCatalog.unit(kProductA), 10);
+
+struct CatalogItem {
+    std::string_view name;
+    double weight = 0;          // кг на единицу
+    std::string_view packaging;
+    double volume = 0;          // м³ на единицу; таблица packagingVolume для каталога не читается
+
+    constexpr Capacity unit() const { return Capacity{1, weight, volume}; }
+};
+
+template <size_t N>
+class ProductCatalog {
+public:
+    constexpr explicit ProductCatalog(const std::array<CatalogItem, N>& items) : items(items) {}
+
+    static constexpr size_t size() { return N; }
+    constexpr const CatalogItem& operator[](ProductId product) const { return items[product]; }
+    constexpr Capacity unit(ProductId product) const { return items[product].unit(); }
+
+    // Номер продукта по имени; kUnknownProduct - нет в каталоге.
+    // Для констант вычисляется при компиляции; во время работы - линейный поиск
+    constexpr ProductId id(std::string_view name) const {
+        for (size_t i = 0; i < N; ++i) {
+            if (items[i].name == name) {
+                return static_cast<ProductId>(i);
+            }
+        }
+        return kUnknownProduct;
+    }
+
+    // Имена непустые и не повторяются; проверяется через static_assert
+    constexpr bool valid() const {
+        for (size_t i = 0; i < N; ++i) {
+            if (items[i].name.empty()) {
+                return false;
+            }
+            for (size_t j = 0; j < i; ++j) {
+                if (items[i].name == items[j].name) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+private:
+    std::array<CatalogItem, N> items;
+};
+
+// Хранение инвентаря для каталога при компиляции: массив на все продукты
+// каталога, единицы заполнены из каталога заранее. Ячейки не перемещаются,
+// поэтому годится для ShardedLock; продукты вне каталога склад не принимает.
+template <const auto& Catalog>
+class CatalogStorage {
+public:
+    static constexpr bool kStableSlots = true;
+    static constexpr size_t kFixedProducts = Catalog.size();
+
+    CatalogStorage() {
+        for (size_t i = 0; i < kFixedProducts; ++i) {
+            entries[i].unit = Catalog.unit(static_cast<ProductId>(i));
+        }
+    }
+
+    void reserve(size_t) {}
+    // Ячейка есть у каждого продукта каталога: ещё не поступавший отдаёт нулевой остаток
+    StockEntry* find(ProductId product) { return product < kFixedProducts ? &entries[product] : nullptr; }
+    const StockEntry* find(ProductId product) const { return product < kFixedProducts ? &entries[product] : nullptr; }
+    StockEntry& slot(ProductId product) { return entries[product]; }
+    template <class F>
+    void forEach(F&& visit) {
+        for (size_t i = 0; i < kFixedProducts; ++i) {
+            if (entries[i].present) {
+                visit(static_cast<ProductId>(i), entries[i]);
+            }
+        }
+    }
+
+private:
+    std::array<StockEntry, kFixedProducts> entries;
+};
+
+#endif // CATALOG_H
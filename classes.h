@@ -1,13 +1,31 @@
 #ifndef CLASSES_H
 #define CLASSES_H
 
+#include <algorithm>
 #include <iostream>
 #include <map>
+#include <span>
 #include <vector>
 #include <string>
+#include <string_view>
 #include <thread>
 #include <atomic>
 #include <mutex>
+#include "availability_index.h"
+#include "capacity.h"
+#include "logging.h"
+#include "snapshot.h"
+#include "truck_manifest.h"
+#include "wal.h"
+
+class AvailabilityIndex;
+class BackorderQueue;
+class FleetStats;
+class Router;
+class SharedInventory;
+class StockHistory;
+class StockSeries;
+class Topology;
 
 class Product {
 public:
@@ -23,18 +41,125 @@ public:
     [[nodiscard]] std::string getName() const{return name;}
 };
 
+// Позиция, отгруженная со склада, без копий строк: имя и упаковка указывают
+// на запись инвентаря склада, которая живёт столько же, сколько склад
+struct UnloadedLine {
+    std::string_view name;
+    double weight = 0;
+    std::string_view packaging;
+    size_t quantity = 0;
+    bool durable = true; // false - Durability::Sync, а отгрузку журнал не подтвердил
+};
+
+// Итог строки заказа: сколько взято и с каких складов
+struct OrderLineResult {
+    std::string product;
+    size_t requested = 0;
+    size_t fulfilled = 0;
+    std::vector<std::pair<std::string, size_t>> sources; // склад -> взято единиц, в порядке обхода
+    uint64_t backorder = 0;                              // номер дозаказа на недостачу, 0 - не ставился
+    size_t shortfall() const { return requested - fulfilled; }
+};
+
+// Итог заказа вместо сообщений в консоль: строки в порядке названий продуктов
+struct OrderResult {
+    std::string shop;
+    std::string truck; // пусто - грузовика не нашлось, заказ не исполнялся
+    std::vector<OrderLineResult> lines;
+    size_t requested() const;
+    size_t fulfilled() const;
+    bool complete() const { return fulfilled() == requested(); }
+};
+
+// Остановка многоостановочного рейса: магазин и его строки заказа
+struct DropOff {
+    const std::string& shop_name;
+    const std::map<std::string, size_t>& requests;
+};
+
+// Состояние склада для снимка: LSN последней учтённой записи журнала и инвентарь
+struct WarehouseCheckpoint {
+    uint64_t lsn = 0;
+    std::vector<Product> products;
+};
+
+// Согласованный срез склада на один момент для отчётов
+struct InventorySnapshot {
+    uint64_t version = 0; // сколько изменений остатков учтено в срезе
+    Capacity load;
+    std::vector<Product> products; // в порядке имён
+};
+
+// Счётчики грузовика на один момент для отчётов
+struct TruckCounters {
+    uint64_t version = 0;
+    size_t total_delivered = 0;
+    size_t trips = 0;
+    Capacity load;
+    std::vector<std::pair<std::string, size_t>> delivered; // по продуктам, в порядке имён
+    std::vector<std::pair<std::string, size_t>> cargo;     // в кузове сейчас, в порядке загрузки
+    // Выгружено в каждый магазин за всё время: (магазин, строки по продуктам), в порядке имён магазинов
+    std::vector<std::pair<std::string, std::vector<std::pair<std::string, size_t>>>> dropped;
+    size_t untracked = 0; // единицы в кузове сверх строк манифеста (TruckManifest::kSlots)
+};
+
 class Warehouse {
 public:
     void startAutoUnload(std::vector<class Truck*>& trucks, const std::string& shop_name);
+    // Грузовики берутся из опубликованного состава сети; topology должна пережить проход
+    void startAutoUnload(const Topology& topology, const std::string& shop_name);
     Warehouse(const std::string& name, size_t capacity);
+    Warehouse(const std::string& name, const Capacity& limits);
     size_t getFreeSpace() const;
+    // Сколько единиц продукта помещается с учётом штук, веса и объёма. Продукт, который
+    // уже есть на складе, учитывается весом и упаковкой своей ячейки, а не партии
+    size_t fitCount(const Product& product) const;
+    Capacity getLoad() const;
+    Capacity getLimits() const { return limits(); }
+    // С Durability::Sync false и тогда, когда журнал не подтвердил запись: продукция уже
+    // на складе, но после сбоя может не восстановиться. При журнале в сбое Sync-операции
+    // склада отклоняются сразу, ничего не меняя
     bool storeProduct(const Product& product);
+    bool storeProduct(const Product& product, Durability durability);
+    // Размещение партии из многих продуктов за одну блокировку склада: каждая строка
+    // размещается, сколько поместится, и её quantity уменьшается на размещённое.
+    // Журнал ждёт диска один раз на партию. Возвращает количество размещённых единиц;
+    // durable, если задан, - подтвердил ли журнал партию
+    size_t storeManifest(std::span<Product> manifest);
+    size_t storeManifest(std::span<Product> manifest, Durability durability, bool* durable = nullptr);
     std::map<std::string, Product> unload(const std::string& product_name, size_t max_quantity);
+    std::map<std::string, Product> unload(const std::string& product_name, size_t max_quantity, Durability durability);
+    // То же без промежуточной карты и копий Product - для пути доставки
+    UnloadedLine take(const std::string& product_name, size_t max_quantity);
+    UnloadedLine take(const std::string& product_name, size_t max_quantity, Durability durability);
     std::string getName() const;
+    // Остаток без блокировки склада: последнее опубликованное значение
     size_t getProductQuantity(const std::string& product_name) const;
+    // Единица продукта на складе (штука, вес, объём упаковки); пустая, если продукта нет
+    Capacity unitOf(const std::string& product_name) const;
+    // Остатки и загрузка на один момент; не ждёт и не задерживает запись
+    InventorySnapshot snapshot() const;
     void printArrivalLog() const;
     bool isOverloaded() const;
     void autoUnload(std::vector<class Truck*>& trucks, const std::string& shop_name);
+    void autoUnload(const Topology& topology, const std::string& shop_name);
+
+    // Журналирование изменений инвентаря (durability - уровень по умолчанию)
+    void attachJournal(WriteAheadLog* wal, Durability durability = Durability::Sync);
+    WarehouseCheckpoint checkpoint() const;
+    // Очередь дозаказов, которые исполняются при поступлении продукции
+    void attachBackorders(BackorderQueue* queue) { backorders = queue; }
+    // Вызывается из AvailabilityIndex::registerWarehouse
+    void attachIndex(AvailabilityIndex* availability, uint32_t id);
+    AvailabilityIndex* getIndex() const { return index; }
+    uint32_t getIndexId() const { return index_id; }
+    // Зеркало остатков и загрузки в разделяемой памяти для других процессов
+    void attachShared(SharedInventory* segment, uint32_t id);
+    // История остатков: отсчёт на каждое изменение, начиная с текущих остатков
+    void attachHistory(StockHistory* store);
+    // Применение записей при восстановлении: без журнала, вывода в консоль и журнала поступлений
+    void replayStore(const Product& product);
+    void replayUnload(const std::string& product_name, size_t quantity);
 
 private:
     mutable std::mutex mtx;
@@ -45,63 +170,234 @@ private:
         ArrivalLogEntry(const std::string& factory_name, const std::string& product_name, size_t quantity)
                 : factory_name(factory_name), product_name(product_name), quantity(quantity) {}
     };
+    // Опубликованный остаток продукта; имя, вес и упаковка не меняются
+    struct StockSlot {
+        std::string name;
+        double weight;
+        std::string packaging;
+        std::atomic<size_t> quantity{0};
+        StockSeries* series = nullptr; // ряд в history; только под mtx
+        explicit StockSlot(const Product& product) : name(product.name), weight(product.weight), packaging(product.packaging) {}
+    };
 
     std::string name;
     size_t capacity;
     size_t current_load;
+    double max_kg = Capacity::kUnlimited;
+    double max_volume = Capacity::kUnlimited;
+    double load_kg = 0;
+    double load_volume = 0;
     std::map<std::string, Product> inventory;
-    std::vector<ArrivalLogEntry> arrival_log;
+    AppendLog<ArrivalLogEntry> arrival_log; // читается без mtx
+    // Публикация для читателей без mtx: остатки и загрузка меняются в
+    // stockChanged под stock_seq, слот продукта находится по stock_index
+    SeqCounter stock_seq;
+    AppendLog<StockSlot> stock_slots;
+    NameDirectory<StockSlot> stock_index;
+    std::atomic<size_t> published_units{0};
+    std::atomic<double> published_kg{0};
+    std::atomic<double> published_volume{0};
     std::atomic<bool> is_unloading{false};
+    WriteAheadLog* journal = nullptr;
+    Durability journal_durability = Durability::None;
+    BackorderQueue* backorders = nullptr;
+    AvailabilityIndex* index = nullptr;
+    uint32_t index_id = 0;
+    SharedInventory* shared = nullptr;
+    uint32_t shared_id = 0;
+    StockHistory* history = nullptr;
 
+    Capacity limits() const { return Capacity{capacity, max_kg, max_volume}; }
+    Capacity used() const { return Capacity{current_load, load_kg, load_volume}; }
+    // Под mtx: Sync-операцию можно начинать - журнал не в сбое; иначе сообщение в консоль
+    bool journalReady(Durability durability) const;
+    void releaseLoad(const Product& product, size_t quantity);
+    // Единица, которой партия занимает склад: вес и упаковка ячейки, если продукт уже есть
+    Capacity storeUnit(const Product& product) const;
+    void applyStore(const Product& product);
+    void stockChanged(const Product& entry);
     void recordArrival(const Product& product);
 };
 
 class Factory {
 public:
     Factory(const std::string& name, double weight, const std::string& packaging, int production_rate);
-    void storage(std::vector<Warehouse*>& warehouses);
+    // Завод со смешанным выпуском: за такт выпускает все строки output (quantity - единиц за такт)
+    // и размещает их партиями через Warehouse::storeManifest
+    Factory(const std::string& name, std::vector<Product> output);
+    // Возвращает количество размещённых единиц
+    size_t storage(const std::vector<Warehouse*>& warehouses);
+    // По складам, опубликованным в реестре на момент вызова
+    size_t storage(const Topology& topology);
     Product createProduct();
+    std::vector<Product> createManifest() const { return output; }
 
 private:
     std::string name;
-    double weight;
+    double weight = 0;
     std::string packaging;
-    int production_rate;
+    int production_rate = 0;
+    std::vector<Product> output;   // пусто - фабрика одного продукта
+    std::vector<Product> manifest; // партия текущего такта: остаток строк по мере размещения
+
+    size_t storeManifest(const std::vector<Warehouse*>& warehouses);
 };
 
 class Truck {
 public:
-    Truck(const std::string& name, size_t max_capacity);
-    void loadProduct(const std::string& product_name, size_t count);
+    Truck(const std::string& name, size_t max_capacity, double max_kg = Capacity::kUnlimited,
+          double max_volume = Capacity::kUnlimited);
+    void loadProduct(std::string_view product_name, size_t count);
     void unloadProduct(const std::string& shop_name);
-    void deliver(Warehouse* warehouse, const std::string& shop_name, const std::map<std::string, size_t>& requests);
-    void deliver(const std::vector<Warehouse*>& warehouses, const std::string& shop_name, const std::map<std::string, size_t>& requests);
+    // Доставка с одного склада; недостача, как и при доставке с нескольких складов, ставится в дозаказ
+    size_t deliver(Warehouse* warehouse, const std::string& shop_name, const std::map<std::string, size_t>& requests,
+                   int priority = 0);
+    // Исполнение дозаказа из BackorderQueue::onRestock: недостачу в очередь возвращает сама очередь
+    size_t deliverBackorder(Warehouse* warehouse, const std::string& shop_name, const std::string& product_name, size_t quantity);
+    // result, если задан, заполняется итогом заказа по строкам
+    void deliver(const std::vector<Warehouse*>& warehouses, const std::string& shop_name, const std::map<std::string, size_t>& requests,
+                 int priority = 0, OrderResult* result = nullptr);
+    void deliver(const Topology& topology, const std::string& shop_name, const std::map<std::string, size_t>& requests,
+                 int priority = 0, OrderResult* result = nullptr);
+    // Рейс по нескольким магазинам: строки всех остановок грузятся за одну загрузку,
+    // затем выгружаются в порядке остановок - один рейс на весь маршрут.
+    // Что не поместилось в кузов или не нашлось на складах, ставится в дозаказ. Возвращает доставленное
+    size_t deliverTour(const std::vector<Warehouse*>& warehouses, std::span<const DropOff> stops);
+    // Недостача по заказу ставится в очередь дозаказов вместо того, чтобы теряться
+    void attachBackorders(BackorderQueue* queue) { backorders = queue; }
+    // Индекс наличия вместо опроса getProductQuantity на каждом складе
+    void attachIndex(const AvailabilityIndex* availability) { index = availability; }
+    // Маршрутизатор: склады для заказа выбираются от ближайшего к магазину
+    void attachRouter(const Router* roads) { router = roads; }
+    // Итоги сети: каждая доставленная строка учитывается по продукту, складу, грузовику и магазину
+    void attachStats(FleetStats* fleet);
+    // Доставка в обход deliver (авторазгрузка склада) - только в итогах сети
+    void recordDelivery(std::string_view warehouse, std::string_view product, std::string_view shop_name, size_t quantity);
     void printStatistics() const;
     size_t getCapacity() {return max_capacity;}
-    size_t getCurrentLoad() const { return product_count; } // Add this method
+    size_t getCurrentLoad() const { return published_count.load(std::memory_order_relaxed); } // Add this method
+    Capacity getLimits() const { return Capacity{max_capacity, max_kg, max_volume}; }
+    // Сколько единиц продукта ещё помещается в кузов по всем измерениям
+    size_t fitCount(const Product& product) const {
+        return Capacity::fitCount(getLimits(), Capacity{product_count, load_kg, load_volume},
+                                  Capacity::unit(product.weight, product.packaging));
+    }
     std::string getName(){return name;}
+    size_t getTotalDelivered() const { return published_delivered.load(std::memory_order_relaxed); }
+    size_t getTrips() const { return published_trips.load(std::memory_order_relaxed); }
+    // Счётчики на один момент без блокировки грузовика
+    TruckCounters counters() const;
 
     void addProduct(const std::string& product_name, size_t count) {
         if (product_count + count <= max_capacity) {
             product_count += count;
             total_delivered += count; // Увеличиваем общее количество доставленного
-            delivered_products[product_name] += count; // Увеличиваем количество доставленного конкретного продукта
+            publishCounters(product_name, count, count); // и количество доставленного конкретного продукта
 
-            std::cout << "Загружено " << count << " ед. продукта " << product_name << " в грузовик " << name << ".\n";
+            console() << "Загружено " << count << " ед. продукта " << product_name << " в грузовик " << name << ".\n";
         } else {
-            std::cout << "Ошибка: не хватает места в грузовике " << name << " для загрузки " << count << " ед. продукта " << product_name << ".\n";
+            console() << "Ошибка: не хватает места в грузовике " << name << " для загрузки " << count << " ед. продукта " << product_name << ".\n";
+        }
+    }
+
+    // Загрузка с учётом веса и объёма: product.quantity - количество единиц
+    void addProduct(const Product& product) { addUnits(product, product.quantity); }
+
+    // Загрузка count единиц продукта без копирования Product
+    void addUnits(const Product& product, size_t count) {
+        if (fitCount(product) < count) {
+            console() << "Ошибка: грузовик " << name << " перегружен по весу или объёму для " << count
+                      << " ед. продукта " << product.name << ".\n";
+            return;
         }
+        // Вес и объём до addProduct: счётчики публикуются в нём одним изменением
+        load_kg += product.weight * static_cast<double>(count);
+        load_volume += packagingVolume(product.packaging) * static_cast<double>(count);
+        addProduct(product.name, count);
     }
 
     mutable std::mutex mtx;
 private:
     std::string name;
     size_t max_capacity;
+    double max_kg;
+    double max_volume;
+    double load_kg = 0;
+    double load_volume = 0;
     size_t product_count;
     size_t total_delivered;
-    std::map<std::string, size_t> loadedProducts;
-    std::map<std::string, size_t> delivered_products;
+    size_t trips = 0;
+    // Доставлено по продуктам: слоты читаются в counters() под counters_seq.
+    // Номер слота - номер продукта грузовика в манифесте кузова
+    struct DeliveredSlot {
+        std::string name;
+        uint32_t id;
+        std::atomic<size_t> quantity{0};
+        DeliveredSlot(std::string_view product, uint32_t id) : name(product), id(id) {}
+    };
+    AppendLog<DeliveredSlot, 64> delivered_slots;
+    NameDirectory<DeliveredSlot> delivered_products;
+    SeqCounter counters_seq;
+    std::atomic<size_t> published_count{0};
+    std::atomic<size_t> published_delivered{0};
+    std::atomic<size_t> published_trips{0};
+    std::atomic<double> published_kg{0};
+    std::atomic<double> published_volume{0};
+    TruckManifest cargo; // что в кузове; меняется под counters_seq
+    // Выгруженное в магазин за всё время, строки - номера продуктов грузовика, как в cargo.
+    // Записи магазинов только дописываются и читаются в counters() под counters_seq
+    struct ShopDrop {
+        std::string name;
+        TruckManifest drained;
+        explicit ShopDrop(std::string_view shop) : name(shop) {}
+    };
+    AppendLog<ShopDrop, 16> drop_log;
+    NameDirectory<ShopDrop> drop_shops;
     std::map<std::string, size_t> delivery_count;
+    BackorderQueue* backorders = nullptr;
+    const AvailabilityIndex* index = nullptr;
+    // Склады последнего списка deliver в разрезе индекса наличия. Пересчитываются, только когда
+    // меняется список (сравнивается с копией) или регистрация складов в индексе
+    struct IndexedSites {
+        const AvailabilityIndex* index = nullptr;
+        uint64_t registry = 0;
+        std::vector<Warehouse*> list;
+        WarehouseSet allowed;                                // склады списка, зарегистрированные в индексе
+        std::vector<Warehouse*> by_id;                       // номер в индексе -> склад списка
+        std::vector<size_t> position;                        // номер в индексе -> позиция в списке
+        std::vector<std::pair<Warehouse*, size_t>> unindexed; // склады вне индекса и их позиции
+    } indexed_sites;
+    const IndexedSites& indexedSites(const std::vector<Warehouse*>& warehouses);
+    const Router* router = nullptr;
+    FleetStats* fleet_stats = nullptr;
+    uint32_t fleet_id = 0; // номер грузовика в разрезе StatDimension::Truck
+
+    // Учитывает взятые со склада единицы в счётчиках грузовика, итогах сети и строке итога заказа
+    void countDelivered(const Warehouse* from, const std::string& product_name, const std::string& shop_name, size_t quantity,
+                        OrderLineResult* line = nullptr);
+    void dispatchLoads(std::span<const UnloadedLine> picked, const std::string& shop_name);
+    // Строка выгрузки рейса по нескольким магазинам
+    struct DroppedLine {
+        std::string_view shop;
+        std::string_view product;
+        size_t quantity;
+    };
+    // Кузов выгружен: весь в магазин shop_name или, если задан dropped, по его строкам.
+    // Счётчики загрузки обнуляются, рейс учитывается
+    void finishTrip(std::string_view shop_name, std::span<const DroppedLine> dropped = {});
+    ShopDrop& shopDrop(std::string_view shop_name);
+    size_t deliverFrom(Warehouse* warehouse, const std::string& shop_name, const std::map<std::string, size_t>& requests,
+                       int priority, bool backorder_shortfall);
+    // Сообщение о недостаче и дозаказ на неё, если подключена очередь; номер дозаказа - в строку итога
+    void backorderShortfall(const std::string& shop_name, const std::string& product_name, size_t requested, size_t shortfall,
+                            int priority, OrderLineResult* line = nullptr);
+    // Единица продукта со склада помещается хотя бы в пустой кузов; иначе - предупреждение в консоль
+    bool fitsEmpty(const Warehouse* warehouse, const std::string& product_name) const;
+    // Публикует счётчики для counters(); delivered единиц product учитываются в статистике по продуктам,
+    // loaded - в манифесте кузова
+    void publishCounters(std::string_view product = {}, size_t delivered = 0, size_t loaded = 0);
+    // Общие счётчики грузовика; вызывается внутри записи counters_seq
+    void publishTotals();
 };
 
 #endif // CLASSES_H
@@ -0,0 +1,122 @@
+#include "epoch.h"
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+// Запись потока-читателя. Записи не удаляются: поток при завершении
+// возвращает свою в список, и её берёт следующий новый поток.
+struct ThreadRecord {
+    std::atomic<uint64_t> state{0}; // 0 - вне области, иначе (эпоха << 1) | 1
+    std::atomic<bool> in_use{false};
+    ThreadRecord* next = nullptr;
+};
+
+std::atomic<ThreadRecord*> records{nullptr};
+std::atomic<uint64_t> global_epoch{1};
+
+struct Retired {
+    void* object;
+    epoch::Destroy destroy;
+    uint64_t epoch;
+};
+
+std::mutex limbo_mtx;
+std::vector<Retired> limbo;
+
+ThreadRecord* acquireRecord() {
+    for (ThreadRecord* r = records.load(std::memory_order_acquire); r; r = r->next) {
+        bool expected = false;
+        if (!r->in_use.load(std::memory_order_relaxed) && r->in_use.compare_exchange_strong(expected, true)) {
+            return r;
+        }
+    }
+    auto* record = new ThreadRecord;
+    record->in_use.store(true, std::memory_order_relaxed);
+    record->next = records.load(std::memory_order_relaxed);
+    while (!records.compare_exchange_weak(record->next, record, std::memory_order_release, std::memory_order_relaxed)) {
+    }
+    return record;
+}
+
+struct ThreadSlot {
+    ThreadRecord* record = nullptr;
+    size_t depth = 0;
+    ~ThreadSlot() {
+        if (record) {
+            record->state.store(0, std::memory_order_release);
+            record->in_use.store(false, std::memory_order_release);
+        }
+    }
+};
+
+thread_local ThreadSlot slot;
+
+} // namespace
+
+EpochGuard::EpochGuard() {
+    if (slot.depth++ > 0) {
+        return; // эпоха уже закреплена внешней областью
+    }
+    if (!slot.record) {
+        slot.record = acquireRecord();
+    }
+    // Если эпоха успела уйти вперёд до записи, читатель просто держит её продвижение:
+    // всё, что он прочитает после записи, уже не может быть освобождено
+    uint64_t current = global_epoch.load(std::memory_order_seq_cst);
+    slot.record->state.store((current << 1) | 1, std::memory_order_seq_cst);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+EpochGuard::~EpochGuard() {
+    if (--slot.depth == 0) {
+        slot.record->state.store(0, std::memory_order_release);
+    }
+}
+
+namespace epoch {
+
+void retire(void* object, Destroy destroy) {
+    std::lock_guard<std::mutex> lock(limbo_mtx);
+    limbo.push_back({object, destroy, global_epoch.load(std::memory_order_seq_cst)});
+}
+
+size_t collect() {
+    std::vector<Retired> ready;
+    {
+        std::lock_guard<std::mutex> lock(limbo_mtx);
+        uint64_t current = global_epoch.load(std::memory_order_seq_cst);
+        bool all_seen = true;
+        for (ThreadRecord* r = records.load(std::memory_order_acquire); r && all_seen; r = r->next) {
+            uint64_t state = r->state.load(std::memory_order_seq_cst);
+            all_seen = !(state & 1) || (state >> 1) == current;
+        }
+        if (all_seen) {
+            global_epoch.store(++current, std::memory_order_seq_cst);
+        }
+        // Через две эпохи после retire не осталось читателей, которые могли видеть объект
+        auto keep = limbo.begin();
+        for (auto it = limbo.begin(); it != limbo.end(); ++it) {
+            if (it->epoch + 2 <= current) {
+                ready.push_back(*it);
+            } else {
+                *keep++ = *it;
+            }
+        }
+        limbo.erase(keep, limbo.end());
+    }
+    for (const auto& item : ready) {
+        item.destroy(item.object);
+    }
+    return ready.size();
+}
+
+size_t pending() {
+    std::lock_guard<std::mutex> lock(limbo_mtx);
+    return limbo.size();
+}
+
+} // namespace epoch
@@ -0,0 +1,43 @@
+#ifndef EPOCH_H
+#define EPOCH_H
+
+#include <cstddef>
+
+// Освобождение по эпохам (epoch-based reclamation) для объектов, которые
+// читатели обходят без блокировок. Читатель закрепляет эпоху на время
+// обхода (EpochGuard); писатель сначала убирает объект из опубликованных
+// структур, потом передаёт его в retire. Объект освобождается, когда
+// глобальная эпоха продвинулась на две от момента retire: к этому времени
+// все читатели, которые могли его видеть, вышли из своих областей.
+namespace epoch {
+
+using Destroy = void (*)(void*);
+
+// Отложенное освобождение: destroy(object) вызовется в одном из collect()
+void retire(void* object, Destroy destroy);
+
+template <typename T>
+void retire(const T* object) {
+    retire(const_cast<T*>(object), [](void* p) { delete static_cast<T*>(p); });
+}
+
+// Продвигает эпоху, если все читатели её видели, и освобождает
+// то, что уже никто не может читать. Возвращает число освобождённых объектов.
+size_t collect();
+// Ожидающие освобождения объекты
+size_t pending();
+
+} // namespace epoch
+
+// Область чтения: пока она открыта, объекты, увиденные в ней, не освобождаются.
+// Вложенные области в одном потоке допустимы; держать область долго нельзя -
+// это задерживает освобождение во всём процессе.
+class EpochGuard {
+public:
+    EpochGuard();
+    ~EpochGuard();
+    EpochGuard(const EpochGuard&) = delete;
+    EpochGuard& operator=(const EpochGuard&) = delete;
+};
+
+#endif // EPOCH_H
@@ -0,0 +1,231 @@
+// Нагрузочный клиент для FGBU --serve: поток заказов и партий производства
+// из WorkloadGenerator по нескольким соединениям с конвейером запросов.
+// FGBU_client <путь сокета> [запросов] [соединений] [глубина конвейера]
+
+#include "protocol.h"
+#include "workload.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct ClientTotals {
+    std::atomic<uint64_t> orders{0};
+    std::atomic<uint64_t> requested{0};
+    std::atomic<uint64_t> delivered{0};
+    std::atomic<uint64_t> produced{0};
+    std::atomic<uint64_t> placed{0};
+    std::atomic<uint64_t> shed{0}; // ответ Overloaded
+    std::atomic<uint64_t> failed{0};
+};
+
+// Задержки соединения: все ответы и отдельно заказы по классам
+struct Latencies {
+    std::vector<double> all;
+    std::array<std::vector<double>, kOrderClasses> orders;
+};
+
+// Смесь классов заказов: 10% Express, 60% Standard, 30% Bulk
+OrderClass classOf(uint64_t id) {
+    uint64_t bucket = id % 10;
+    return bucket == 0 ? OrderClass::Express : bucket < 7 ? OrderClass::Standard : OrderClass::Bulk;
+}
+
+int connectTo(const std::string& path) {
+    sockaddr_un addr{};
+    if (path.size() >= sizeof(addr.sun_path)) {
+        return -1;
+    }
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd >= 0 && connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool sendAll(int fd, const std::string& data) {
+    size_t offset = 0;
+    while (offset < data.size()) {
+        ssize_t n = send(fd, data.data() + offset, data.size() - offset, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        offset += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// Одно соединение: держит в полёте до depth запросов
+void runConnection(const std::string& path, uint64_t seed, size_t quota, size_t depth, ClientTotals& totals,
+                   Latencies& latencies) {
+    int fd = connectTo(path);
+    if (fd < 0) {
+        totals.failed.fetch_add(quota);
+        return;
+    }
+    WorkloadConfig config;
+    config.seed = seed;
+    WorkloadGenerator generator(config);
+
+    std::vector<Clock::time_point> sent_at(quota);
+    std::vector<bool> is_order(quota);
+    std::vector<std::pair<std::string_view, uint32_t>> lines;
+    std::string out;
+    std::string in;
+    char buffer[64 * 1024];
+    size_t sent = 0;
+    size_t received = 0;
+    latencies.all.reserve(quota);
+
+    while (received < quota) {
+        out.clear();
+        while (sent < quota && sent - received < depth) {
+            WorkloadEvent event = generator.nextEvent();
+            if (event.is_order) {
+                lines.clear();
+                for (uint32_t i = 0; i < event.order.line_count; ++i) {
+                    lines.emplace_back(generator.productName(event.order.lines[i].product), event.order.lines[i].quantity);
+                }
+                if (!encodeOrder(out, sent, generator.shopName(event.order.shop), lines, classOf(sent))) {
+                    continue; // имя длиннее, чем допускает протокол: запрос не отправляется
+                }
+            } else {
+                ProductionMessage production{generator.productName(event.production.product), 10.0, "Коробка",
+                                             event.production.quantity};
+                if (!encodeProduction(out, sent, production)) {
+                    continue;
+                }
+            }
+            is_order[sent] = event.is_order;
+            sent_at[sent] = Clock::now();
+            ++sent;
+        }
+        if (!out.empty() && !sendAll(fd, out)) {
+            break;
+        }
+
+        ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        in.append(buffer, static_cast<size_t>(n));
+        size_t offset = 0;
+        Response response;
+        size_t consumed = 0;
+        while (decodeResponse(in.data() + offset, in.size() - offset, consumed, response) == DecodeStatus::Ok) {
+            offset += consumed;
+            if (response.id >= quota) {
+                continue;
+            }
+            auto now = Clock::now();
+            double latency = std::chrono::duration<double, std::micro>(now - sent_at[response.id]).count();
+            latencies.all.push_back(latency);
+            if (is_order[response.id]) {
+                latencies.orders[static_cast<size_t>(classOf(response.id))].push_back(latency);
+                totals.orders.fetch_add(1, std::memory_order_relaxed);
+                totals.requested.fetch_add(response.requested, std::memory_order_relaxed);
+                totals.delivered.fetch_add(response.completed, std::memory_order_relaxed);
+            } else {
+                totals.produced.fetch_add(response.requested, std::memory_order_relaxed);
+                totals.placed.fetch_add(response.completed, std::memory_order_relaxed);
+            }
+            if (response.status == ResponseStatus::Overloaded) {
+                totals.shed.fetch_add(1, std::memory_order_relaxed);
+            } else if (response.status != ResponseStatus::Ok) {
+                totals.failed.fetch_add(1, std::memory_order_relaxed);
+            }
+            ++received;
+        }
+        in.erase(0, offset);
+    }
+    if (received < quota) {
+        totals.failed.fetch_add(quota - received);
+    }
+    close(fd);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cout << "Использование: FGBU_client <путь сокета> [запросов] [соединений] [глубина конвейера]\n";
+        return 1;
+    }
+    std::string path = argv[1];
+    size_t requests = argc >= 3 ? std::stoul(argv[2]) : 200000;
+    size_t connections = argc >= 4 ? std::max<size_t>(1, std::stoul(argv[3])) : 4;
+    size_t depth = argc >= 5 ? std::max<size_t>(1, std::stoul(argv[4])) : 64;
+
+    ClientTotals totals;
+    std::vector<Latencies> latencies(connections);
+    std::vector<std::thread> pool;
+    auto start = Clock::now();
+    for (size_t c = 0; c < connections; ++c) {
+        size_t quota = requests / connections + (c < requests % connections ? 1 : 0);
+        pool.emplace_back(runConnection, path, 1 + c, quota, depth, std::ref(totals), std::ref(latencies[c]));
+    }
+    for (auto& t : pool) {
+        t.join();
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::vector<double> all;
+    std::array<std::vector<double>, kOrderClasses> orders;
+    for (auto& part : latencies) {
+        all.insert(all.end(), part.all.begin(), part.all.end());
+        for (size_t c = 0; c < kOrderClasses; ++c) {
+            orders[c].insert(orders[c].end(), part.orders[c].begin(), part.orders[c].end());
+        }
+    }
+    std::sort(all.begin(), all.end());
+    for (auto& part : orders) {
+        std::sort(part.begin(), part.end());
+    }
+    auto quantile = [](const std::vector<double>& sorted, double q) {
+        return sorted.empty() ? 0.0 : sorted[static_cast<size_t>(q * static_cast<double>(sorted.size() - 1))];
+    };
+    auto at = [&](double q) { return quantile(all, q); };
+
+    std::cout << "Запросов: " << all.size() << " за " << seconds << " с, " << static_cast<double>(all.size()) / seconds
+              << " запросов/с\n";
+    std::cout << "Задержка, мкс: p50=" << at(0.5) << ", p99=" << at(0.99) << ", max=" << at(1.0) << "\n";
+    std::cout << "Заказов: " << totals.orders << ", выполнено "
+              << (totals.requested ? 100.0 * static_cast<double>(totals.delivered) / static_cast<double>(totals.requested) : 100.0)
+              << "% спроса; размещено " << totals.placed << " из " << totals.produced << " ед. продукции\n";
+    const char* class_names[kOrderClasses] = {"Express", "Standard", "Bulk"};
+    for (size_t c = 0; c < kOrderClasses; ++c) {
+        std::cout << class_names[c] << ": " << orders[c].size() << " заказов, p50=" << quantile(orders[c], 0.5)
+                  << ", p99=" << quantile(orders[c], 0.99) << " мкс\n";
+    }
+    if (totals.shed) {
+        std::cout << "Отклонено при перегрузке: " << totals.shed << "\n";
+    }
+    if (totals.failed) {
+        std::cout << "Без ответа или с ошибкой: " << totals.failed << "\n";
+    }
+    return totals.failed ? 1 : 0;
+}
@@ -0,0 +1,189 @@
+#include "fleet_stats.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace {
+
+// Номер потока для выбора шарда. Номера плотные: поток при завершении
+// возвращает свой, и его получает следующий новый поток, поэтому шард
+// одновременно пишет только один поток, а число шардов не растёт с каждым
+// std::thread авторазгрузки.
+std::mutex slot_mtx;
+std::vector<size_t> free_slots;
+size_t next_slot = 0;
+
+struct ThreadSlot {
+    static constexpr size_t kNone = SIZE_MAX;
+    size_t index = kNone;
+    ~ThreadSlot() {
+        if (index != kNone) {
+            std::lock_guard<std::mutex> lock(slot_mtx);
+            free_slots.push_back(index);
+        }
+    }
+    size_t get() {
+        if (index == kNone) {
+            std::lock_guard<std::mutex> lock(slot_mtx);
+            if (free_slots.empty()) {
+                index = next_slot++;
+            } else {
+                index = free_slots.back();
+                free_slots.pop_back();
+            }
+        }
+        return index;
+    }
+};
+
+thread_local ThreadSlot thread_slot;
+
+} // namespace
+
+FleetStats::Shard::~Shard() {
+    for (auto& dimension : chunks) {
+        for (auto& chunk : dimension) {
+            delete[] chunk.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void FleetStats::Shard::add(size_t dimension, uint32_t id, size_t quantity, uint32_t day) {
+    if (id >= kCellsPerChunk * kMaxChunks) {
+        return;
+    }
+    std::atomic<Cell*>& chunk = chunks[dimension][id / kCellsPerChunk];
+    Cell* cells = chunk.load(std::memory_order_relaxed);
+    if (!cells) {
+        cells = new Cell[kCellsPerChunk];
+        chunk.store(cells, std::memory_order_release);
+    }
+    Cell& cell = cells[id % kCellsPerChunk];
+    // Писатель у шарда один: хватает загрузки и записи без RMW
+    cell.total.store(cell.total.load(std::memory_order_relaxed) + quantity, std::memory_order_relaxed);
+
+    const uint32_t tag = day + 1;
+    std::atomic<uint32_t>& bucket_tag = cell.day_tag[day % kDays];
+    std::atomic<uint64_t>& bucket = cell.day_units[day % kDays];
+    uint32_t current = bucket_tag.load(std::memory_order_relaxed);
+    if (current > tag) {
+        return; // корзину уже занял более новый день, запоздавшая запись идёт только в итог
+    }
+    if (current < tag) {
+        bucket.store(0, std::memory_order_relaxed);
+        bucket_tag.store(tag, std::memory_order_release);
+    }
+    bucket.store(bucket.load(std::memory_order_relaxed) + quantity, std::memory_order_relaxed);
+}
+
+uint64_t FleetStats::Shard::read(size_t dimension, uint32_t id, uint32_t day) const {
+    if (id >= kCellsPerChunk * kMaxChunks) {
+        return 0;
+    }
+    const Cell* cells = chunks[dimension][id / kCellsPerChunk].load(std::memory_order_acquire);
+    if (!cells) {
+        return 0;
+    }
+    const Cell& cell = cells[id % kCellsPerChunk];
+    if (day == kAllTime) {
+        return cell.total.load(std::memory_order_relaxed);
+    }
+    const uint32_t tag = day + 1;
+    const std::atomic<uint32_t>& bucket_tag = cell.day_tag[day % kDays];
+    if (bucket_tag.load(std::memory_order_acquire) != tag) {
+        return 0;
+    }
+    uint64_t units = cell.day_units[day % kDays].load(std::memory_order_relaxed);
+    // Корзину могли отдать новому дню, пока читали: тогда прочитанное не относится к day
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return bucket_tag.load(std::memory_order_relaxed) == tag ? units : 0;
+}
+
+FleetStats::FleetStats() = default;
+
+FleetStats::~FleetStats() {
+    for (auto& shard : shards) {
+        delete shard.load(std::memory_order_relaxed);
+    }
+}
+
+uint32_t FleetStats::today() {
+    auto now = std::chrono::system_clock::now();
+    return static_cast<uint32_t>(std::chrono::floor<std::chrono::days>(now).time_since_epoch().count());
+}
+
+uint32_t FleetStats::intern(StatDimension dimension, std::string_view name) {
+    Names& table = names[static_cast<size_t>(dimension)];
+    if (const Name* found = table.index.find(name)) {
+        return found->id;
+    }
+    std::lock_guard<std::mutex> lock(intern_mtx);
+    if (const Name* found = table.index.find(name)) {
+        return found->id;
+    }
+    Name& added = table.log.emplace_back(name, static_cast<uint32_t>(table.log.size()));
+    table.index.insert(&added);
+    return added.id;
+}
+
+DeliveryKey FleetStats::key(std::string_view product, std::string_view warehouse, std::string_view truck,
+                            std::string_view shop) {
+    return {intern(StatDimension::Product, product), intern(StatDimension::Warehouse, warehouse),
+            intern(StatDimension::Truck, truck), intern(StatDimension::Shop, shop)};
+}
+
+FleetStats::Shard& FleetStats::localShard(size_t slot) {
+    Shard* shard = shards[slot].load(std::memory_order_relaxed); // создаёт и пишет только этот поток
+    if (!shard) {
+        shard = new Shard;
+        shards[slot].store(shard, std::memory_order_release);
+        size_t used = shards_used.load(std::memory_order_relaxed);
+        while (used < slot + 1 && !shards_used.compare_exchange_weak(used, slot + 1, std::memory_order_release)) {
+        }
+    }
+    return *shard;
+}
+
+void FleetStats::record(const DeliveryKey& key, size_t quantity, uint32_t day) {
+    if (quantity == 0) {
+        return;
+    }
+    auto write = [&](Shard& shard) {
+        shard.add(static_cast<size_t>(StatDimension::Product), key.product, quantity, day);
+        shard.add(static_cast<size_t>(StatDimension::Warehouse), key.warehouse, quantity, day);
+        shard.add(static_cast<size_t>(StatDimension::Truck), key.truck, quantity, day);
+        shard.add(static_cast<size_t>(StatDimension::Shop), key.shop, quantity, day);
+    };
+    size_t slot = thread_slot.get();
+    if (slot < kMaxThreads) {
+        write(localShard(slot));
+    } else {
+        std::lock_guard<std::mutex> lock(overflow_mtx);
+        write(overflow);
+    }
+}
+
+uint64_t FleetStats::sum(size_t dimension, uint32_t id, uint32_t day) const {
+    uint64_t result = overflow.read(dimension, id, day);
+    size_t used = shards_used.load(std::memory_order_acquire);
+    for (size_t i = 0; i < used; ++i) {
+        if (const Shard* shard = shards[i].load(std::memory_order_acquire)) {
+            result += shard->read(dimension, id, day);
+        }
+    }
+    return result;
+}
+
+uint64_t FleetStats::delivered(StatDimension dimension, std::string_view name, uint32_t day) const {
+    const Name* found = names[static_cast<size_t>(dimension)].index.find(name);
+    return found ? sum(static_cast<size_t>(dimension), found->id, day) : 0;
+}
+
+std::vector<std::pair<std::string, uint64_t>> FleetStats::ranking(StatDimension dimension, uint32_t day) const {
+    std::vector<std::pair<std::string, uint64_t>> result;
+    names[static_cast<size_t>(dimension)].log.forEach([&](const Name& entry) {
+        result.emplace_back(entry.name, sum(static_cast<size_t>(dimension), entry.id, day));
+    });
+    std::stable_sort(result.begin(), result.end(), [](const auto& a, const auto& b) { return a.second > b.second; });
+    return result;
+}
@@ -0,0 +1,109 @@
+#ifndef FLEET_STATS_H
+#define FLEET_STATS_H
+
+#include "snapshot.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Разрез статистики доставок
+enum class StatDimension : uint8_t {
+    Product,
+    Warehouse,
+    Truck,
+    Shop
+};
+
+// Строка доставки после интернирования имён
+struct DeliveryKey {
+    uint32_t product = 0;
+    uint32_t warehouse = 0;
+    uint32_t truck = 0;
+    uint32_t shop = 0;
+};
+
+// Итоги доставок по всей сети: по продуктам, складам, грузовикам и магазинам,
+// всего и по дням. Каждый поток пишет в свой шард без общих блокировок и
+// атомарных RMW; чтение складывает шарды, поэтому запрос вида «сколько
+// продукта X доставлено сегодня» стоит O(потоков), а не обход всех грузовиков.
+// Имена интернируются в плотные номера, счётчики лежат в блоках по номеру.
+class FleetStats {
+public:
+    static constexpr size_t kDimensions = 4;
+    static constexpr size_t kDays = 8;                     // корзин по дням: сегодня и неделя назад
+    static constexpr uint32_t kAllTime = UINT32_MAX;       // вместо дня - итог за всё время
+    static constexpr size_t kCellsPerChunk = 256;
+    static constexpr size_t kMaxChunks = 1024;             // до 262144 имён в разрезе
+    static constexpr size_t kMaxThreads = 1024;            // потоков со своим шардом одновременно
+
+    FleetStats();
+    ~FleetStats();
+    FleetStats(const FleetStats&) = delete;
+    FleetStats& operator=(const FleetStats&) = delete;
+
+    // Номер текущего дня (UTC) для корзин
+    static uint32_t today();
+
+    // Номер имени в разрезе; стабилен на всё время жизни статистики
+    uint32_t intern(StatDimension dimension, std::string_view name);
+    DeliveryKey key(std::string_view product, std::string_view warehouse, std::string_view truck, std::string_view shop);
+
+    void record(const DeliveryKey& key, size_t quantity, uint32_t day);
+    void record(std::string_view product, std::string_view warehouse, std::string_view truck, std::string_view shop,
+                size_t quantity) {
+        record(key(product, warehouse, truck, shop), quantity, today());
+    }
+
+    // Доставлено по имени разреза за день (kAllTime - за всё время); неизвестное имя - 0.
+    // Видны записи, завершённые до вызова; дни старше kDays уже не хранятся
+    uint64_t delivered(StatDimension dimension, std::string_view name, uint32_t day = kAllTime) const;
+    uint64_t deliveredToday(StatDimension dimension, std::string_view name) const {
+        return delivered(dimension, name, today());
+    }
+    // Все имена разреза с итогами, по убыванию итога
+    std::vector<std::pair<std::string, uint64_t>> ranking(StatDimension dimension, uint32_t day = kAllTime) const;
+
+private:
+    // Счётчики одного имени в одном шарде. Корзина дня помечена номером дня + 1
+    // (0 - пусто) и переиспользуется, когда по кругу приходит новый день
+    struct Cell {
+        std::atomic<uint64_t> total{0};
+        std::array<std::atomic<uint32_t>, kDays> day_tag{};
+        std::array<std::atomic<uint64_t>, kDays> day_units{};
+    };
+    // Пишет один поток (или держатель overflow_mtx); читают все
+    struct Shard {
+        std::array<std::array<std::atomic<Cell*>, kMaxChunks>, kDimensions> chunks{};
+        ~Shard();
+        void add(size_t dimension, uint32_t id, size_t quantity, uint32_t day);
+        uint64_t read(size_t dimension, uint32_t id, uint32_t day) const;
+    };
+    struct Name {
+        std::string name;
+        uint32_t id;
+        Name(std::string_view text, uint32_t number) : name(text), id(number) {}
+    };
+    struct Names {
+        AppendLog<Name> log;
+        NameDirectory<Name> index;
+    };
+
+    std::array<Names, kDimensions> names;
+    std::mutex intern_mtx; // добавление имён; поиск без блокировки
+
+    std::array<std::atomic<Shard*>, kMaxThreads> shards{};
+    std::atomic<size_t> shards_used{0};  // верхняя граница занятых номеров
+    std::mutex overflow_mtx;
+    Shard overflow;                      // потоки сверх kMaxThreads пишут сюда по очереди
+
+    Shard& localShard(size_t slot);
+    uint64_t sum(size_t dimension, uint32_t id, uint32_t day) const;
+};
+
+#endif // FLEET_STATS_H
@@ -0,0 +1,101 @@
+#ifndef FULFILMENT_H
+#define FULFILMENT_H
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+#include "capacity.h"
+
+// Алгоритмы размещения, авторазгрузки и сбора заказа, общие для живых
+// Warehouse/Truck/Factory (classes.h) и шаблонных BasicWarehouse/BasicTruck/BasicFactory
+// (basic_warehouse.h). Классы отличаются хранением, блокировками, журналом и выводом,
+// а решения - какой склад, сколько единиц, в каком порядке - принимаются здесь.
+
+// Размещение партии фабрики: целиком на первый склад, где она помещается, иначе по частям.
+// fit_count(warehouse) - сколько единиц ещё помещается, store(warehouse, quantity, whole) -
+// размещение (whole - вся партия одним вызовом). Возвращает число размещённых единиц.
+template <class Warehouse, class FitCount, class Store>
+size_t placeBatch(const std::vector<Warehouse*>& warehouses, size_t quantity, FitCount&& fit_count, Store&& store) {
+    for (Warehouse* warehouse : warehouses) {
+        if (fit_count(warehouse) >= quantity && store(warehouse, quantity, true)) {
+            return quantity;
+        }
+    }
+    size_t remaining = quantity;
+    for (Warehouse* warehouse : warehouses) {
+        if (remaining == 0) {
+            break;
+        }
+        size_t free_space = fit_count(warehouse);
+        if (free_space > 0) {
+            size_t part = std::min(remaining, free_space);
+            if (store(warehouse, part, false)) {
+                remaining -= part;
+            }
+        }
+    }
+    return quantity - remaining;
+}
+
+// Загрузка одного кузова при авторазгрузке (first-fit decreasing): сначала продукты,
+// единица которых занимает большую долю кузова, равные - в порядке tie_less.
+// order - контейнер продуктов склада, unit_of(entry) - их единица, load(entry) грузит что
+// помещается и возвращает число единиц, overloaded() - склад всё ещё выше порога.
+// std::sort, а не stable_sort: тот берёт временный буфер из кучи мимо арены.
+// Возвращает true, если в кузов что-то погружено.
+template <class Order, class UnitOf, class TieLess, class Load, class Overloaded>
+bool fillTruck(Order& order, const Capacity& truck_limits, UnitOf&& unit_of, TieLess&& tie_less, Load&& load,
+               Overloaded&& overloaded) {
+    using Entry = typename Order::value_type;
+    std::sort(order.begin(), order.end(), [&](const Entry& a, const Entry& b) {
+        double ra = Capacity::fillRatio(truck_limits, unit_of(a));
+        double rb = Capacity::fillRatio(truck_limits, unit_of(b));
+        return ra != rb ? ra > rb : tie_less(a, b);
+    });
+    bool loaded = false;
+    for (Entry& entry : order) {
+        if (load(entry) == 0) {
+            continue; // места под эту единицу в кузове нет
+        }
+        loaded = true;
+        if (!overloaded()) {
+            break;
+        }
+    }
+    return loaded;
+}
+
+// Сбор заказа со складов. Сначала среди candidates (любой диапазон указателей на склады) ищется
+// склад, где хватает всего заказа (can_fulfill): с него берутся все строки. Иначе каждая строка
+// собирается по складам: sources(line, visit) перечисляет склады-источники в порядке обхода,
+// visit(warehouse, available) возвращает false, когда строка собрана. take(warehouse, i, line, quantity)
+// берёт до quantity единиц i-й строки и возвращает взятое; line_done(i, line, remaining) получает
+// несобранный остаток строки - в обоих случаях: и склад, где хватало всего заказа, могли опустошить параллельно.
+// quantity_of(line) - запрошенное количество. Возвращает true, если заказ собран с одного склада.
+template <class Candidates, class Requests, class QuantityOf, class CanFulfill, class Sources, class Take, class LineDone>
+bool gatherOrder(const Candidates& candidates, const Requests& requests, QuantityOf&& quantity_of,
+                 CanFulfill&& can_fulfill, Sources&& sources, Take&& take, LineDone&& line_done) {
+    for (auto* warehouse : candidates) {
+        if (can_fulfill(warehouse)) {
+            size_t i = 0;
+            for (const auto& line : requests) {
+                size_t quantity = quantity_of(line);
+                line_done(i, line, quantity - take(warehouse, i, line, quantity));
+                ++i;
+            }
+            return true;
+        }
+    }
+    size_t i = 0;
+    for (const auto& line : requests) {
+        size_t remaining = quantity_of(line);
+        sources(line, [&](auto* warehouse, size_t available) {
+            remaining -= take(warehouse, i, line, std::min(available, remaining));
+            return remaining > 0;
+        });
+        line_done(i++, line, remaining);
+    }
+    return false;
+}
+
+#endif // FULFILMENT_H
@@ -0,0 +1,35 @@
+#include "logging.h"
+
+#include <iostream>
+
+std::mutex coutMutex;
+
+namespace {
+
+thread_local std::ostream* current = &std::cout;
+
+} // namespace
+
+std::ostream& console() {
+    return *current;
+}
+
+std::ostream& nullConsole() {
+    // Поток без буфера сразу в состоянии badbit, форматирование пропускается
+    thread_local std::ostream null(nullptr);
+    return null;
+}
+
+ScopedConsole::ScopedConsole(std::ostream& out) : previous(current) {
+    current = &out;
+}
+
+ScopedConsole::~ScopedConsole() {
+    current = previous;
+}
+
+ConsoleLock::ConsoleLock() {
+    if (current == &std::cout) {
+        lock = std::unique_lock<std::mutex>(coutMutex);
+    }
+}
@@ -0,0 +1,34 @@
+#ifndef LOGGING_H
+#define LOGGING_H
+
+#include <mutex>
+#include <ostream>
+
+// Поток вывода сообщений текущего потока. По умолчанию std::cout;
+// симуляции подменяют его, чтобы прогоны не делили консоль и coutMutex.
+std::ostream& console();
+// Поток, который отбрасывает всё, что в него пишут
+std::ostream& nullConsole();
+
+// Подмена потока вывода на время жизни объекта (только для текущего потока)
+class ScopedConsole {
+public:
+    explicit ScopedConsole(std::ostream& out);
+    ~ScopedConsole();
+    ScopedConsole(const ScopedConsole&) = delete;
+    ScopedConsole& operator=(const ScopedConsole&) = delete;
+
+private:
+    std::ostream* previous;
+};
+
+// Блокировка вывода: общий мьютекс берётся, только если пишем в std::cout
+class ConsoleLock {
+public:
+    ConsoleLock();
+
+private:
+    std::unique_lock<std::mutex> lock;
+};
+
+#endif // LOGGING_H
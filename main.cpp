@@ -1,8 +1,32 @@
 #include "classes.h"
+#include "arena.h"
+#include "availability_index.h"
+#include "backorder.h"
+#include "basic_warehouse.h"
+#include "benchmark.h"
+#include "catalog.h"
+#include "fleet_stats.h"
+#include "fulfilment.h"
+#include "order_dispatcher.h"
+#include "order_server.h"
+#include "perf_counters.h"
+#include "rebalance.h"
+#include "route_planner.h"
+#include "routing.h"
+#include "shared_inventory.h"
+#include "stock_history.h"
+#include "sweep.h"
+#include "timer_wheel.h"
+#include "topology.h"
+#include "workload.h"
+
+#include <csignal>
+#include <filesystem>
+#include <future>
+#include <memory>
+#include <random>
 
 
-std::mutex coutMutex;
-
 Product::Product(const std::string& name, double weight, const std::string& packaging, size_t quantity)
         : name(name), weight(weight), packaging(packaging), quantity(quantity) {}
 
@@ -11,43 +35,185 @@ Product::Product() : name(""), weight(0), packaging(""), quantity(0) {}
 Warehouse::Warehouse(const std::string& name, size_t capacity)
         : name(name), capacity(capacity), current_load(0) {}
 
+Warehouse::Warehouse(const std::string& name, const Capacity& limits)
+        : name(name), capacity(limits.units), current_load(0), max_kg(limits.kg), max_volume(limits.volume) {}
+
 size_t Warehouse::getFreeSpace() const {
     return capacity - current_load;
 }
 
+size_t Warehouse::fitCount(const Product& product) const {
+    // Опубликованная загрузка: фабрики прикидывают место без блокировки склада
+    return Capacity::fitCount(limits(), getLoad(), storeUnit(product));
+}
+
+Capacity Warehouse::storeUnit(const Product& product) const {
+    // Вес и упаковка ячейки не меняются после её создания, а releaseLoad списывает по ним:
+    // партия с другой единицей учитывается так же, иначе загрузка склада разъезжается
+    const StockSlot* slot = stock_index.find(product.name);
+    return slot ? Capacity::unit(slot->weight, slot->packaging) : Capacity::unit(product.weight, product.packaging);
+}
+
+Capacity Warehouse::getLoad() const {
+    Capacity load;
+    uint64_t seq;
+    do {
+        seq = stock_seq.readBegin();
+        load = Capacity{published_units.load(std::memory_order_relaxed), published_kg.load(std::memory_order_relaxed),
+                        published_volume.load(std::memory_order_relaxed)};
+    } while (stock_seq.readRetry(seq));
+    return load;
+}
+
+bool Warehouse::journalReady(Durability durability) const {
+    if (!journal || durability != Durability::Sync || journal->healthy()) {
+        return true;
+    }
+    console() << "Ошибка: журнал склада " << name << " в сбое, синхронная операция отклонена.\n";
+    return false;
+}
+
 bool Warehouse::storeProduct(const Product& product) {
-    size_t free_space = getFreeSpace();
-    if (product.quantity > free_space) {
+    return storeProduct(product, journal_durability);
+}
+
+bool Warehouse::storeProduct(const Product& product, Durability durability) {
+    uint64_t lsn = 0;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (!journalReady(durability)) {
+            return false;
+        }
+        size_t free_space = fitCount(product);
+        if (product.quantity > free_space) {
+
+            console() << "Предупреждение: недостаточно места для продукта " << product.name
+                      << " на складе " << name << ". Запрашиваемое количество: " << product.quantity
+                      << ", доступно: " << free_space << "\n";
+            return false;
+        }
+        applyStore(product);
+        recordArrival(product); // Записываем поступление продукции
+        if (journal && durability != Durability::None) {
+            lsn = journal->append(WalRecordType::Store, name, product);
+        }
 
-        std::cout << "Предупреждение: недостаточно места для продукта " << product.name
-                  << " на складе " << name << ". Запрашиваемое количество: " << product.quantity
-                  << ", доступно: " << free_space << "\n";
-        return false;
+        console() << "Продукция добавлена на склад " << name << ": " << product.name
+                  << " - " << product.quantity << " ед.\n";
     }
-    current_load += product.quantity;
-    inventory[product.name] = product;
-    recordArrival(product); // Записываем поступление продукции
+    bool durable = !lsn || journal->commit(lsn, durability); // ждём fsync уже без блокировки склада
+    if (!durable) {
+        console() << "Ошибка: журнал не подтвердил поступление " << product.name << " на склад " << name << ".\n";
+    }
+    if (backorders) {
+        backorders->onRestock(this, product.name, product.quantity); // поступление будит ожидающие дозаказы
+    }
+    return durable;
+}
 
-    std::cout << "Продукция добавлена на склад " << name << ": " << product.name
-              << " - " << product.quantity << " ед.\n";
-    return true;
+size_t Warehouse::storeManifest(std::span<Product> manifest) {
+    return storeManifest(manifest, journal_durability);
+}
+
+size_t Warehouse::storeManifest(std::span<Product> manifest, Durability durability, bool* durable) {
+    uint64_t lsn = 0;
+    size_t placed = 0;
+    std::vector<std::pair<const std::string*, size_t>> restocked; // продукт и поступившее количество
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (!journalReady(durability)) {
+            if (durable) {
+                *durable = false;
+            }
+            return 0;
+        }
+        for (Product& line : manifest) {
+            size_t requested = line.quantity;
+            size_t amount = std::min(requested, Capacity::fitCount(limits(), used(), storeUnit(line)));
+            if (amount == 0) {
+                continue;
+            }
+            // Строка партии размещается как есть, без копии Product: quantity на время - размещаемая часть
+            line.quantity = amount;
+            applyStore(line);
+            recordArrival(line);
+            if (journal && durability != Durability::None) {
+                lsn = journal->append(WalRecordType::Store, name, line);
+            }
+            line.quantity = requested - amount;
+            placed += amount;
+            restocked.emplace_back(&line.name, amount);
+        }
+        if (placed > 0) {
+            console() << "Партия добавлена на склад " << name << ": " << restocked.size() << " продуктов, " << placed
+                      << " ед.\n";
+        }
+    }
+    bool committed = !lsn || journal->commit(lsn, durability); // LSN последней строки: надёжны и все предыдущие
+    if (!committed) {
+        console() << "Ошибка: журнал не подтвердил партию на складе " << name << ".\n";
+    }
+    if (durable) {
+        *durable = committed;
+    }
+    if (backorders) {
+        for (const auto& [product_name, amount] : restocked) {
+            backorders->onRestock(this, *product_name, amount);
+        }
+    }
+    return placed;
 }
 
 std::map<std::string, Product> Warehouse::unload(const std::string& product_name, size_t max_quantity) {
+    return unload(product_name, max_quantity, journal_durability);
+}
+
+std::map<std::string, Product> Warehouse::unload(const std::string& product_name, size_t max_quantity, Durability durability) {
     std::map<std::string, Product> load;
+    UnloadedLine taken = take(product_name, max_quantity, durability);
+    if (taken.quantity > 0) {
+        load[product_name] = Product(product_name, taken.weight, std::string(taken.packaging), taken.quantity);
+    }
+    return load;
+}
+
+UnloadedLine Warehouse::take(const std::string& product_name, size_t max_quantity) {
+    return take(product_name, max_quantity, journal_durability);
+}
+
+UnloadedLine Warehouse::take(const std::string& product_name, size_t max_quantity, Durability durability) {
+    PerfScope profile(ProfileRegion::WarehouseUnload);
+    UnloadedLine load;
     size_t total_units = 0;
-    auto it = inventory.find(product_name);
-    if (it != inventory.end()) {
-        size_t quantity_to_take = std::min(it->second.quantity, max_quantity);
-        if (quantity_to_take > 0) {
-            load[product_name] = Product(product_name, it->second.weight, it->second.packaging, quantity_to_take);
-            it->second.quantity -= quantity_to_take; // Уменьшаем количество
-            current_load -= quantity_to_take; // Уменьшаем текущую загрузку
-            total_units += quantity_to_take;
+    uint64_t lsn = 0;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (!journalReady(durability)) {
+            load.durable = false;
+            return load;
+        }
+        auto it = inventory.find(product_name);
+        if (it != inventory.end()) {
+            size_t quantity_to_take = std::min(it->second.quantity, max_quantity);
+            if (quantity_to_take > 0) {
+                // Узлы инвентаря не удаляются, поэтому строки записи переживают заказ
+                load = UnloadedLine{it->second.name, it->second.weight, it->second.packaging, quantity_to_take};
+                it->second.quantity -= quantity_to_take; // Уменьшаем количество
+                releaseLoad(it->second, quantity_to_take); // Уменьшаем текущую загрузку
+                total_units += quantity_to_take;
+                stockChanged(it->second);
+            }
+        }
+        if (journal && durability != Durability::None && total_units > 0) {
+            lsn = journal->append(WalRecordType::Unload, name, product_name, total_units);
         }
-    }
 
-    std::cout << "Склад" <<" " <<name << " "<<"отгружен на " << total_units << " ед. продукта " << product_name << ".\n";
+        console() << "Склад" <<" " <<name << " "<<"отгружен на " << total_units << " ед. продукта " << product_name << ".\n";
+    }
+    if (lsn && !journal->commit(lsn, durability)) {
+        load.durable = false;
+        console() << "Ошибка: журнал не подтвердил отгрузку " << product_name << " со склада " << name << ".\n";
+    }
     return load;
 }
 
@@ -56,25 +222,51 @@ std::string Warehouse::getName() const {
 }
 
 size_t Warehouse::getProductQuantity(const std::string& product_name) const {
-    auto it = inventory.find(product_name);
-    return (it != inventory.end()) ? it->second.quantity : 0;
+    const StockSlot* slot = stock_index.find(product_name);
+    return slot ? slot->quantity.load(std::memory_order_acquire) : 0;
+}
+
+Capacity Warehouse::unitOf(const std::string& product_name) const {
+    // Вес и упаковка ячейки не меняются после её создания, поэтому читаются без блокировки
+    const StockSlot* slot = stock_index.find(product_name);
+    return slot ? Capacity::unit(slot->weight, slot->packaging) : Capacity{};
+}
+
+InventorySnapshot Warehouse::snapshot() const {
+    InventorySnapshot snap;
+    uint64_t seq;
+    do {
+        // Повтор, только если за время копирования склад успел измениться
+        seq = stock_seq.readBegin();
+        snap.products.clear();
+        snap.load = Capacity{published_units.load(std::memory_order_relaxed), published_kg.load(std::memory_order_relaxed),
+                             published_volume.load(std::memory_order_relaxed)};
+        stock_slots.forEach([&](const StockSlot& slot) {
+            snap.products.emplace_back(slot.name, slot.weight, slot.packaging, slot.quantity.load(std::memory_order_relaxed));
+        });
+    } while (stock_seq.readRetry(seq));
+    snap.version = seq / 2;
+    std::sort(snap.products.begin(), snap.products.end(),
+              [](const Product& a, const Product& b) { return a.name < b.name; });
+    return snap;
 }
 
 void Warehouse::printArrivalLog() const {
 
-    std::cout << "Журнал поступления продукции на склад " << name << ":\n";
-    for (const auto& entry : arrival_log) {
+    console() << "Журнал поступления продукции на склад " << name << ":\n";
+    arrival_log.forEach([](const ArrivalLogEntry& entry) {
 
-        std::cout << "Фабрика: " << entry.factory_name << ", Продукт: " << entry.product_name
+        console() << "Фабрика: " << entry.factory_name << ", Продукт: " << entry.product_name
                   << ", Количество: " << entry.quantity << "\n";
-    }
+    });
 }
 
 bool Warehouse::isOverloaded() const {
-    double fill_percentage = static_cast<double>(current_load) / capacity * 100;
+    // Склад перегружен, если заполнено любое из измерений: штуки, вес или объём
+    double fill_percentage = Capacity::fillRatio(limits(), used()) * 100;
     if (fill_percentage >= 95.0) {
 
-        std::cout << "Склад " << name << " загружен на " << fill_percentage << "% или более.\n";
+        console() << "Склад " << name << " загружен на " << fill_percentage << "% или более.\n";
         return true;
     }
     return false;
@@ -85,18 +277,45 @@ void Warehouse::startAutoUnload(std::vector<Truck*>& trucks, const std::string&
     if (!is_unloading && isOverloaded()) {   // проверка перегрузки склада
         is_unloading = true;                 // установка флага авторазгрузки
         lock.unlock();                       // отпускаем блокировку перед запуском потока
-        std::thread(&Warehouse::autoUnload, this, std::ref(trucks), shop_name).detach();
+        std::thread([this, &trucks, shop_name] { autoUnload(trucks, shop_name); }).detach();
+    }
+}
+
+void Warehouse::startAutoUnload(const Topology& topology, const std::string& shop_name) {
+    std::unique_lock<std::mutex> lock(mtx);
+    if (is_unloading || !isOverloaded()) {
+        return;
     }
+    is_unloading = true;
+    lock.unlock();
+    // Поток закрепляет эпоху до возврата: склад не освободится, даже если его
+    // выведут из сети сразу после вызова
+    std::promise<void> pinned;
+    std::future<void> started = pinned.get_future();
+    std::thread([this, &topology, shop_name, pinned = std::move(pinned)]() mutable {
+        Topology::Reader fleet(topology);
+        pinned.set_value();
+        std::vector<Truck*> trucks = fleet.trucks(); // autoUnload сортирует список - своя копия
+        autoUnload(trucks, shop_name);
+    }).detach();
+    started.wait();
 }
 
+void Warehouse::autoUnload(const Topology& topology, const std::string& shop_name) {
+    Topology::Reader fleet(topology);
+    std::vector<Truck*> trucks = fleet.trucks();
+    autoUnload(trucks, shop_name);
+}
 
 void Warehouse::autoUnload(std::vector<Truck*>& trucks, const std::string& shop_name) {
     {
-        std::lock_guard<std::mutex> coutLock(coutMutex);
-        std::cout << "--- начало авторазгрузки для склада"<< name <<  "---\n";
+        ConsoleLock coutLock;
+        console() << "--- начало авторазгрузки для склада"<< name <<  "---\n";
     }
 
     std::unique_lock<std::mutex> lock(mtx); // Блокировка склада на время авторазгрузки
+    ArenaScope arena;                       // временные списки прохода - из арены потока
+    uint64_t lsn = 0;
 
     // Сортируем грузовики по их текущей загруженности
     std::sort(trucks.begin(), trucks.end(), [](Truck* a, Truck* b) {
@@ -108,53 +327,180 @@ void Warehouse::autoUnload(std::vector<Truck*>& trucks, const std::string& shop_
             break; // Прерываем, если склад уже не перегружен
         }
 
+        // Порядок блокировок доставки - грузовик, затем склад (Truck::deliver -> take). Здесь склад
+        // уже заблокирован, поэтому грузовик только пробуем: занятый доставкой пропускается
+        std::unique_lock<std::mutex> truckLock(truck->mtx, std::try_to_lock);
+        if (!truckLock.owns_lock()) {
+            continue;
+        }
+
+        // Заполняем кузов целиком (first-fit decreasing, fillTruck): сначала продукты,
+        // единица которых занимает большую долю кузова, мелкие добивают остаток.
+        // Равные единицы - в порядке имён, как в инвентаре
+        std::pmr::vector<Product*> order(orderArena());
         for (auto& productEntry : inventory) {
-            Product& product = productEntry.second;
-            size_t availableAmount = product.getQuantity();
+            if (productEntry.second.getQuantity() > 0) {
+                order.push_back(&productEntry.second);
+            }
+        }
+        bool loaded = fillTruck(
+                order, truck->getLimits(), [](const Product* p) { return Capacity::unit(p->weight, p->packaging); },
+                [](const Product* a, const Product* b) { return a->name < b->name; },
+                [&](Product* entry) {
+                    Product& product = *entry;
+                    size_t unloadAmount = std::min(product.getQuantity(), truck->fitCount(product));
+                    if (unloadAmount == 0) {
+                        return unloadAmount; // Если места в грузовике нет, переходим к следующему продукту
+                    }
+
+                    // Отгружаем продукты
+                    product.decreaseQuantity(unloadAmount);
+                    releaseLoad(product, unloadAmount);
+                    stockChanged(product);
+                    if (journal && journal_durability != Durability::None) {
+                        lsn = journal->append(WalRecordType::Unload, name, product.name, unloadAmount);
+                    }
+
+                    // Обновляем грузовик
+                    truck->addUnits(product, unloadAmount);
+                    truck->recordDelivery(name, product.name, shop_name, unloadAmount);
+
+                    ConsoleLock coutLock;
+                    console() << "Склад отгружен на " << unloadAmount << " ед. продукта " << product.name
+                              << " для грузовика " << truck->getName() << ".\n";
+                    return unloadAmount;
+                },
+                [&] { return isOverloaded(); }); // Прерываем, когда склад уже не перегружен
+
+        if (loaded) {
+            truck->unloadProduct(shop_name); // Один рейс на заполненный кузов
+        }
+    }
 
-            std::unique_lock<std::mutex> truckLock(truck->mtx); // Блокировка для операций с грузовиком
+    lock.unlock();
+    if (lsn && !journal->commit(lsn, journal_durability)) { // одна синхронизация на весь проход
+        ConsoleLock coutLock;
+        console() << "Ошибка: журнал не подтвердил авторазгрузку склада " << name << ".\n";
+    }
 
-            size_t spaceInTruck = truck->getCapacity() - truck->getCurrentLoad();
+    {
+        ConsoleLock coutLock;
+        console() << "--- конец авторазгрузки для склада"<< name <<  "---\n";
+    }
 
-            if (availableAmount == 0 || spaceInTruck == 0) {
-                continue; // Если продукта или места в грузовике нет, переходим к следующему
-            }
+    is_unloading = false; // Сброс состояния авторазгрузки
+}
 
-            size_t unloadAmount = std::min(availableAmount, spaceInTruck);
 
-            if (unloadAmount == 0) {
-                continue;
-            }
+void Warehouse::attachJournal(WriteAheadLog* wal, Durability durability) {
+    std::lock_guard<std::mutex> lock(mtx);
+    journal = wal;
+    journal_durability = wal ? durability : Durability::None;
+}
 
-            // Отгружаем продукты
-            product.decreaseQuantity(unloadAmount);
-            current_load -= unloadAmount;
+WarehouseCheckpoint Warehouse::checkpoint() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    WarehouseCheckpoint cp;
+    // Записи этого склада добавляются под mtx, поэтому всё до lsn уже в инвентаре
+    cp.lsn = journal ? journal->lastLsn() : 0;
+    cp.products.reserve(inventory.size());
+    for (const auto& entry : inventory) {
+        cp.products.push_back(entry.second);
+    }
+    return cp;
+}
 
-            // Обновляем грузовик
-            truck->addProduct(product.getName(), unloadAmount);
+void Warehouse::replayStore(const Product& product) {
+    std::lock_guard<std::mutex> lock(mtx);
+    applyStore(product);
+}
 
-            {
-                std::lock_guard<std::mutex> coutLock(coutMutex);
-                std::cout << "Склад отгружен на " << unloadAmount << " ед. продукта " << product.getName()
-                          << " для грузовика " << truck->getName() << ".\n";
-            }
+void Warehouse::replayUnload(const std::string& product_name, size_t quantity) {
+    std::lock_guard<std::mutex> lock(mtx);
+    auto it = inventory.find(product_name);
+    if (it != inventory.end()) {
+        size_t quantity_to_take = std::min(it->second.quantity, quantity);
+        it->second.quantity -= quantity_to_take;
+        releaseLoad(it->second, quantity_to_take);
+        stockChanged(it->second);
+    }
+}
 
-            truck->unloadProduct(shop_name);
+void Warehouse::releaseLoad(const Product& product, size_t quantity) {
+    Capacity released = Capacity::unit(product.weight, product.packaging) * quantity;
+    current_load -= quantity;
+    load_kg = std::max(0.0, load_kg - released.kg);
+    load_volume = std::max(0.0, load_volume - released.volume);
+}
 
-            if (!isOverloaded()) {
-                break; // Прерываем, если склад уже не перегружен
-            }
-        }
+void Warehouse::applyStore(const Product& product) {
+    Capacity added = storeUnit(product) * product.quantity;
+    current_load += product.quantity;
+    load_kg += added.kg;
+    load_volume += added.volume;
+    auto it = inventory.find(product.name);
+    if (it != inventory.end()) {
+        it->second.quantity += product.quantity; // Партия добавляется к остатку, а не заменяет его
+    } else {
+        it = inventory.emplace(product.name, product).first;
+    }
+    stockChanged(it->second);
+}
+
+void Warehouse::attachIndex(AvailabilityIndex* availability, uint32_t id) {
+    std::lock_guard<std::mutex> lock(mtx);
+    index = availability;
+    index_id = id;
+    for (const auto& entry : inventory) {
+        stockChanged(entry.second);
     }
+}
 
-    {
-        std::lock_guard<std::mutex> coutLock(coutMutex);
-        std::cout << "--- конец авторазгрузки для склада"<< name <<  "---\n";
+void Warehouse::attachShared(SharedInventory* segment, uint32_t id) {
+    std::lock_guard<std::mutex> lock(mtx);
+    shared = segment;
+    shared_id = id;
+    for (const auto& entry : inventory) {
+        stockChanged(entry.second);
     }
+}
 
-    is_unloading = false; // Сброс состояния авторазгрузки
+void Warehouse::attachHistory(StockHistory* store) {
+    std::lock_guard<std::mutex> lock(mtx);
+    history = store;
+    for (const auto& entry : inventory) {
+        stockChanged(entry.second);
+    }
 }
 
+// Вызывается под mtx после каждого изменения остатка; entry - запись инвентаря
+void Warehouse::stockChanged(const Product& entry) {
+    stock_seq.writeBegin();
+    StockSlot* slot = stock_index.find(entry.name);
+    if (!slot) {
+        slot = &stock_slots.emplace_back(entry); // новый продукт
+        stock_index.insert(slot);
+    }
+    slot->quantity.store(entry.quantity, std::memory_order_relaxed);
+    published_units.store(current_load, std::memory_order_relaxed);
+    published_kg.store(load_kg, std::memory_order_relaxed);
+    published_volume.store(load_volume, std::memory_order_relaxed);
+    stock_seq.writeEnd();
+
+    if (index) {
+        index->update(index_id, entry.name, entry.quantity);
+    }
+    if (shared && !shared->publish(shared_id, entry.name, entry.weight, entry.packaging, entry.quantity, used())) {
+        console() << "Ошибка: остаток продукта " << entry.name << " склада " << name
+                  << " не отражён в разделяемой памяти.\n";
+    }
+    if (history) {
+        if (!slot->series) {
+            slot->series = history->series(name, entry.name);
+        }
+        history->record(*slot->series, StockHistory::now(), entry.quantity);
+    }
+}
 
 void Warehouse::recordArrival(const Product& product) {
     arrival_log.emplace_back("Фабрика", product.name, product.quantity); // Записываем поступление
@@ -164,42 +510,61 @@ void Warehouse::recordArrival(const Product& product) {
 Factory::Factory(const std::string& name, double weight, const std::string& packaging, int production_rate)
         : name(name), weight(weight), packaging(packaging), production_rate(production_rate) {}
 
-void Factory::storage(std::vector<Warehouse*>& warehouses) {
-    Product product = createProduct();
-    size_t remaining_quantity = product.quantity;
+size_t Factory::storage(const Topology& topology) {
+    Topology::Reader sites(topology);
+    return storage(sites.warehouses());
+}
 
-    // Сначала пытаемся найти склад, который может вместить весь продукт
-    for (auto& warehouse : warehouses) {
-        if (warehouse->getFreeSpace() >= remaining_quantity) {
-            if (warehouse->storeProduct(product)) {
+Factory::Factory(const std::string& name, std::vector<Product> output) : name(name), output(std::move(output)) {}
 
-                std::cout << "Продукт " << product.name << " полностью размещен на складе " << warehouse->getName() << "\n";
-                return; // Продукт успешно размещен
-            }
-        }
+size_t Factory::storage(const std::vector<Warehouse*>& warehouses) {
+    PerfScope profile(ProfileRegion::FactoryStorage);
+    if (!output.empty()) {
+        return storeManifest(warehouses);
     }
+    Product product = createProduct();
 
-    // Если не вмещается, распределяем по частям
-    for (auto& warehouse : warehouses) {
-        if (remaining_quantity == 0) {
-            break;
-        }
-
-        size_t free_space = warehouse->getFreeSpace();
-        if (free_space > 0) {
-            size_t quantity_to_store = std::min(remaining_quantity, free_space);
-            Product partial_product = Product(product.name, product.weight, product.packaging, quantity_to_store);
-            if (warehouse->storeProduct(partial_product)) {
-                remaining_quantity -= quantity_to_store;
-            }
-        }
-    }
+    // Сначала пытаемся найти склад, который может вместить весь продукт, иначе распределяем по частям
+    size_t placed = placeBatch(
+            warehouses, product.quantity, [&](Warehouse* warehouse) { return warehouse->fitCount(product); },
+            [&](Warehouse* warehouse, size_t quantity, bool whole) {
+                if (!whole) {
+                    return warehouse->storeProduct(Product(product.name, product.weight, product.packaging, quantity));
+                }
+                if (!warehouse->storeProduct(product)) {
+                    return false;
+                }
+                console() << "Продукт " << product.name << " полностью размещен на складе " << warehouse->getName() << "\n";
+                return true; // Продукт успешно размещен
+            });
+    size_t remaining_quantity = product.quantity - placed;
 
     if (remaining_quantity > 0) {
 
-        std::cout << "Не удалось сохранить всю продукцию " << product.name
+        console() << "Не удалось сохранить всю продукцию " << product.name
                   << ": остаток " << remaining_quantity << " ед.\n";
     }
+    return placed;
+}
+
+size_t Factory::storeManifest(const std::vector<Warehouse*>& warehouses) {
+    manifest = output; // присваивание переиспользует строки прошлого такта
+    size_t produced = 0;
+    for (const auto& line : manifest) {
+        produced += line.quantity;
+    }
+    // Остаток партии переходит на следующий склад, пока всё не размещено
+    size_t placed = 0;
+    for (auto* warehouse : warehouses) {
+        if (placed == produced) {
+            break;
+        }
+        placed += warehouse->storeManifest(manifest);
+    }
+    if (placed < produced) {
+        console() << "Завод " << name << ": не удалось разместить " << produced - placed << " ед. из " << produced << "\n";
+    }
+    return placed;
 }
 
 Product Factory::createProduct() {
@@ -207,17 +572,18 @@ Product Factory::createProduct() {
 }
 
 // Truck implementations
-Truck::Truck(const std::string& name, size_t max_capacity)
-        : name(name), max_capacity(max_capacity), product_count(0), total_delivered(0) {}
+Truck::Truck(const std::string& name, size_t max_capacity, double max_kg, double max_volume)
+        : name(name), max_capacity(max_capacity), max_kg(max_kg), max_volume(max_volume), product_count(0), total_delivered(0) {}
 
-void Truck::loadProduct(const std::string& product_name, size_t count) {
+void Truck::loadProduct(std::string_view product_name, size_t count) {
     if (product_count + count <= max_capacity) {
         product_count += count;
+        publishCounters(product_name, 0, count);
 
-        std::cout << "Загружено " << count << " ед. продукта " << product_name << " в грузовик " << name << ".\n";
+        console() << "Загружено " << count << " ед. продукта " << product_name << " в грузовик " << name << ".\n";
     } else {
 
-        std::cout << "Ошибка: не хватает места в грузовике " << name << " для загрузки " << count << " ед. продукта " << product_name << ".\n";
+        console() << "Ошибка: не хватает места в грузовике " << name << " для загрузки " << count << " ед. продукта " << product_name << ".\n";
     }
 }
 
@@ -228,108 +594,1215 @@ void Truck::unloadProduct(const std::string& shop_name) {
     // Логика выгрузки в магазин
 
 
-    std::cout << "Грузовик " << name << " выгружает продукцию в магазин " << shop_name << ".\n";
+    console() << "Грузовик " << name << " выгружает продукцию в магазин " << shop_name << ".\n";
+    finishTrip(shop_name);
+}
+
+void Truck::finishTrip(std::string_view shop_name, std::span<const DroppedLine> dropped) {
     product_count = 0; // После выгрузки грузовик пуст
+    ++trips;
+    load_kg = 0;
+    load_volume = 0;
+    // Записи магазинов создаются до записи счётчиков: в ней только меняются их строки
+    ShopDrop* whole = dropped.empty() ? &shopDrop(shop_name) : nullptr;
+    for (const auto& line : dropped) {
+        shopDrop(line.shop);
+    }
+    counters_seq.writeBegin();
+    if (whole) {
+        // Единицы сверх строк манифеста (untracked) по продуктам не известны и в запись магазина не попадают
+        for (size_t i = 0; i < cargo.lines(); ++i) {
+            TruckManifest::Line line = cargo.line(i);
+            whole->drained.add(line.product, line.quantity);
+        }
+    }
+    for (const auto& line : dropped) {
+        // Продукт строки уже погружен этим рейсом, поэтому его слот есть
+        if (const DeliveredSlot* slot = delivered_products.find(line.product)) {
+            drop_shops.find(line.shop)->drained.add(slot->id, line.quantity);
+        }
+    }
+    cargo.clear();
+    publishTotals();
+    counters_seq.writeEnd();
+}
+
+Truck::ShopDrop& Truck::shopDrop(std::string_view shop_name) {
+    ShopDrop* drop = drop_shops.find(shop_name);
+    if (!drop) {
+        drop = &drop_log.emplace_back(shop_name);
+        drop_shops.insert(drop);
+    }
+    return *drop;
+}
+
+// Раскладывает собранный со складов товар по рейсам с учётом штук, веса и объёма
+void Truck::dispatchLoads(std::span<const UnloadedLine> picked, const std::string& shop_name) {
+    std::pmr::vector<PackItem> items(orderArena()); // вызывается внутри ArenaScope доставки
+    items.reserve(picked.size());
+    for (const auto& product : picked) {
+        items.push_back({product.name, Capacity::unit(product.weight, product.packaging), product.quantity});
+    }
+    auto loads = packLoads(items, getLimits(), orderArena());
+    if (loads.empty()) {
+        // Ничего не погружено: рейса и выгрузки в магазин не было
+        console() << "Грузовик " << name << " не нашёл продукции для магазина " << shop_name << ".\n";
+        return;
+    }
+
+    for (const auto& load : loads) {
+        for (const auto& entry : load) {
+            const UnloadedLine& product = picked[entry.first];
+            // packLoads не превышает кузов, поэтому вес и объём учитываются до публикации в loadProduct
+            load_kg += product.weight * static_cast<double>(entry.second);
+            load_volume += packagingVolume(product.packaging) * static_cast<double>(entry.second);
+            loadProduct(product.name, entry.second);
+        }
+        unloadProduct(shop_name);
+    }
+    if (loads.size() > 1) {
+        console() << "Заказ для магазина " << shop_name << " доставлен за " << loads.size() << " рейса(ов).\n";
+    }
 }
 
-void Truck::deliver(Warehouse* warehouse, const std::string& shop_name, const std::map<std::string, size_t>& requests) {
+bool Truck::fitsEmpty(const Warehouse* warehouse, const std::string& product_name) const {
+    if (Capacity::fitCount(getLimits(), Capacity{}, warehouse->unitOf(product_name)) > 0) {
+        return true;
+    }
+    console() << "Предупреждение: единица продукта " << product_name << " со склада " << warehouse->getName()
+              << " не помещается в грузовик " << name << ".\n";
+    return false;
+}
+
+size_t Truck::deliver(Warehouse* warehouse, const std::string& shop_name, const std::map<std::string, size_t>& requests,
+                      int priority) {
+    return deliverFrom(warehouse, shop_name, requests, priority, true);
+}
+
+size_t Truck::deliverBackorder(Warehouse* warehouse, const std::string& shop_name, const std::string& product_name,
+                               size_t quantity) {
+    return deliverFrom(warehouse, shop_name, {{product_name, quantity}}, 0, false);
+}
+
+size_t Truck::deliverFrom(Warehouse* warehouse, const std::string& shop_name, const std::map<std::string, size_t>& requests,
+                          int priority, bool backorder_shortfall) {
+    PerfScope profile(ProfileRegion::TruckDeliver);
+    ArenaScope arena; // временные объекты заказа живут в арене потока до конца доставки
     // Логика доставки из склада в магазин
+    size_t delivered = 0;
+    std::pmr::vector<UnloadedLine> picked(orderArena());
     for (const auto& request : requests) {
         const std::string& product_name = request.first;
         size_t quantity = request.second;
 
+        // Единица, не помещающаяся даже в пустой кузов, остаётся на складе
+        if (!fitsEmpty(warehouse, product_name)) {
+            continue;
+        }
+
         // Выгружаем продукт из склада
-        auto unloaded = warehouse->unload(product_name, quantity);
-        total_delivered += unloaded[product_name].quantity;
-        delivered_products[product_name] += unloaded[product_name].quantity;
+        UnloadedLine unloaded = warehouse->take(product_name, quantity);
+        countDelivered(warehouse, product_name, shop_name, unloaded.quantity);
+        delivered += unloaded.quantity;
+        if (unloaded.quantity > 0) {
+            picked.push_back(unloaded);
+        }
+        if (backorder_shortfall && unloaded.quantity < quantity) {
+            backorderShortfall(shop_name, product_name, quantity, quantity - unloaded.quantity, priority);
+        }
     }
-    unloadProduct(shop_name); // После доставки, выгружаем в магазин
+    dispatchLoads(picked, shop_name); // После доставки, выгружаем в магазин
+    return delivered;
 }
 
-void Truck::deliver(const std::vector<Warehouse*>& warehouses, const std::string& shop_name, const std::map<std::string, size_t>& requests) {
-    // Проверка возможности загрузки полного заказа в один склад
-    for (auto warehouse : warehouses) {
-        bool can_fulfill_order = true;
-        for (const auto& request : requests) {
-            const std::string& product_name = request.first;
-            size_t required_quantity = request.second;
-
-            if (warehouse->getProductQuantity(product_name) < required_quantity) {
-                can_fulfill_order = false;
-                break; // Не хватает количества, переходим к следующему складу
+size_t Truck::deliverTour(const std::vector<Warehouse*>& warehouses, std::span<const DropOff> stops) {
+    PerfScope profile(ProfileRegion::TruckDeliver);
+    ArenaScope arena;
+    std::pmr::vector<size_t> dropped(stops.size(), 0, orderArena()); // единиц в кузове для каждой остановки
+    std::pmr::vector<DroppedLine> lines(orderArena());
+    size_t delivered = 0;
+    for (size_t s = 0; s < stops.size(); ++s) {
+        const std::string& shop_name = stops[s].shop_name;
+        for (const auto& [product_name, quantity] : stops[s].requests) {
+            size_t remaining = quantity;
+            bool oversized = false;
+            for (Warehouse* warehouse : warehouses) {
+                if (remaining == 0) {
+                    break;
+                }
+                if (warehouse->getProductQuantity(product_name) == 0) {
+                    continue;
+                }
+                if (!fitsEmpty(warehouse, product_name)) {
+                    oversized = true;
+                    continue;
+                }
+                // Берётся не больше, чем помещается в кузов поверх уже погруженного для рейса
+                size_t room = Capacity::fitCount(getLimits(), Capacity{product_count, load_kg, load_volume},
+                                                 warehouse->unitOf(product_name));
+                if (room == 0) {
+                    break;
+                }
+                UnloadedLine unloaded = warehouse->take(product_name, std::min(remaining, room));
+                if (unloaded.quantity == 0) {
+                    continue;
+                }
+                countDelivered(warehouse, product_name, shop_name, unloaded.quantity);
+                load_kg += unloaded.weight * static_cast<double>(unloaded.quantity);
+                load_volume += packagingVolume(unloaded.packaging) * static_cast<double>(unloaded.quantity);
+                loadProduct(unloaded.name, unloaded.quantity);
+                remaining -= unloaded.quantity;
+                dropped[s] += unloaded.quantity;
+                lines.push_back({shop_name, product_name, unloaded.quantity});
+            }
+            if (remaining > 0 && !oversized) {
+                backorderShortfall(shop_name, product_name, quantity, remaining, 0);
             }
         }
+        delivered += dropped[s];
+    }
+    if (delivered == 0) {
+        console() << "Грузовик " << name << " не нашёл продукции для рейса.\n";
+        return 0;
+    }
+    for (size_t s = 0; s < stops.size(); ++s) {
+        if (dropped[s] > 0) {
+            console() << "Грузовик " << name << " выгружает " << dropped[s] << " ед. в магазин " << stops[s].shop_name << ".\n";
+        }
+    }
+    finishTrip({}, lines);
+    return delivered;
+}
 
-        // Если весь заказ может быть выполнен с одного склада
-        if (can_fulfill_order) {
-            for (const auto& request : requests) {
-                const std::string& product_name = request.first;
-                size_t required_quantity = request.second;
-                auto unloaded = warehouse->unload(product_name, required_quantity);
-                total_delivered += unloaded[product_name].quantity;
-                delivered_products[product_name] += unloaded[product_name].quantity;
+size_t OrderResult::requested() const {
+    size_t total = 0;
+    for (const auto& line : lines) {
+        total += line.requested;
+    }
+    return total;
+}
+
+size_t OrderResult::fulfilled() const {
+    size_t total = 0;
+    for (const auto& line : lines) {
+        total += line.fulfilled;
+    }
+    return total;
+}
+
+void Truck::deliver(const Topology& topology, const std::string& shop_name, const std::map<std::string, size_t>& requests,
+                    int priority, OrderResult* result) {
+    Topology::Reader sites(topology); // выведенные во время заказа склады доживут до его конца
+    deliver(sites.warehouses(), shop_name, requests, priority, result);
+}
+
+const Truck::IndexedSites& Truck::indexedSites(const std::vector<Warehouse*>& warehouses) {
+    uint64_t registry = index->registryVersion(); // до чтения getIndex() складов
+    IndexedSites& sites = indexed_sites;
+    if (sites.index == index && sites.registry == registry && sites.list == warehouses) {
+        return sites;
+    }
+    sites.index = index;
+    sites.registry = registry;
+    sites.list = warehouses;
+    sites.allowed = WarehouseSet();
+    sites.by_id.clear();
+    sites.position.clear();
+    sites.unindexed.clear();
+    for (size_t i = 0; i < warehouses.size(); ++i) {
+        Warehouse* warehouse = warehouses[i];
+        if (warehouse->getIndex() != index) {
+            sites.unindexed.emplace_back(warehouse, i);
+            continue;
+        }
+        uint32_t id = warehouse->getIndexId();
+        if (sites.by_id.size() <= id) {
+            sites.by_id.resize(id + 1, nullptr);
+            sites.position.resize(id + 1, 0);
+        }
+        if (!sites.by_id[id]) { // склад, повторённый в списке, обходится с первой позиции
+            sites.by_id[id] = warehouse;
+            sites.position[id] = i;
+            sites.allowed.set(id);
+        }
+    }
+    return sites;
+}
+
+void Truck::deliver(const std::vector<Warehouse*>& warehouses, const std::string& shop_name, const std::map<std::string, size_t>& requests,
+                    int priority, OrderResult* result) {
+    PerfScope profile(ProfileRegion::TruckDeliver);
+    ArenaScope arena;
+    if (result) {
+        result->shop = shop_name;
+        result->truck = name;
+        result->lines.clear();
+        for (const auto& request : requests) {
+            result->lines.push_back({request.first, request.second, 0, {}, 0});
+        }
+    }
+    // Строка итога для i-й строки заказа
+    auto line = [&](size_t i) { return result ? &result->lines[i] : nullptr; };
+    auto has_order = [&](const Warehouse* warehouse) {
+        for (const auto& request : requests) {
+            if (warehouse->getProductQuantity(request.first) < request.second) {
+                return false; // Не хватает количества, переходим к следующему складу
+            }
+        }
+        return true;
+    };
+    // С маршрутизатором склады перебираются от ближайшего к магазину. Точка магазина ищется
+    // один раз, склады - по номерам точек, запомненным при размещении (Router::placeWarehouse)
+    int shop_site = router ? router->siteId(shop_name) : -1;
+    std::pmr::vector<Warehouse*> by_distance(orderArena());
+    if (router && !index) {
+        router->nearestFirst(warehouses, shop_name, by_distance);
+    }
+    std::span<Warehouse* const> candidates = router && !index ? std::span<Warehouse* const>(by_distance)
+                                                               : std::span<Warehouse* const>(warehouses);
+    std::pmr::vector<UnloadedLine> picked(orderArena()); // всё собранное со складов раскладывается по рейсам в конце
+
+    // С индексом наличия склады, где хватает всего заказа, - это биты full_order, а строки
+    // собираются по держателям продукта: заказ стоит пропорционально держателям, а не всем складам.
+    // Склады списка вне индекса опрашиваются напрямую в том же порядке обхода
+    const IndexedSites* sites = index ? &indexedSites(warehouses) : nullptr;
+    std::pmr::vector<std::pair<double, std::pair<Warehouse*, size_t>>> unindexed(orderArena());
+    Warehouse* whole_source = nullptr;
+    if (index) {
+        auto travel = [&](const Warehouse* warehouse) {
+            return router ? router->travelTime(warehouse, shop_site) : 0.0;
+        };
+        for (const auto& site : sites->unindexed) {
+            unindexed.emplace_back(travel(site.first), site);
+        }
+        // Порядок обхода: ближайший к магазину, при равенстве - раньше в списке
+        std::sort(unindexed.begin(), unindexed.end(), [](const auto& x, const auto& y) {
+            return x.first != y.first ? x.first < y.first : x.second.second < y.second.second;
+        });
+        WarehouseSet full_order = index->holderSet(requests);
+        full_order &= sites->allowed;
+        std::pair<double, size_t> best{0, 0};
+        full_order.forEach([&](uint32_t id) {
+            std::pair<double, size_t> key{travel(sites->by_id[id]), sites->position[id]};
+            if (!whole_source || key < best) {
+                whole_source = sites->by_id[id];
+                best = key;
+            }
+        });
+        for (const auto& site : unindexed) {
+            std::pair<double, size_t> key{site.first, site.second.second};
+            if (whole_source && !(key < best)) {
+                break;
+            }
+            if (has_order(site.second.first)) {
+                whole_source = site.second.first;
+                break;
             }
-            unloadProduct(shop_name); // Выгружаем все сразу в магазин
-            return; // Завершаем, так как весь заказ выполнен с одного склада
         }
     }
 
-    // Если один склад не может полностью удовлетворить заказ, распределяем по нескольким складам
     bool product_found = false; // Флаг для проверки наличия продуктов
+    bool oversized = false;     // единица строки со склада не помещается в пустой кузов
+
+    // Сначала склад, где хватает всего заказа; если такого нет, распределяем по нескольким складам.
+    // С индексом такой склад уже выбран выше, и кандидат - только он
+    std::span<Warehouse* const> order_candidates =
+            index ? std::span<Warehouse* const>(&whole_source, whole_source ? 1 : 0) : candidates;
+    bool whole = gatherOrder(
+            order_candidates, requests, [](const auto& request) { return request.second; },
+            [&](const Warehouse* warehouse) { return index != nullptr || has_order(warehouse); },
+            [&](const auto& request, auto&& visit) {
+                const std::string& product_name = request.first;
+                if (!index) {
+                    for (auto warehouse : candidates) {
+                        size_t available_quantity = warehouse->getProductQuantity(product_name);
+                        if (available_quantity > 0 && !visit(warehouse, available_quantity)) {
+                            break; // Переходим к следующему продукту, так как количество полностью загружено
+                        }
+                    }
+                    return;
+                }
+                std::pmr::vector<StockHolder> holders(orderArena());
+                index->holders(product_name, holders);
+                if (router) {
+                    std::pmr::vector<std::pair<double, StockHolder>> ranked(orderArena());
+                    for (const auto& holder : holders) {
+                        ranked.emplace_back(router->travelTime(holder.warehouse, shop_site), holder);
+                    }
+                    // Равные по времени - в порядке регистрации, как без маршрутизатора
+                    std::sort(ranked.begin(), ranked.end(), [](const auto& x, const auto& y) {
+                        return x.first != y.first ? x.first < y.first : x.second.warehouse_id < y.second.warehouse_id;
+                    });
+                    for (size_t k = 0; k < ranked.size(); ++k) {
+                        holders[k] = ranked[k].second;
+                    }
+                }
+                for (const auto& holder : holders) {
+                    if (sites->allowed.test(holder.warehouse_id) && !visit(holder.warehouse, holder.quantity)) {
+                        return;
+                    }
+                }
+                // Склады заказа, не зарегистрированные в индексе, опрашиваются напрямую
+                for (const auto& site : unindexed) {
+                    size_t available_quantity = site.second.first->getProductQuantity(product_name);
+                    if (available_quantity > 0 && !visit(site.second.first, available_quantity)) {
+                        return;
+                    }
+                }
+            },
+            [&](Warehouse* warehouse, size_t i, const auto& request, size_t quantity) -> size_t {
+                const std::string& product_name = request.first;
+                if (!fitsEmpty(warehouse, product_name)) {
+                    oversized = true;
+                    return 0; // строка остаётся недостачей в итоге заказа
+                }
+                product_found = true; // Отмечаем, что продукт найден
+                UnloadedLine unloaded = warehouse->take(product_name, quantity);
+                countDelivered(warehouse, product_name, shop_name, unloaded.quantity, line(i));
+                picked.push_back(unloaded);
+                return unloaded.quantity; // остаток мог уменьшиться после чтения
+            },
+            [&](size_t i, const auto& request, size_t remaining_quantity) {
+                // Остаток мог остаться и у склада, где хватало всего заказа: его успели забрать параллельно.
+                // Негабарит этот грузовик не довезёт и после пополнения: в дозаказ он не ставится
+                if (remaining_quantity > 0 && !oversized) {
+                    backorderShortfall(shop_name, request.first, request.second, remaining_quantity, priority, line(i));
+                } else if (remaining_quantity > 0) {
+                    console() << "Продукт " << request.first << " недоступен в необходимом количестве (" << request.second
+                              << " ед.) на складах.\n";
+                }
+                oversized = false;
+            });
 
-    for (const auto& request : requests) {
-        const std::string& product_name = request.first;
-        size_t required_quantity = request.second;
-        size_t remaining_quantity = required_quantity;
+    if (whole) {
+        dispatchLoads(picked, shop_name); // Выгружаем все сразу в магазин: весь заказ выполнен с одного склада
+    } else if (product_found) {
+        dispatchLoads(picked, shop_name); // Если хоть один продукт загружен, выгружаем в магазин
+    } else {
 
-        for (auto warehouse : warehouses) {
-            size_t available_quantity = warehouse->getProductQuantity(product_name);
-            if (available_quantity > 0) {
-                product_found = true; // Отмечаем, что продукт найден
-                size_t quantity_to_unload = std::min(available_quantity, remaining_quantity);
-                auto unloaded = warehouse->unload(product_name, quantity_to_unload);
-                total_delivered += unloaded[product_name].quantity;
-                delivered_products[product_name] += unloaded[product_name].quantity;
-                remaining_quantity -= quantity_to_unload;
-
-                if (remaining_quantity == 0) {
-                    break; // Переходим к следующему продукту, так как количество полностью загружено
+        console() << "Ни один продукт из заказа не найден на складах. Доставка отменена.\n";
+    }
+}
+
+
+void Truck::backorderShortfall(const std::string& shop_name, const std::string& product_name, size_t requested,
+                               size_t shortfall, int priority, OrderLineResult* line) {
+    console() << "Продукт " << product_name << " недоступен в необходимом количестве (" << requested << " ед.) на складах.\n";
+    if (!backorders) {
+        return;
+    }
+    uint64_t id = backorders->add(this, shop_name, product_name, shortfall, priority);
+    if (line) {
+        line->backorder = id;
+    }
+    console() << "Недостающие " << shortfall << " ед. продукта " << product_name << " поставлены в дозаказ " << id << ".\n";
+}
+
+void Truck::attachStats(FleetStats* fleet) {
+    fleet_stats = fleet;
+    if (fleet_stats) {
+        fleet_id = fleet_stats->intern(StatDimension::Truck, name);
+    }
+}
+
+void Truck::recordDelivery(std::string_view warehouse, std::string_view product, std::string_view shop_name, size_t quantity) {
+    if (fleet_stats && quantity) {
+        DeliveryKey key{fleet_stats->intern(StatDimension::Product, product), fleet_stats->intern(StatDimension::Warehouse, warehouse),
+                        fleet_id, fleet_stats->intern(StatDimension::Shop, shop_name)};
+        fleet_stats->record(key, quantity, FleetStats::today());
+    }
+}
+
+void Truck::countDelivered(const Warehouse* from, const std::string& product_name, const std::string& shop_name, size_t quantity,
+                           OrderLineResult* line) {
+    if (line && quantity) {
+        line->fulfilled += quantity;
+        line->sources.emplace_back(from->getName(), quantity);
+    }
+    total_delivered += quantity;
+    publishCounters(product_name, quantity);
+    if (fleet_stats) {
+        recordDelivery(from->getName(), product_name, shop_name, quantity);
+    }
+}
+
+void Truck::publishCounters(std::string_view product, size_t delivered, size_t loaded) {
+    counters_seq.writeBegin();
+    if (!product.empty()) {
+        DeliveredSlot* slot = delivered_products.find(product);
+        if (!slot) {
+            slot = &delivered_slots.emplace_back(product, static_cast<uint32_t>(delivered_slots.size()));
+            delivered_products.insert(slot);
+        }
+        slot->quantity.store(slot->quantity.load(std::memory_order_relaxed) + delivered, std::memory_order_relaxed);
+        if (loaded) {
+            cargo.add(slot->id, loaded);
+        }
+    }
+    publishTotals();
+    counters_seq.writeEnd();
+}
+
+void Truck::publishTotals() {
+    published_count.store(product_count, std::memory_order_relaxed);
+    published_delivered.store(total_delivered, std::memory_order_relaxed);
+    published_trips.store(trips, std::memory_order_relaxed);
+    published_kg.store(load_kg, std::memory_order_relaxed);
+    published_volume.store(load_volume, std::memory_order_relaxed);
+}
+
+TruckCounters Truck::counters() const {
+    TruckCounters snap;
+    std::vector<std::string_view> names; // имя продукта по номеру слота
+    uint64_t seq;
+    do {
+        seq = counters_seq.readBegin();
+        snap.delivered.clear();
+        names.clear();
+        snap.total_delivered = published_delivered.load(std::memory_order_relaxed);
+        snap.trips = published_trips.load(std::memory_order_relaxed);
+        snap.load = Capacity{published_count.load(std::memory_order_relaxed), published_kg.load(std::memory_order_relaxed),
+                             published_volume.load(std::memory_order_relaxed)};
+        // Слот появляется и при одной загрузке: в доставленном остаются только ненулевые
+        delivered_slots.forEach([&](const DeliveredSlot& slot) {
+            names.push_back(slot.name);
+            size_t quantity = slot.quantity.load(std::memory_order_relaxed);
+            if (quantity > 0) {
+                snap.delivered.emplace_back(slot.name, quantity);
+            }
+        });
+        // Номер продукта в манифесте - позиция слота, слоты только дописываются
+        auto lines = [&](const TruckManifest& manifest, std::vector<std::pair<std::string, size_t>>& out) {
+            out.clear();
+            for (size_t i = 0; i < manifest.lines(); ++i) {
+                TruckManifest::Line line = manifest.line(i);
+                if (line.product < names.size()) {
+                    out.emplace_back(names[line.product], line.quantity);
                 }
             }
+        };
+        lines(cargo, snap.cargo);
+        snap.dropped.clear();
+        drop_log.forEach([&](const ShopDrop& drop) {
+            snap.dropped.emplace_back(drop.name, std::vector<std::pair<std::string, size_t>>());
+            lines(drop.drained, snap.dropped.back().second);
+        });
+        snap.untracked = cargo.untracked();
+    } while (counters_seq.readRetry(seq));
+    snap.version = seq / 2;
+    std::sort(snap.delivered.begin(), snap.delivered.end());
+    std::sort(snap.dropped.begin(), snap.dropped.end());
+    return snap;
+}
+
+void Truck::printStatistics() const {
+    TruckCounters stats = counters(); // не мешает доставке, которая идёт параллельно
+
+    console() << "Статистика грузовика " << name << ":\n";
+    console() << "Общий объем доставленного: " << stats.total_delivered << " ед.\n";
+    for (const auto& product : stats.delivered) {
+
+        console() << "Продукт: " << product.first << ", Доставлено: " << product.second << " ед.\n";
+    }
+    for (const auto& product : stats.cargo) {
+        console() << "В кузове: " << product.first << " - " << product.second << " ед.\n";
+    }
+}
+
+
+namespace {
+
+OrderServer* active_server = nullptr;
+
+void stopServer(int) {
+    if (active_server) {
+        active_server->stop();
+    }
+}
+
+// FGBU --serve <путь сокета> [обработчиков]: сервер приёма заказов, мир как у --bench
+int serve(const std::string& socket_path, unsigned workers) {
+    BenchConfig world;
+    auto fleet = std::make_unique<FleetStats>();
+    Topology topology;
+    for (size_t i = 0; i < world.warehouses; ++i) {
+        topology.addWarehouse(std::make_unique<Warehouse>("Склад " + std::to_string(i + 1), world.warehouse_capacity));
+    }
+    for (size_t i = 0; i < world.trucks; ++i) {
+        Truck* truck = topology.addTruck(std::make_unique<Truck>("Грузовик " + std::to_string(i + 1), world.truck_capacity));
+        truck->attachStats(fleet.get());
+    }
+
+    OrderServer server(topology, workers);
+    if (!server.listen(socket_path)) {
+        std::cout << "Не удалось открыть сокет " << socket_path << "\n";
+        return 1;
+    }
+    active_server = &server;
+    struct sigaction action {};
+    action.sa_handler = stopServer;
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+
+    // Повторная проверка порога раз в секунду: склад, заполненный заказами
+    // на производство, разгружается в магазин, не дожидаясь следующего поступления.
+    // Грузовики, занятые заказами обработчиков, autoUnload пропускает, а не ждёт
+    TimerService timers;
+    timers.every(std::chrono::seconds(1), [&topology] {
+        ScopedConsole quiet(nullConsole());
+        Topology::Reader fleet(topology);
+        for (auto* warehouse : fleet.warehouses()) {
+            if (Capacity::fillRatio(warehouse->getLimits(), warehouse->getLoad()) >= 0.95) {
+                warehouse->autoUnload(topology, "Магазин 1");
+            }
         }
+    });
 
-        if (remaining_quantity > 0) {
+    std::cout << "Сервер принимает заказы на " << socket_path << "\n";
+    server.run();
+    active_server = nullptr;
+    timers.stop();
+
+    ServerStats stats = server.stats();
+    std::cout << "Соединений: " << stats.connections << ", заказов: " << stats.orders
+              << ", партий производства: " << stats.productions << ", ошибочных кадров: " << stats.malformed
+              << ", недопустимых запросов: " << stats.invalid << "\n";
+    const char* class_names[kOrderClasses] = {"Express", "Standard", "Bulk"};
+    for (size_t c = 0; c < kOrderClasses; ++c) {
+        std::cout << class_names[c] << ": принято " << stats.admitted[c] << ", отклонено " << stats.shed[c]
+                  << ", ожидание " << stats.wait_us[c] << " мкс\n";
+    }
+    auto busiest = fleet->ranking(StatDimension::Warehouse);
+    for (size_t i = 0; i < busiest.size() && i < 3; ++i) {
+        std::cout << busiest[i].first << ": отгружено " << busiest[i].second << " ед.\n";
+    }
+    return 0;
+}
 
-            std::cout << "Продукт " << product_name << " недоступен в необходимом количестве (" << required_quantity << " ед.) на складах.\n";
+// FGBU --rebalance [складов] [продуктов]: такт планировщика перебросок на синтетической сети.
+// Склады стоят в узлах дорожной решётки, часть переполнена, прогноз спроса случаен
+int rebalance(size_t sites, size_t products) {
+    std::mt19937_64 rng(7);
+    auto side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(sites)))) + 1;
+    std::uniform_real_distribution<double> minutes(5.0, 30.0);
+    RoadGraph graph;
+    for (uint32_t y = 0; y < side; ++y) {
+        for (uint32_t x = 0; x < side; ++x) {
+            if (x + 1 < side) {
+                graph.addRoad(y * side + x, y * side + x + 1, minutes(rng));
+            }
+            if (y + 1 < side) {
+                graph.addRoad(y * side + x, (y + 1) * side + x, minutes(rng));
+            }
         }
     }
+    graph.finalize();
+    Router router(graph);
 
-    if (product_found) {
-        unloadProduct(shop_name); // Если хоть один продукт загружен, выгружаем в магазин
-    } else {
+    RebalanceInput input;
+    for (size_t k = 0; k < products; ++k) {
+        input.products.push_back("Продукт " + std::to_string(k + 1));
+    }
+    input.stock.assign(sites * products, 0);
+    input.demand.assign(sites * products, 0);
+    std::uniform_int_distribution<size_t> pick(0, products - 1);
+    std::uniform_real_distribution<double> fill(0.4, 1.0);
+    for (size_t i = 0; i < sites; ++i) {
+        input.sites.push_back("Склад " + std::to_string(i + 1));
+        router.placeSite(input.sites.back(), static_cast<uint32_t>(i));
+        input.capacity.push_back(2000);
+        auto load = static_cast<size_t>(fill(rng) * 2000);
+        for (size_t u = 0; u < load; u += 50) {
+            input.stockAt(i, pick(rng)) += 50;
+        }
+        for (size_t d = 0; d < 8; ++d) {
+            input.demand[i * products + pick(rng)] += 40;
+        }
+    }
+    auto start = std::chrono::steady_clock::now();
+    router.prepare();
+    auto planned = std::chrono::steady_clock::now();
+    RebalancePlan plan = RebalancePlanner(router).plan(input);
+    auto done = std::chrono::steady_clock::now();
+
+    std::cout << "Складов: " << sites << ", продуктов: " << products << "\n";
+    std::cout << "Матрица времени в пути: " << std::chrono::duration<double, std::milli>(planned - start).count() << " мс, "
+              << "план: " << std::chrono::duration<double, std::milli>(done - planned).count() << " мс\n";
+    std::cout << "Перебросок: " << plan.transfers.size() << ", единиц: " << plan.moved << ", стоимость: " << plan.cost
+              << " мин\n";
+    std::cout << "Выше порога: " << plan.overflow << " ед., не вывезено: " << plan.overflow_left
+              << " ед.; под прогноз перемещено " << plan.demand_covered << " ед.\n";
+    return 0;
+}
+
+// FGBU --tours [магазинов] [грузовиков]: заказы магазинов на дорожной решётке развозятся
+// многоостановочными рейсами со склада депо. Каждый рейс - одна загрузка и выгрузки по остановкам.
+// Затем срочные заказы везёт отдельный грузовик с маршрутизатором - от ближайшего к магазину склада
+int tours(size_t shops, size_t truck_count) {
+    std::mt19937_64 rng(5);
+    auto side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(shops + 1)))) + 1;
+    std::uniform_real_distribution<double> minutes(3.0, 15.0);
+    RoadGraph graph;
+    for (uint32_t y = 0; y < side; ++y) {
+        for (uint32_t x = 0; x < side; ++x) {
+            if (x + 1 < side) {
+                graph.addRoad(y * side + x, y * side + x + 1, minutes(rng));
+            }
+            if (y + 1 < side) {
+                graph.addRoad(y * side + x, (y + 1) * side + x, minutes(rng));
+            }
+        }
+    }
+    graph.finalize();
+    Router router(graph);
+
+    const size_t products = 20;
+    std::vector<std::unique_ptr<Warehouse>> sites;
+    std::vector<Warehouse*> warehouses; // склад депо первый (узел 0): с него грузятся рейсы
+    std::uniform_int_distribution<uint32_t> node(1, side * side - 1);
+    ScopedConsole quiet(nullConsole()); // сообщения размещения и доставки
+    for (size_t i = 0; i < 3; ++i) {
+        sites.push_back(std::make_unique<Warehouse>("Склад " + std::to_string(i + 1), 1000000));
+        warehouses.push_back(sites.back().get());
+        router.placeWarehouse(sites.back().get(), i == 0 ? 0 : node(rng));
+        std::vector<Warehouse*> target{sites.back().get()};
+        for (size_t k = 0; k < products; ++k) {
+            Factory("Продукт " + std::to_string(k + 1), 10.0, "Коробка", i == 0 ? 450 : 150).storage(target);
+        }
+    }
+
+    std::vector<ShopOrder> orders;
+    std::uniform_int_distribution<size_t> pick(1, products);
+    std::uniform_int_distribution<size_t> amount(5, 30);
+    std::uniform_int_distribution<size_t> lines(1, 3);
+    size_t requested = 0;
+    for (size_t s = 0; s < shops; ++s) {
+        ShopOrder order{"Магазин " + std::to_string(s + 1), {}};
+        router.placeSite(order.shop_name, node(rng));
+        for (size_t n = lines(rng); n > 0; --n) {
+            size_t quantity = amount(rng);
+            order.requests["Продукт " + std::to_string(pick(rng))] += quantity;
+            requested += quantity;
+        }
+        orders.push_back(std::move(order));
+    }
+    router.prepare();
 
-        std::cout << "Ни один продукт из заказа не найден на складах. Доставка отменена.\n";
+    std::vector<std::unique_ptr<Truck>> fleet;
+    std::vector<Truck*> trucks;
+    for (size_t t = 0; t < truck_count; ++t) {
+        fleet.push_back(std::make_unique<Truck>("Грузовик " + std::to_string(t + 1), 120, 1000.0));
+        trucks.push_back(fleet.back().get());
+    }
+    auto start = std::chrono::steady_clock::now();
+    TourPlan plan = TourPlanner(router, *warehouses.front()).plan(orders, trucks);
+    auto planned = std::chrono::steady_clock::now();
+    executePlan(plan, orders);
+
+    size_t stops = 0;
+    for (const auto& tour : plan.tours) {
+        stops += tour.stops.size();
     }
+    size_t trips = 0;
+    size_t delivered = 0;
+    std::map<std::string, size_t> received; // выгружено в каждый магазин всеми грузовиками
+    for (auto* truck : trucks) {
+        trips += truck->getTrips();
+        delivered += truck->getTotalDelivered();
+        for (const auto& [shop_name, lines] : truck->counters().dropped) {
+            for (const auto& line : lines) {
+                received[shop_name] += line.second;
+            }
+        }
+    }
+    std::cout << "Магазинов: " << shops << ", грузовиков: " << truck_count << "\n";
+    std::cout << "План: " << std::chrono::duration<double, std::milli>(planned - start).count() << " мс, рейсов "
+              << plan.tours.size() << ", остановок " << stops << ", в пути " << plan.travel_time << " мин\n";
+    std::cout << "Выполнено рейсов: " << trips << ", доставлено " << delivered << " из " << requested << " ед. в "
+              << received.size() << " магазинов\n";
+
+    Truck courier("Курьер", 60);
+    courier.attachRouter(&router);
+    size_t urgent = shops > 0 ? 20 : 0;
+    size_t urgent_requested = 0;
+    size_t urgent_fulfilled = 0;
+    std::uniform_int_distribution<size_t> shop(0, shops > 0 ? shops - 1 : 0);
+    for (size_t n = 0; n < urgent; ++n) {
+        const ShopOrder& order = orders[shop(rng)];
+        OrderResult result;
+        courier.deliver(warehouses, order.shop_name, order.requests, 0, &result);
+        urgent_requested += result.requested();
+        urgent_fulfilled += result.fulfilled();
+    }
+    std::cout << "Срочных заказов: " << urgent << ", доставлено " << urgent_fulfilled << " из " << urgent_requested << " ед.\n";
+    return 0;
 }
 
+// FGBU --history [отсчётов в сутки] [суток]: нагрузка на историю остатков со сроком хранения 7 суток
+int history(size_t per_day, size_t days) {
+    const size_t sites = 50;
+    const size_t products = 200;
+    const int64_t day_ms = 24LL * 3600 * 1000;
+    StockHistoryOptions options;
+    options.retention_ms = 7 * day_ms;
+    StockHistory store(options);
+    std::vector<StockSeries*> series;
+    std::vector<size_t> level(sites * products, 500);
+    for (size_t i = 0; i < sites; ++i) {
+        for (size_t k = 0; k < products; ++k) {
+            series.push_back(store.series("Склад " + std::to_string(i + 1), "Продукт " + std::to_string(k + 1)));
+        }
+    }
 
-void Truck::printStatistics() const {
+    std::mt19937_64 rng(11);
+    std::uniform_int_distribution<size_t> pick(0, series.size() - 1);
+    std::uniform_int_distribution<int> change(-40, 40);
+    const int64_t start_time = StockHistory::now() - static_cast<int64_t>(days) * day_ms;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t n = 0; n < per_day * days; ++n) {
+        size_t s = pick(rng);
+        level[s] = static_cast<size_t>(std::max<int64_t>(0, static_cast<int64_t>(level[s]) + change(rng)));
+        int64_t time = start_time + static_cast<int64_t>(n) * day_ms / static_cast<int64_t>(per_day);
+        store.record(*series[s], time, level[s]);
+    }
+    auto recorded = std::chrono::steady_clock::now();
+    const int64_t end_time = start_time + static_cast<int64_t>(days) * day_ms;
+    size_t points = 0;
+    for (size_t i = 0; i < 100; ++i) {
+        points += store.range("Склад " + std::to_string(i % sites + 1), "Продукт " + std::to_string(i + 1), end_time - 7 * day_ms,
+                              end_time).size();
+    }
+    auto queried = std::chrono::steady_clock::now();
+
+    StockHistoryStats stats = store.stats();
+    double record_seconds = std::chrono::duration<double>(recorded - start).count();
+    std::cout << "Отсчётов: " << per_day * days << " за " << days << " сут., запись: "
+              << static_cast<double>(per_day * days) / record_seconds << " отсчётов/с\n";
+    std::cout << "Хранится: " << stats.samples << " отсчётов в " << stats.blocks << " блоках " << stats.series << " рядов, "
+              << static_cast<double>(stats.bytes) / (1 << 20) << " МБ ("
+              << (stats.samples ? static_cast<double>(stats.bytes) / static_cast<double>(stats.samples) : 0) << " байт/отсчёт)\n";
+    std::cout << "100 запросов за 7 суток: " << points << " точек, "
+              << std::chrono::duration<double, std::milli>(queried - recorded).count() << " мс\n";
+    return 0;
+}
 
-    std::cout << "Статистика грузовика " << name << ":\n";
-    std::cout << "Общий объем доставленного: " << total_delivered << " ед.\n";
-    for (const auto& product : delivered_products) {
+// FGBU --timers [событий]: сутки симуляции с тиком 1 мс на колесе таймеров. Фабрики и проверки
+// порога повторяются по расписанию, окна доставки часто отменяются и переносятся, грузовики возвращаются
+int timers(size_t events) {
+    const uint64_t day = 24ULL * 3600 * 1000;
+    std::mt19937_64 rng(3);
+    std::uniform_int_distribution<uint64_t> when(1, day);
+    TimerWheel wheel;
+    size_t fired = 0;
+    size_t rescheduled = 0;
+    std::vector<TimerId> windows;
+    windows.reserve(events);
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < events; ++i) {
+        switch (i % 4) {
+        case 0: // производственный цикл фабрики: повтор через 1-4 часа
+            wheel.schedule(when(rng), [&, period = 3600000 * (1 + i % 4)] {
+                ++fired;
+                if (wheel.now() + period < day) {
+                    wheel.scheduleAfter(period, [&] { ++fired; });
+                }
+            });
+            break;
+        case 1: // окно доставки
+            windows.push_back(wheel.schedule(when(rng), [&] { ++fired; }));
+            break;
+        case 2: // возврат грузовика через 20-200 минут
+            wheel.schedule(when(rng) % (day - 12000000) + 1200000 * (1 + i % 10), [&] { ++fired; });
+            break;
+        default: // повторная проверка порога склада
+            wheel.schedule(when(rng), [&] { ++fired; });
+            break;
+        }
+    }
+    auto scheduled = std::chrono::steady_clock::now();
+    // Половина окон переносится: отмена и новая постановка
+    for (size_t i = 0; i < windows.size(); i += 2) {
+        if (wheel.cancel(windows[i])) {
+            wheel.schedule(when(rng), [&] { ++fired; });
+            ++rescheduled;
+        }
+    }
+    auto moved = std::chrono::steady_clock::now();
+    size_t pending = wheel.size();
+    wheel.advance(day);
+    auto done = std::chrono::steady_clock::now();
+
+    auto ms = [](auto a, auto b) { return std::chrono::duration<double, std::milli>(b - a).count(); };
+    std::cout << "Таймеров: " << events << ", в ожидании на пике: " << pending << "\n";
+    std::cout << "Постановка: " << ms(start, scheduled) << " мс, перенос " << rescheduled << " окон: " << ms(scheduled, moved)
+              << " мс\n";
+    std::cout << "Сутки симуляции: " << ms(moved, done) << " мс, сработало " << fired << " (осталось " << wheel.size() << ")\n";
+    return 0;
+}
 
-        std::cout << "Продукт: " << product.first << ", Доставлено: " << product.second << " ед.\n";
+// Каталог развёртывания с фиксированным списком продуктов
+constexpr ProductCatalog<8> kDemoCatalog{{{
+        {"Продукт A", 10.0, "Коробка", 0.05},
+        {"Продукт B", 2.0, "Мешок", 0.03},
+        {"Продукт C", 25.0, "Ящик", 0.08},
+        {"Продукт D", 400.0, "Паллета", 1.2},
+        {"Продукт 1", 10.0, "Коробка", 0.05},
+        {"Продукт 2", 1.5, "Мешок", 0.03},
+        {"Продукт 3", 12.0, "Ящик", 0.08},
+        {"Продукт 4", 300.0, "Паллета", 1.2},
+}}};
+static_assert(kDemoCatalog.valid());
+static_assert(kDemoCatalog.id("Продукт C") == 2 && kDemoCatalog.id("Продукт Z") == kUnknownProduct);
+
+// Чередование поступлений и отгрузок по случайным продуктам каталога; возвращает нс на операцию
+template <class Store, class Take>
+double inventoryOps(size_t ops, Store&& store, Take&& take) {
+    std::mt19937 rng(11);
+    size_t checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < ops; ++i) {
+        auto product = static_cast<ProductId>(rng() % kDemoCatalog.size());
+        if (i % 2 == 0) {
+            store(product);
+        } else {
+            checksum += take(product);
+        }
     }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    return checksum ? ns / static_cast<double>(ops) : 0;
 }
 
+// FGBU --catalog [операций]: инвентарные операции склада с каталогом при компиляции
+// против хранения с поиском по номеру и живого склада с поиском по имени
+int catalogBench(size_t ops) {
+    const Capacity limits = Capacity::limits(1000000000);
+    auto simulated = [&](auto& warehouse) {
+        return inventoryOps(ops, [&](ProductId p) { warehouse.store(p, kDemoCatalog.unit(p), 3); },
+                            [&](ProductId p) { return warehouse.take(p, 3); });
+    };
+    BasicWarehouse<NoLock, MapStorage> by_map("Склад", limits);
+    BasicWarehouse<NoLock, FlatHashStorage> by_hash("Склад", limits);
+    BasicWarehouse<NoLock, CatalogStorage<kDemoCatalog>> by_catalog("Склад", limits);
+    BasicWarehouse<ShardedLock<>, CatalogStorage<kDemoCatalog>> sharded("Склад", limits);
+    double map_ns = simulated(by_map);
+    double hash_ns = simulated(by_hash);
+    double catalog_ns = simulated(by_catalog);
+    double sharded_ns = simulated(sharded);
+
+    ScopedConsole quiet(nullConsole());
+    Warehouse live("Склад", 1000000000);
+    std::vector<Product> products;
+    std::vector<std::string> names;
+    for (size_t i = 0; i < kDemoCatalog.size(); ++i) {
+        const CatalogItem& item = kDemoCatalog[static_cast<ProductId>(i)];
+        products.emplace_back(std::string(item.name), item.weight, std::string(item.packaging), 3);
+        names.emplace_back(item.name);
+    }
+    // Живой склад пишет журнал поступлений на каждую партию, поэтому прогон короче
+    double live_ns = inventoryOps(std::min<size_t>(ops, 1000000), [&](ProductId p) { live.storeProduct(products[p]); },
+                                  [&](ProductId p) { return live.take(names[p], 3).quantity; });
 
+    std::cout << "Операций: " << ops << ", продуктов в каталоге: " << kDemoCatalog.size() << "\n";
+    std::cout << "Нс на операцию: MapStorage " << map_ns << ", FlatHashStorage " << hash_ns << ", CatalogStorage " << catalog_ns
+              << " (ShardedLock " << sharded_ns << "), Warehouse по имени " << live_ns << "\n";
+    return 0;
+}
+
+// FGBU --manifest [тактов] [продуктов]: размещение выпуска завода со смешанной продукцией
+// по одному продукту (Factory на продукт) и партией (Factory с манифестом)
+int manifestBench(size_t runs, size_t skus) {
+    ScopedConsole quiet(nullConsole());
+    std::vector<Product> output;
+    for (size_t i = 0; i < skus; ++i) {
+        output.emplace_back("Продукт " + std::to_string(i + 1), 1.0 + static_cast<double>(i % 7), i % 2 ? "Мешок" : "Коробка", 5);
+    }
+    auto place = [&](auto&& produce) {
+        std::vector<std::unique_ptr<Warehouse>> sites;
+        std::vector<Warehouse*> warehouses;
+        for (size_t i = 0; i < 4; ++i) {
+            sites.push_back(std::make_unique<Warehouse>("Склад " + std::to_string(i + 1), runs * skus * 2));
+            warehouses.push_back(sites.back().get());
+        }
+        size_t placed = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t run = 0; run < runs; ++run) {
+            placed += produce(warehouses);
+        }
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        return std::make_pair(placed, placed ? ns / static_cast<double>(placed) : 0.0);
+    };
+
+    std::vector<Factory> single;
+    for (const auto& line : output) {
+        single.emplace_back(line.name, line.weight, line.packaging, static_cast<int>(line.quantity));
+    }
+    auto one_by_one = place([&](const std::vector<Warehouse*>& warehouses) {
+        size_t placed = 0;
+        for (auto& factory : single) {
+            placed += factory.storage(warehouses);
+        }
+        return placed;
+    });
+    Factory plant("Завод", output);
+    auto batched = place([&](const std::vector<Warehouse*>& warehouses) { return plant.storage(warehouses); });
+
+    std::cout << "Тактов: " << runs << ", продуктов в выпуске: " << skus << "\n";
+    std::cout << "По одному продукту: " << one_by_one.first << " ед., " << one_by_one.second << " нс на единицу\n";
+    std::cout << "Партией: " << batched.first << " ед., " << batched.second << " нс на единицу\n";
+    return 0;
+}
+
+// FGBU --async [заказов] [обработчиков]: поток генератора нагрузки через OrderDispatcher.
+// Заказы не ждут друг друга: итоги собирает обработчик завершения, первый заказ - через future.
+// Недостача уходит в дозаказы, их исполняют поступления продукции от генератора.
+// Склады для строк ищутся по индексу наличия, который склады обновляют параллельно
+int asyncOrders(size_t orders, unsigned workers) {
+    BenchConfig world;
+    BackorderQueue backorders(BackorderPolicy::Fifo);
+    AvailabilityIndex availability;
+    Topology topology;
+    for (size_t i = 0; i < world.warehouses; ++i) {
+        Warehouse* warehouse = topology.addWarehouse(
+                std::make_unique<Warehouse>("Склад " + std::to_string(i + 1), world.warehouse_capacity));
+        warehouse->attachBackorders(&backorders);
+        availability.registerWarehouse(warehouse);
+    }
+    for (size_t i = 0; i < world.trucks; ++i) {
+        Truck* truck = topology.addTruck(std::make_unique<Truck>("Грузовик " + std::to_string(i + 1), world.truck_capacity));
+        truck->attachBackorders(&backorders);
+        truck->attachIndex(&availability);
+    }
+    ScopedConsole quiet(nullConsole()); // сообщения размещения продукции
+    WorkloadGenerator generator{WorkloadConfig()};
+    std::atomic<uint64_t> complete{0};
+    std::atomic<uint64_t> requested{0};
+    std::atomic<uint64_t> fulfilled{0};
+    std::atomic<uint64_t> split{0}; // строки, собранные с нескольких складов
+    auto tally = [&](const OrderResult& result) {
+        complete.fetch_add(result.complete() ? 1 : 0, std::memory_order_relaxed);
+        requested.fetch_add(result.requested(), std::memory_order_relaxed);
+        fulfilled.fetch_add(result.fulfilled(), std::memory_order_relaxed);
+        for (const auto& line : result.lines) {
+            split.fetch_add(line.sources.size() > 1 ? 1 : 0, std::memory_order_relaxed);
+        }
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    std::future<OrderResult> first;
+    {
+        OrderDispatcher dispatcher(topology, workers);
+        for (size_t submitted = 0; submitted < orders;) {
+            WorkloadEvent event = generator.nextEvent();
+            if (!event.is_order) {
+                Factory factory(generator.productName(event.production.product), 10.0, "Коробка",
+                                static_cast<int>(event.production.quantity));
+                factory.storage(topology);
+                continue;
+            }
+            auto request = generator.toRequest(event.order);
+            std::string shop = generator.shopName(event.order.shop);
+            if (submitted++ == 0) {
+                first = dispatcher.submit(std::move(shop), std::move(request));
+            } else {
+                dispatcher.submit(std::move(shop), std::move(request), tally);
+            }
+        }
+        dispatcher.drain();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    OrderResult example = first.get();
+    tally(example);
+    std::cout << "Первый заказ: " << example.shop << ", грузовик " << example.truck << "\n";
+    for (const auto& line : example.lines) {
+        std::cout << "  " << line.product << ": " << line.fulfilled << " из " << line.requested;
+        for (const auto& source : line.sources) {
+            std::cout << ", " << source.first << " - " << source.second;
+        }
+        if (line.shortfall()) {
+            std::cout << ", недостача " << line.shortfall();
+        }
+        if (line.backorder) {
+            std::cout << ", дозаказ " << line.backorder;
+        }
+        std::cout << "\n";
+    }
+    std::cout << "Заказов: " << orders << " за " << seconds << " с, " << static_cast<double>(orders) / seconds << " заказов/с\n";
+    std::cout << "Выполнено полностью: " << complete << ", спроса: "
+              << (requested ? 100.0 * static_cast<double>(fulfilled) / static_cast<double>(requested) : 100.0)
+              << "%, строк с нескольких складов: " << split << "\n";
+    std::cout << "Дозаказов в очереди: " << backorders.size() << "\n";
+    return 0;
+}
+
+// FGBU --journal <каталог> [заказов]: склады с журналом предзаписи. При запуске инвентарь
+// восстанавливается из снимка и журнала каталога, после потока заказов пишется новый снимок
+// и из журнала удаляются учтённые в нём записи. Повторный запуск продолжает с того же инвентаря
+int journaled(const std::string& dir, size_t orders) {
+    BenchConfig world;
+    const std::string snapshot_path = dir + "/fgbu.snapshot";
+    const std::string wal_path = dir + "/fgbu.wal";
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+
+    WriteAheadLog wal;
+    std::vector<std::unique_ptr<Warehouse>> sites;
+    std::vector<Warehouse*> warehouses;
+    for (size_t i = 0; i < world.warehouses; ++i) {
+        sites.push_back(std::make_unique<Warehouse>("Склад " + std::to_string(i + 1), world.warehouse_capacity));
+        warehouses.push_back(sites.back().get());
+    }
+    Truck truck("Грузовик 1", world.truck_capacity);
+
+    ScopedConsole quiet(nullConsole()); // сообщения размещения и доставки
+    uint64_t replayed = recoverWarehouses(snapshot_path, wal_path, warehouses);
+    size_t recovered = 0;
+    for (auto* warehouse : warehouses) {
+        recovered += warehouse->getLoad().units;
+    }
+    if (!wal.open(wal_path)) {
+        std::cout << "Не удалось открыть журнал " << wal_path << "\n";
+        return 1;
+    }
+    for (auto* warehouse : warehouses) {
+        warehouse->attachJournal(&wal, Durability::Buffered);
+    }
+
+    WorkloadGenerator generator{WorkloadConfig()};
+    size_t requested = 0;
+    size_t fulfilled = 0;
+    for (size_t done = 0; done < orders;) {
+        WorkloadEvent event = generator.nextEvent();
+        if (!event.is_order) {
+            Factory factory(generator.productName(event.production.product), 10.0, "Коробка",
+                            static_cast<int>(event.production.quantity));
+            factory.storage(warehouses);
+            continue;
+        }
+        OrderResult result;
+        truck.deliver(warehouses, generator.shopName(event.order.shop), generator.toRequest(event.order), 0, &result);
+        requested += result.requested();
+        fulfilled += result.fulfilled();
+        ++done;
+    }
+    uint64_t last = wal.lastLsn();
+    bool durable = wal.waitDurable(last);
+
+    uint64_t covered = 0;
+    bool snapshot = durable && writeSnapshot(snapshot_path, warehouses, &covered) && wal.truncateUpTo(covered);
+    for (auto* warehouse : warehouses) {
+        warehouse->attachJournal(nullptr, Durability::None);
+    }
+    wal.close();
+
+    size_t stored = 0;
+    for (auto* warehouse : warehouses) {
+        stored += warehouse->getLoad().units;
+    }
+    std::cout << "Восстановлено: " << recovered << " ед. на складах, журнал проигран до LSN " << replayed << "\n";
+    std::cout << "Заказов: " << orders << ", доставлено " << fulfilled << " из " << requested << " ед., последний LSN "
+              << last << "\n";
+    if (!snapshot) {
+        std::cout << "Не удалось записать снимок " << snapshot_path << "\n";
+        return 1;
+    }
+    std::cout << "Снимок: " << stored << " ед., журнал усечён до LSN " << covered << "\n";
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    // FGBU --sweep <число прогонов>: планирование мощностей методом Монте-Карло
+    if (argc >= 2 && std::string(argv[1]) == "--sweep") {
+        size_t runs = argc >= 3 ? std::stoul(argv[2]) : 1000;
+        printSweepReport(runSweep(SweepConfig(), runs));
+        return 0;
+    }
+    // FGBU --bench <число заказов> [--perf] [--alloc]: поток генератора нагрузки через путь доставки,
+    // --perf добавляет аппаратные счётчики по операциям, --alloc - учёт выделений памяти
+    if (argc >= 2 && std::string(argv[1]) == "--bench") {
+        BenchConfig config;
+        config.orders = argc >= 3 && argv[2][0] != '-' ? std::stoul(argv[2]) : config.orders;
+        for (int i = 2; i < argc; ++i) {
+            config.profile = config.profile || std::string(argv[i]) == "--perf";
+            config.track_allocations = config.track_allocations || std::string(argv[i]) == "--alloc";
+        }
+        printBenchReport(runBenchmark(config));
+        return 0;
+    }
+    if (argc >= 2 && std::string(argv[1]) == "--manifest") {
+        return manifestBench(argc >= 3 ? std::stoul(argv[2]) : 100000, argc >= 4 ? std::stoul(argv[3]) : 20);
+    }
+    if (argc >= 2 && std::string(argv[1]) == "--catalog") {
+        return catalogBench(argc >= 3 ? std::stoul(argv[2]) : 20000000);
+    }
+    if (argc >= 2 && std::string(argv[1]) == "--async") {
+        return asyncOrders(argc >= 3 ? std::stoul(argv[2]) : 200000, argc >= 4 ? static_cast<unsigned>(std::stoul(argv[3])) : 0);
+    }
+    if (argc >= 2 && std::string(argv[1]) == "--timers") {
+        return timers(argc >= 3 ? std::stoul(argv[2]) : 2000000);
+    }
+    if (argc >= 2 && std::string(argv[1]) == "--history") {
+        return history(argc >= 3 ? std::stoul(argv[2]) : 2000000, argc >= 4 ? std::stoul(argv[3]) : 10);
+    }
+    if (argc >= 2 && std::string(argv[1]) == "--rebalance") {
+        return rebalance(argc >= 3 ? std::stoul(argv[2]) : 2000, argc >= 4 ? std::stoul(argv[3]) : 1000);
+    }
+    if (argc >= 2 && std::string(argv[1]) == "--tours") {
+        return tours(argc >= 3 ? std::stoul(argv[2]) : 200, argc >= 4 ? std::stoul(argv[3]) : 10);
+    }
+    if (argc >= 3 && std::string(argv[1]) == "--journal") {
+        return journaled(argv[2], argc >= 4 ? std::stoul(argv[3]) : 20000);
+    }
+    if (argc >= 3 && std::string(argv[1]) == "--serve") {
+        return serve(argv[2], argc >= 4 ? static_cast<unsigned>(std::stoul(argv[3])) : 0);
+    }
+    // FGBU --shm-report <сегмент> [--remove]: отчёт другого процесса по складам в разделяемой памяти
+    if (argc >= 3 && std::string(argv[1]) == "--shm-report") {
+        SharedInventory segment;
+        if (!segment.open(argv[2])) {
+            std::cout << "Не удалось открыть сегмент " << argv[2] << "\n";
+            return 1;
+        }
+        for (uint32_t w = 0; w < segment.warehouseCount(); ++w) {
+            Capacity load = segment.load(w);
+            std::cout << segment.warehouseName(w) << ": загружено " << load.units << " из "
+                      << segment.limits(w).units << " ед.\n";
+            for (const auto& stock : segment.stock(w)) {
+                std::cout << "  " << stock.product << ": " << stock.quantity << " ед.\n";
+            }
+        }
+        if (argc >= 4 && std::string(argv[3]) == "--remove") {
+            SharedInventory::remove(argv[2]);
+        }
+        return 0;
+    }
+    // FGBU --shm <сегмент>: пример ниже зеркалирует склады в разделяемую память
+    SharedInventory segment;
+    if (argc >= 3 && std::string(argv[1]) == "--shm") {
+        SharedInventory::remove(argv[2]);
+        if (!segment.create(argv[2], 16, 256)) {
+            std::cout << "Не удалось создать сегмент " << argv[2] << "\n";
+            return 1;
+        }
+    }
 
-int main() {
     // Создаем склады с названиями и вместимостью
     Warehouse warehouseA("Склад A", 100);
     Warehouse warehouseB("Склад B", 100);
     std::vector<Warehouse*> warehouses = { &warehouseA, &warehouseB };
+    if (segment.isOpen()) {
+        for (auto* warehouse : warehouses) {
+            int32_t id = segment.addWarehouse(warehouse->getName(), Capacity::limits(100));
+            if (id == SharedInventory::kNotFound) {
+                std::cout << "Склад " << warehouse->getName() << " не зарегистрирован в сегменте " << argv[2] << "\n";
+                continue;
+            }
+            warehouse->attachShared(&segment, static_cast<uint32_t>(id));
+        }
+    }
 
     // Создаем грузовики
     Truck truck("Грузовик 1", 10);
@@ -0,0 +1,133 @@
+#include "order_dispatcher.h"
+#include "topology.h"
+
+#include <algorithm>
+#include <memory>
+
+OrderDispatcher::OrderDispatcher(Topology& topology, unsigned workers) : topology(topology) {
+    unsigned count = workers ? workers : std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned i = 0; i < count; ++i) {
+        pool.emplace_back([this] { workerLoop(); });
+    }
+}
+
+OrderDispatcher::~OrderDispatcher() {
+    drain();
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopping = true;
+    }
+    work_cv.notify_all();
+    for (auto& t : pool) {
+        t.join();
+    }
+}
+
+std::future<OrderResult> OrderDispatcher::submit(std::string shop_name, Lines lines, int priority) {
+    // std::function требует копируемого обработчика, поэтому promise разделяемый
+    auto promise = std::make_shared<std::promise<OrderResult>>();
+    std::future<OrderResult> result = promise->get_future();
+    // Исключение при исполнении заказа уходит в future, а не в поток обработчика
+    enqueue({std::move(shop_name), std::move(lines), priority,
+             [promise](OrderResult done) { promise->set_value(std::move(done)); },
+             [promise](std::exception_ptr error) { promise->set_exception(error); }});
+    return result;
+}
+
+void OrderDispatcher::submit(std::string shop_name, Lines lines, Completion done, int priority) {
+    enqueue({std::move(shop_name), std::move(lines), priority, std::move(done), {}});
+}
+
+void OrderDispatcher::enqueue(Task task) {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        tasks.push_back(std::move(task));
+        ++in_flight;
+    }
+    work_cv.notify_one();
+}
+
+void OrderDispatcher::drain() {
+    std::unique_lock<std::mutex> lock(mtx);
+    idle_cv.wait(lock, [&] { return in_flight == 0; });
+}
+
+size_t OrderDispatcher::pending() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return in_flight;
+}
+
+size_t OrderDispatcher::failures() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return failed;
+}
+
+Truck* OrderDispatcher::acquireTruck(const std::vector<Truck*>& trucks, size_t start, std::unique_lock<std::mutex>& lock) {
+    if (trucks.empty()) {
+        return nullptr;
+    }
+    for (size_t i = 0; i < trucks.size(); ++i) {
+        Truck* candidate = trucks[(start + i) % trucks.size()];
+        std::unique_lock<std::mutex> attempt(candidate->mtx, std::try_to_lock);
+        if (attempt.owns_lock()) {
+            lock = std::move(attempt);
+            return candidate;
+        }
+    }
+    Truck* truck = trucks[start % trucks.size()];
+    lock = std::unique_lock<std::mutex>(truck->mtx);
+    return truck;
+}
+
+OrderResult OrderDispatcher::execute(const Task& task, size_t start) {
+    Topology::Reader fleet(topology); // состав сети на время заказа
+    std::unique_lock<std::mutex> truck_lock;
+    Truck* truck = acquireTruck(fleet.trucks(), start, truck_lock);
+    OrderResult result;
+    if (!truck) {
+        result.shop = task.shop_name;
+        for (const auto& line : task.lines) {
+            result.lines.push_back({line.first, line.second, 0, {}, 0});
+        }
+        return result;
+    }
+    truck->deliver(fleet.warehouses(), task.shop_name, task.lines, task.priority, &result);
+    return result;
+}
+
+void OrderDispatcher::workerLoop() {
+    ScopedConsole quiet(nullConsole()); // итог заказа возвращается в OrderResult
+    while (true) {
+        Task task;
+        size_t start;
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            work_cv.wait(lock, [&] { return stopping || !tasks.empty(); });
+            if (tasks.empty()) {
+                return;
+            }
+            task = std::move(tasks.front());
+            tasks.pop_front();
+            start = next_truck++;
+        }
+        // Исключение не должно покинуть поток пула (std::terminate) и оставить заказ
+        // в in_flight навсегда: drain и деструктор ждали бы его бесконечно
+        bool ok = true;
+        try {
+            task.done(execute(task, start));
+        } catch (...) {
+            ok = false;
+            if (task.failed) {
+                task.failed(std::current_exception());
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            failed += ok ? 0 : 1;
+            if (--in_flight != 0) {
+                continue;
+            }
+        }
+        idle_cv.notify_all();
+    }
+}
@@ -0,0 +1,77 @@
+#ifndef ORDER_DISPATCHER_H
+#define ORDER_DISPATCHER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "classes.h"
+
+class Topology;
+
+// Асинхронный приём заказов: submit ставит заказ в очередь и сразу
+// возвращается, пул обработчиков исполняет его на свободном грузовике и
+// отдаёт OrderResult через future или обработчик завершения. Сколько бы
+// заказов ни было в полёте, потоков столько, сколько обработчиков.
+// Обработчик завершения вызывается в потоке пула и не должен ждать
+// других заказов этого же диспетчера. Сообщения классов при исполнении
+// не выводятся: итог - в OrderResult. Исключение при исполнении заказа
+// future передаёт вызывающему; у заказа с обработчиком завершения оно,
+// как и исключение самого обработчика, только учитывается в failures().
+class OrderDispatcher {
+public:
+    using Lines = std::map<std::string, size_t>;
+    using Completion = std::function<void(OrderResult)>;
+    using Failure = std::function<void(std::exception_ptr)>;
+
+    explicit OrderDispatcher(Topology& topology, unsigned workers = 0);
+    // Дожидается всех принятых заказов
+    ~OrderDispatcher();
+    OrderDispatcher(const OrderDispatcher&) = delete;
+    OrderDispatcher& operator=(const OrderDispatcher&) = delete;
+
+    std::future<OrderResult> submit(std::string shop_name, Lines lines, int priority = 0);
+    void submit(std::string shop_name, Lines lines, Completion done, int priority = 0);
+    // Ждёт, пока исполнятся все заказы, принятые до вызова и во время него
+    void drain();
+    size_t pending() const;
+    // Заказы, исполнение или обработчик завершения которых бросили исключение
+    size_t failures() const;
+
+    // Свободный грузовик из trucks, начиная с start по кругу; если заняты все,
+    // ждёт trucks[start]. Возвращает грузовик, lock держит его mtx; nullptr - грузовиков нет
+    static Truck* acquireTruck(const std::vector<Truck*>& trucks, size_t start, std::unique_lock<std::mutex>& lock);
+
+private:
+    struct Task {
+        std::string shop_name;
+        Lines lines;
+        int priority = 0;
+        Completion done;
+        Failure failed; // пусто - исключение только учитывается
+    };
+
+    Topology& topology;
+    mutable std::mutex mtx;
+    std::condition_variable work_cv;
+    std::condition_variable idle_cv;
+    std::deque<Task> tasks;
+    size_t in_flight = 0; // в очереди и исполняются
+    size_t failed = 0;
+    size_t next_truck = 0;
+    bool stopping = false;
+    std::vector<std::thread> pool;
+
+    void enqueue(Task task);
+    void workerLoop();
+    OrderResult execute(const Task& task, size_t start);
+};
+
+#endif // ORDER_DISPATCHER_H
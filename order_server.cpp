@@ -0,0 +1,429 @@
+#include "order_server.h"
+#include "classes.h"
+#include "order_dispatcher.h"
+#include "topology.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr uint64_t kListenerId = 0;
+constexpr uint64_t kWakeId = 1;
+constexpr size_t kWorkerBatch = 16; // меньше порция - быстрее срочный заказ попадает к свободному обработчику
+constexpr uint64_t kStride = 1 << 20;  // шаг виртуального времени класса с весом 1
+
+// Приоритет дозаказа по классу заказа: срочный выше, крупный ниже, Standard - 0, как у прочих заказов
+int backorderPriority(OrderClass order_class) {
+    return 1 - static_cast<int>(order_class);
+}
+
+// Поля ответа 32-битные: сумма строк заказа (до 255 строк по UINT32_MAX) в них не всегда помещается
+uint32_t clampCount(uint64_t count) {
+    return static_cast<uint32_t>(std::min<uint64_t>(count, UINT32_MAX));
+}
+
+bool addToEpoll(int epoll_fd, int fd, uint32_t events, uint64_t id) {
+    epoll_event ev{};
+    ev.events = events;
+    ev.data.u64 = id;
+    return epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) == 0;
+}
+
+} // namespace
+
+OrderServer::OrderServer(Topology& topology, unsigned workers, const AdmissionConfig& admission)
+        : topology(topology),
+          worker_count(workers ? workers : std::max(1u, std::thread::hardware_concurrency())),
+          admission(admission) {}
+
+OrderServer::~OrderServer() {
+    for (auto& entry : connections) {
+        ::close(entry.second.fd);
+    }
+    for (int fd : {listen_fd, epoll_fd, wake_fd}) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+    if (!path.empty()) {
+        unlink(path.c_str());
+    }
+}
+
+bool OrderServer::listen(const std::string& socket_path) {
+    sockaddr_un addr{};
+    if (socket_path.size() >= sizeof(addr.sun_path)) {
+        return false;
+    }
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, socket_path.c_str(), socket_path.size() + 1);
+
+    listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (listen_fd < 0 || epoll_fd < 0 || wake_fd < 0) {
+        return false;
+    }
+    unlink(socket_path.c_str());
+    if (bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(listen_fd, SOMAXCONN) != 0) {
+        return false;
+    }
+    path = socket_path;
+    return addToEpoll(epoll_fd, listen_fd, EPOLLIN, kListenerId) && addToEpoll(epoll_fd, wake_fd, EPOLLIN, kWakeId);
+}
+
+void OrderServer::run() {
+    std::vector<std::thread> pool;
+    for (unsigned i = 0; i < worker_count; ++i) {
+        pool.emplace_back(&OrderServer::workerLoop, this);
+    }
+
+    epoll_event events[256];
+    while (!stopping.load(std::memory_order_acquire)) {
+        int n = epoll_wait(epoll_fd, events, 256, -1);
+        if (n < 0 && errno != EINTR) {
+            break;
+        }
+        for (int i = 0; i < n; ++i) {
+            uint64_t id = events[i].data.u64;
+            if (id == kListenerId) {
+                acceptConnections();
+            } else if (id == kWakeId) {
+                uint64_t counter = 0;
+                while (read(wake_fd, &counter, sizeof(counter)) > 0) {
+                }
+                deliverCompletions();
+            } else {
+                if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                    readConnection(id);
+                }
+                if ((events[i].events & EPOLLOUT) && connections.count(id)) {
+                    flushConnection(id);
+                }
+            }
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(jobs_mtx);
+        workers_stop = true;
+    }
+    jobs_cv.notify_all();
+    for (auto& t : pool) {
+        t.join();
+    }
+}
+
+void OrderServer::stop() {
+    stopping.store(true, std::memory_order_release);
+    uint64_t one = 1;
+    if (write(wake_fd, &one, sizeof(one)) < 0) {
+        // счётчик eventfd переполнен - цикл и так проснётся
+    }
+}
+
+ServerStats OrderServer::stats() const {
+    ServerStats s;
+    s.connections = stat_connections.load(std::memory_order_relaxed);
+    s.orders = stat_orders.load(std::memory_order_relaxed);
+    s.productions = stat_productions.load(std::memory_order_relaxed);
+    s.malformed = stat_malformed.load(std::memory_order_relaxed);
+    s.invalid = stat_invalid.load(std::memory_order_relaxed);
+    for (size_t c = 0; c < kOrderClasses; ++c) {
+        s.admitted[c] = stat_admitted[c].load(std::memory_order_relaxed);
+        s.shed[c] = stat_shed[c].load(std::memory_order_relaxed);
+    }
+    std::lock_guard<std::mutex> lock(jobs_mtx);
+    s.wait_us = wait_us;
+    return s;
+}
+
+void OrderServer::acceptConnections() {
+    while (true) {
+        int fd = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            return; // EAGAIN: очередь принятия пуста
+        }
+        uint64_t id = next_connection++;
+        if (!addToEpoll(epoll_fd, fd, EPOLLIN | EPOLLRDHUP, id)) {
+            ::close(fd);
+            continue;
+        }
+        connections[id].fd = fd;
+        stat_connections.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void OrderServer::readConnection(uint64_t id) {
+    auto it = connections.find(id);
+    if (it == connections.end()) {
+        return;
+    }
+    Connection& conn = it->second;
+    char buffer[64 * 1024];
+    bool closed = false;
+    while (true) {
+        ssize_t n = read(conn.fd, buffer, sizeof(buffer));
+        if (n > 0) {
+            conn.in.append(buffer, static_cast<size_t>(n));
+            continue;
+        }
+        if (n == 0 || (errno != EAGAIN && errno != EINTR)) {
+            closed = true;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        break;
+    }
+
+    // Все целые кадры уходят обработчикам одной порцией
+    std::vector<Job> batch;
+    std::vector<Response> rejected;
+    size_t offset = 0;
+    while (offset < conn.in.size()) {
+        Job job{id, {}, {}};
+        size_t consumed = 0;
+        DecodeStatus status = decodeRequest(conn.in.data() + offset, conn.in.size() - offset, consumed, job.request);
+        if (status == DecodeStatus::Incomplete) {
+            break;
+        }
+        if (status == DecodeStatus::Malformed) {
+            stat_malformed.fetch_add(1, std::memory_order_relaxed);
+            closed = true;
+            break;
+        }
+        offset += consumed;
+        if (status == DecodeStatus::Invalid) {
+            stat_invalid.fetch_add(1, std::memory_order_relaxed);
+            rejected.push_back(Response{job.request.id, ResponseStatus::BadRequest, 0, 0});
+            continue;
+        }
+        batch.push_back(std::move(job));
+    }
+    conn.in.erase(0, offset);
+    if (!batch.empty()) {
+        auto now = std::chrono::steady_clock::now();
+        size_t queued = 0;
+        {
+            std::lock_guard<std::mutex> lock(jobs_mtx);
+            for (auto& job : batch) {
+                bool order = job.request.type == MessageType::Order;
+                OrderClass order_class = order ? job.request.order_class : OrderClass::Standard;
+                auto c = static_cast<size_t>(order_class);
+                if (order) {
+                    if (!admit(order_class)) {
+                        stat_shed[c].fetch_add(1, std::memory_order_relaxed);
+                        Response response{job.request.id, ResponseStatus::Overloaded, 0, 0};
+                        for (const auto& line : job.request.lines) {
+                            response.requested += static_cast<uint32_t>(line.second);
+                        }
+                        rejected.push_back(response);
+                        continue;
+                    }
+                    stat_admitted[c].fetch_add(1, std::memory_order_relaxed);
+                }
+                // Класс, простаивавший без заказов, не копит кредит на будущее
+                if (jobs[c].empty()) {
+                    pass[c] = std::max(pass[c], virtual_time);
+                }
+                job.queued = now;
+                jobs[c].push_back(std::move(job));
+                ++queued;
+            }
+        }
+        if (queued) {
+            jobs_cv.notify_all();
+        }
+    }
+    if (closed) {
+        closeConnection(id);
+        return;
+    }
+    if (!rejected.empty()) {
+        for (const auto& response : rejected) {
+            encodeResponse(conn.out, response);
+        }
+        flushConnection(id);
+    }
+}
+
+bool OrderServer::admit(OrderClass order_class) const {
+    auto c = static_cast<size_t>(order_class);
+    size_t limit = admission.max_depth[c];
+    bool overloaded = wait_us[static_cast<size_t>(OrderClass::Express)] > admission.express_wait_us;
+    if (overloaded && order_class == OrderClass::Bulk) {
+        limit /= 4;
+    }
+    return jobs[c].size() < limit;
+}
+
+bool OrderServer::nextJob(Job& job) {
+    const auto express = static_cast<size_t>(OrderClass::Express);
+    const auto bulk = static_cast<size_t>(OrderClass::Bulk);
+    const bool overloaded = wait_us[express] > admission.express_wait_us;
+    size_t best = kOrderClasses;
+    for (size_t c = 0; c < kOrderClasses; ++c) {
+        if (jobs[c].empty() || (overloaded && c == bulk && best != kOrderClasses)) {
+            continue; // при перегрузке Bulk ждёт, пока есть другие заказы
+        }
+        if (best == kOrderClasses || pass[c] < pass[best]) {
+            best = c;
+        }
+    }
+    if (best == kOrderClasses) {
+        return false;
+    }
+    job = std::move(jobs[best].front());
+    jobs[best].pop_front();
+    virtual_time = pass[best];
+    pass[best] += kStride / std::max(1u, admission.weights[best]);
+
+    double waited = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - job.queued).count();
+    wait_us[best] += admission.ewma_alpha * (waited - wait_us[best]);
+    if (best != express && jobs[express].empty()) {
+        wait_us[express] -= admission.ewma_alpha * wait_us[express]; // срочный заказ сейчас не ждал бы
+    }
+    return true;
+}
+
+void OrderServer::flushConnection(uint64_t id) {
+    Connection& conn = connections[id];
+    while (conn.out_offset < conn.out.size()) {
+        ssize_t n = send(conn.fd, conn.out.data() + conn.out_offset, conn.out.size() - conn.out_offset, MSG_NOSIGNAL);
+        if (n > 0) {
+            conn.out_offset += static_cast<size_t>(n);
+            continue;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && errno == EAGAIN) {
+            break;
+        }
+        closeConnection(id);
+        return;
+    }
+    if (conn.out_offset == conn.out.size()) {
+        conn.out.clear();
+        conn.out_offset = 0;
+    }
+    // EPOLLOUT нужен, только пока в буфере остаются неотправленные ответы
+    bool want_write = !conn.out.empty();
+    if (want_write != conn.want_write) {
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLRDHUP | (want_write ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+        ev.data.u64 = id;
+        epoll_ctl(epoll_fd, EPOLL_CTL_MOD, conn.fd, &ev);
+        conn.want_write = want_write;
+    }
+}
+
+void OrderServer::closeConnection(uint64_t id) {
+    auto it = connections.find(id);
+    if (it == connections.end()) {
+        return;
+    }
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, it->second.fd, nullptr);
+    ::close(it->second.fd);
+    connections.erase(it); // ответы на уже принятые запросы будут отброшены
+}
+
+void OrderServer::deliverCompletions() {
+    std::vector<Completion> ready;
+    {
+        std::lock_guard<std::mutex> lock(done_mtx);
+        ready.swap(done);
+    }
+    std::vector<uint64_t> touched;
+    for (const auto& completion : ready) {
+        auto it = connections.find(completion.connection);
+        if (it == connections.end()) {
+            continue;
+        }
+        if (it->second.out.empty()) {
+            touched.push_back(completion.connection);
+        }
+        encodeResponse(it->second.out, completion.response);
+    }
+    for (uint64_t id : touched) {
+        if (connections.count(id)) {
+            flushConnection(id);
+        }
+    }
+}
+
+void OrderServer::workerLoop() {
+    ScopedConsole quiet(nullConsole()); // сообщения классов на каждый заказ сервису не нужны
+    std::vector<Job> batch;
+    std::vector<Completion> results;
+    while (true) {
+        batch.clear();
+        {
+            std::unique_lock<std::mutex> lock(jobs_mtx);
+            jobs_cv.wait(lock, [&] {
+                return workers_stop || std::any_of(jobs.begin(), jobs.end(), [](const auto& queue) { return !queue.empty(); });
+            });
+            if (workers_stop) {
+                return;
+            }
+            Job job;
+            while (batch.size() < kWorkerBatch && nextJob(job)) {
+                batch.push_back(std::move(job));
+            }
+        }
+
+        results.clear();
+        for (const auto& job : batch) {
+            results.push_back({job.connection, execute(job.request)});
+        }
+        {
+            std::lock_guard<std::mutex> lock(done_mtx);
+            done.insert(done.end(), results.begin(), results.end());
+        }
+        uint64_t one = 1;
+        if (write(wake_fd, &one, sizeof(one)) < 0) {
+            // цикл уже разбужен
+        }
+    }
+}
+
+Response OrderServer::execute(const Request& request) {
+    Response response;
+    response.id = request.id;
+    Topology::Reader fleet(topology); // состав сети на время запроса
+    const std::vector<Truck*>& trucks = fleet.trucks();
+    if (request.type == MessageType::Production) {
+        stat_productions.fetch_add(1, std::memory_order_relaxed);
+        const ProductionMessage& m = request.production;
+        Factory factory(m.product, m.weight, m.packaging, static_cast<int>(m.quantity)); // decodeRequest: не больше INT_MAX
+        response.requested = m.quantity;
+        response.completed = static_cast<uint32_t>(factory.storage(fleet.warehouses()));
+        return response;
+    }
+
+    stat_orders.fetch_add(1, std::memory_order_relaxed);
+    if (trucks.empty()) {
+        response.status = ResponseStatus::BadRequest;
+        return response;
+    }
+    uint64_t requested = 0;
+    for (const auto& line : request.lines) {
+        requested += line.second;
+    }
+    response.requested = clampCount(requested);
+    std::unique_lock<std::mutex> truck_lock;
+    Truck* truck = OrderDispatcher::acquireTruck(trucks, next_truck.fetch_add(1, std::memory_order_relaxed), truck_lock);
+    OrderResult result;
+    // Класс заказа действует и после приёма: недостача встаёт в дозаказ с его приоритетом
+    truck->deliver(fleet.warehouses(), request.shop, request.lines, backorderPriority(request.order_class), &result);
+    response.completed = clampCount(result.fulfilled());
+    return response;
+}
@@ -0,0 +1,130 @@
+#ifndef ORDER_SERVER_H
+#define ORDER_SERVER_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "protocol.h"
+
+class Topology;
+
+struct ServerStats {
+    uint64_t connections = 0;
+    uint64_t orders = 0;
+    uint64_t productions = 0;
+    uint64_t malformed = 0;
+    uint64_t invalid = 0; // кадр цел, значения недопустимы: ответ BadRequest
+    std::array<uint64_t, kOrderClasses> admitted{}; // по OrderClass
+    std::array<uint64_t, kOrderClasses> shed{};     // ответ Overloaded
+    std::array<double, kOrderClasses> wait_us{};    // сглаженное ожидание в очереди
+};
+
+// Приоритеты и допуск заказов. Обработчики берут заказы из очередей классов
+// взвешенно-справедливо: при полной загрузке класс получает долю weights.
+// Перегрузка - сглаженное ожидание срочных заказов выше express_wait_us:
+// тогда Bulk откладывается (берётся, только когда остальные очереди пусты)
+// и принимается лишь до четверти своей глубины. Заказ сверх max_depth
+// своего класса сразу получает Overloaded. Партии производства пополняют
+// склады, поэтому идут как Standard и не отклоняются.
+struct AdmissionConfig {
+    std::array<unsigned, kOrderClasses> weights{8, 4, 1};
+    std::array<size_t, kOrderClasses> max_depth{65536, 16384, 4096};
+    double express_wait_us = 2000;
+    double ewma_alpha = 0.05; // вес нового замера в сглаженном ожидании
+};
+
+// Сервер приёма заказов и отчётов о производстве по Unix domain socket.
+// Один поток ведёт цикл epoll: принимает соединения, читает кадры протокола
+// (protocol.h) и отдаёт их пулу обработчиков. Обработчики выполняют Truck::deliver
+// и Factory::storage по опубликованному составу сети (topology.h), поэтому
+// склады и грузовики можно добавлять и выводить, не останавливая сервер;
+// ответы складываются в очередь, цикл будится через eventfd;
+// цикл дописывает ответы в буферы соединений. Запросы одного соединения
+// обрабатываются параллельно, поэтому ответы могут прийти не в порядке запросов.
+// Заказы ждут в очередях своих классов (AdmissionConfig).
+class OrderServer {
+public:
+    OrderServer(Topology& topology, unsigned workers = 0, const AdmissionConfig& admission = AdmissionConfig());
+    ~OrderServer();
+    OrderServer(const OrderServer&) = delete;
+    OrderServer& operator=(const OrderServer&) = delete;
+
+    bool listen(const std::string& socket_path);
+    // Цикл обработки до вызова stop()
+    void run();
+    // Можно вызывать из другого потока и из обработчика сигнала
+    void stop();
+    ServerStats stats() const;
+
+private:
+    struct Connection {
+        int fd = -1;
+        std::string in;
+        std::string out;
+        size_t out_offset = 0;
+        bool want_write = false;
+    };
+    struct Job {
+        uint64_t connection;
+        Request request;
+        std::chrono::steady_clock::time_point queued;
+    };
+    struct Completion {
+        uint64_t connection;
+        Response response;
+    };
+
+    Topology& topology;
+    unsigned worker_count;
+    std::string path;
+    int listen_fd = -1;
+    int epoll_fd = -1;
+    int wake_fd = -1;
+    std::atomic<bool> stopping{false};
+
+    std::unordered_map<uint64_t, Connection> connections;
+    uint64_t next_connection = 2; // 0 - слушающий сокет, 1 - eventfd
+
+    AdmissionConfig admission;
+    mutable std::mutex jobs_mtx;
+    std::condition_variable jobs_cv;
+    std::array<std::deque<Job>, kOrderClasses> jobs; // по OrderClass
+    std::array<uint64_t, kOrderClasses> pass{};      // виртуальное время класса для взвешенного выбора
+    uint64_t virtual_time = 0;                       // время последнего выбранного заказа
+    std::array<double, kOrderClasses> wait_us{};     // под jobs_mtx
+    bool workers_stop = false;
+
+    std::mutex done_mtx;
+    std::vector<Completion> done;
+
+    std::atomic<size_t> next_truck{0};
+    std::atomic<uint64_t> stat_connections{0};
+    std::atomic<uint64_t> stat_orders{0};
+    std::atomic<uint64_t> stat_productions{0};
+    std::atomic<uint64_t> stat_malformed{0};
+    std::atomic<uint64_t> stat_invalid{0};
+    std::array<std::atomic<uint64_t>, kOrderClasses> stat_admitted{};
+    std::array<std::atomic<uint64_t>, kOrderClasses> stat_shed{};
+
+    void acceptConnections();
+    void readConnection(uint64_t id);
+    void flushConnection(uint64_t id);
+    void closeConnection(uint64_t id);
+    void deliverCompletions();
+    void workerLoop();
+    // Под jobs_mtx: принять ли заказ класса в очередь
+    bool admit(OrderClass order_class) const;
+    // Под jobs_mtx: следующий заказ по весам классов; false - очереди пусты
+    bool nextJob(Job& job);
+    Response execute(const Request& request);
+};
+
+#endif // ORDER_SERVER_H
@@ -0,0 +1,204 @@
+#include "perf_counters.h"
+#include "alloc_tracking.h"
+#include "logging.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+std::atomic<bool> profiling{false};
+
+struct RegionTotals {
+    std::atomic<uint64_t> calls{0};
+    std::atomic<uint64_t> nanoseconds{0};
+    std::atomic<uint64_t> events[PerfEventCount] = {};
+};
+
+RegionTotals region_totals[static_cast<size_t>(ProfileRegion::Count)];
+
+// Группа счётчиков текущего потока: лидер - циклы, остальные читаются вместе с ним одним read
+class CounterGroup {
+public:
+    CounterGroup() {
+        static const std::pair<uint32_t, uint64_t> configs[PerfEventCount] = {
+                {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+                {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+                {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+                {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+        };
+        for (size_t i = 0; i < PerfEventCount; ++i) {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = configs[i].first;
+            attr.config = configs[i].second;
+            attr.disabled = leader < 0 ? 1 : 0;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP;
+            int fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0));
+            if (fd < 0) {
+                if (leader < 0) {
+                    return; // без лидера группа невозможна
+                }
+                continue;
+            }
+            if (leader < 0) {
+                leader = fd;
+            }
+            fds[i] = fd;
+            slot[i] = opened++;
+        }
+        ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+
+    ~CounterGroup() {
+        for (int fd : fds) {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+    }
+
+    bool has(PerfEvent event) const { return fds[event] >= 0; }
+
+    void read(uint64_t* out) const {
+        if (leader < 0) {
+            return;
+        }
+        uint64_t buffer[1 + PerfEventCount] = {};
+        if (::read(leader, buffer, sizeof(buffer)) <= 0) {
+            return;
+        }
+        for (size_t i = 0; i < PerfEventCount; ++i) {
+            if (fds[i] >= 0 && slot[i] < buffer[0]) {
+                out[i] = buffer[1 + slot[i]];
+            }
+        }
+    }
+
+private:
+    int leader = -1;
+    int fds[PerfEventCount] = {-1, -1, -1, -1};
+    uint64_t slot[PerfEventCount] = {};
+    uint64_t opened = 0;
+};
+
+CounterGroup& threadCounters() {
+    thread_local CounterGroup group;
+    return group;
+}
+
+uint64_t nowNs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+} // namespace
+
+const char* profileRegionName(ProfileRegion region) {
+    switch (region) {
+        case ProfileRegion::WarehouseUnload: return "Warehouse::unload";
+        case ProfileRegion::FactoryStorage: return "Factory::storage";
+        case ProfileRegion::TruckDeliver: return "Truck::deliver";
+        default: return "?";
+    }
+}
+
+namespace perf {
+
+void enable(bool on) {
+    profiling.store(on, std::memory_order_relaxed);
+}
+
+bool enabled() {
+    return profiling.load(std::memory_order_relaxed);
+}
+
+bool available(PerfEvent event) {
+    return threadCounters().has(event);
+}
+
+PerfTotals totals(ProfileRegion region) {
+    const RegionTotals& r = region_totals[static_cast<size_t>(region)];
+    PerfTotals t;
+    t.calls = r.calls.load(std::memory_order_relaxed);
+    t.nanoseconds = r.nanoseconds.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < PerfEventCount; ++i) {
+        t.events[i] = r.events[i].load(std::memory_order_relaxed);
+    }
+    return t;
+}
+
+void reset() {
+    for (auto& r : region_totals) {
+        r.calls = 0;
+        r.nanoseconds = 0;
+        for (auto& e : r.events) {
+            e = 0;
+        }
+    }
+}
+
+void printReport() {
+    static const char* names[PerfEventCount] = {"циклов", "инструкций", "промахов LLC", "ошибок предсказания"};
+    console() << "Профиль (на одну операцию, вложенные участки включительно):\n";
+    for (size_t r = 0; r < static_cast<size_t>(ProfileRegion::Count); ++r) {
+        PerfTotals t = totals(static_cast<ProfileRegion>(r));
+        if (t.calls == 0) {
+            continue;
+        }
+        double calls = static_cast<double>(t.calls);
+        console() << profileRegionName(static_cast<ProfileRegion>(r)) << ": вызовов " << t.calls
+                  << ", " << static_cast<double>(t.nanoseconds) / calls << " нс";
+        for (size_t e = 0; e < PerfEventCount; ++e) {
+            console() << ", " << names[e] << " ";
+            if (available(static_cast<PerfEvent>(e))) {
+                console() << static_cast<double>(t.events[e]) / calls;
+            } else {
+                console() << "н/д";
+            }
+        }
+        if (available(PerfCycles) && available(PerfInstructions) && t.events[PerfCycles] > 0) {
+            console() << ", IPC " << static_cast<double>(t.events[PerfInstructions]) / static_cast<double>(t.events[PerfCycles]);
+        }
+        console() << "\n";
+    }
+    if (!available(PerfCycles)) {
+        console() << "Аппаратные счётчики недоступны (perf_event_open), показаны только вызовы и время.\n";
+    }
+}
+
+} // namespace perf
+
+PerfScope::PerfScope(ProfileRegion region)
+        : region(region), previous_region(alloc::enterRegion(region)), active(perf::enabled()) {
+    if (active) {
+        threadCounters().read(start);
+        start_ns = nowNs();
+    }
+}
+
+PerfScope::~PerfScope() {
+    alloc::leaveRegion(previous_region);
+    if (!active) {
+        return;
+    }
+    uint64_t end_ns = nowNs();
+    uint64_t end[PerfEventCount] = {};
+    threadCounters().read(end);
+
+    RegionTotals& r = region_totals[static_cast<size_t>(region)];
+    r.calls.fetch_add(1, std::memory_order_relaxed);
+    r.nanoseconds.fetch_add(end_ns - start_ns, std::memory_order_relaxed);
+    for (size_t i = 0; i < PerfEventCount; ++i) {
+        r.events[i].fetch_add(end[i] - start[i], std::memory_order_relaxed);
+    }
+}
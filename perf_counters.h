@@ -0,0 +1,62 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <cstdint>
+
+// Участки кода, которые можно профилировать аппаратными счётчиками
+enum class ProfileRegion : uint8_t {
+    WarehouseUnload,
+    FactoryStorage,
+    TruckDeliver,
+    Count
+};
+
+const char* profileRegionName(ProfileRegion region);
+
+enum PerfEvent : uint8_t {
+    PerfCycles,
+    PerfInstructions,
+    PerfLlcMisses,
+    PerfBranchMisses,
+    PerfEventCount
+};
+
+struct PerfTotals {
+    uint64_t calls = 0;
+    uint64_t nanoseconds = 0;
+    uint64_t events[PerfEventCount] = {};
+};
+
+// Профилирование через perf_event_open (Linux). Включается явно; если счётчики
+// недоступны (нет прав, виртуализация), считаются только вызовы и время.
+namespace perf {
+
+void enable(bool on);
+bool enabled();
+// Открыт ли счётчик события в текущем потоке
+bool available(PerfEvent event);
+PerfTotals totals(ProfileRegion region);
+void reset();
+void printReport();
+
+} // namespace perf
+
+// Замер участка: при выключенном профилировании стоит пару атомарных загрузок.
+// Вложенные участки считаются включительно (deliver включает unload).
+// Заодно ставит метку участка для учёта выделений памяти (alloc_tracking.h).
+class PerfScope {
+public:
+    explicit PerfScope(ProfileRegion region);
+    ~PerfScope();
+    PerfScope(const PerfScope&) = delete;
+    PerfScope& operator=(const PerfScope&) = delete;
+
+private:
+    ProfileRegion region;
+    ProfileRegion previous_region;
+    bool active;
+    uint64_t start_ns = 0;
+    uint64_t start[PerfEventCount] = {};
+};
+
+#endif // PERF_COUNTERS_H
@@ -0,0 +1,184 @@
+#include "protocol.h"
+
+#include <climits>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+constexpr size_t kHeaderBytes = sizeof(uint32_t) + sizeof(uint8_t) + sizeof(uint64_t);
+
+template <typename T>
+void put(std::string& out, T value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+bool putString(std::string& out, std::string_view s) {
+    if (s.size() > 255) {
+        return false; // обрезанное имя означало бы другой продукт или магазин
+    }
+    put<uint8_t>(out, static_cast<uint8_t>(s.size()));
+    out.append(s.data(), s.size());
+    return true;
+}
+
+template <typename T>
+bool get(const char*& p, const char* end, T& value) {
+    if (static_cast<size_t>(end - p) < sizeof(T)) {
+        return false;
+    }
+    std::memcpy(&value, p, sizeof(T));
+    p += sizeof(T);
+    return true;
+}
+
+bool getString(const char*& p, const char* end, std::string& s) {
+    uint8_t len = 0;
+    if (!get(p, end, len) || static_cast<size_t>(end - p) < len) {
+        return false;
+    }
+    s.assign(p, len);
+    p += len;
+    return true;
+}
+
+// Заголовок кадра дописывается в начало, длина проставляется в finishFrame
+size_t beginFrame(std::string& out, MessageType type, uint64_t id) {
+    size_t start = out.size();
+    put<uint32_t>(out, 0);
+    put<uint8_t>(out, static_cast<uint8_t>(type));
+    put<uint64_t>(out, id);
+    return start;
+}
+
+// ok - тело кадра закодировано; иначе начатый кадр убирается из out
+bool finishFrame(std::string& out, size_t start, bool ok) {
+    if (!ok) {
+        out.resize(start);
+        return false;
+    }
+    auto length = static_cast<uint32_t>(out.size() - start - sizeof(uint32_t));
+    std::memcpy(&out[start], &length, sizeof(length));
+    return true;
+}
+
+// Общая часть разбора: длина, тип и номер; body/end - тело кадра
+DecodeStatus readHeader(const char* data, size_t size, size_t& consumed, uint8_t& type, uint64_t& id,
+                        const char*& body, const char*& end) {
+    if (size < sizeof(uint32_t)) {
+        return DecodeStatus::Incomplete;
+    }
+    uint32_t length = 0;
+    std::memcpy(&length, data, sizeof(length));
+    if (length + sizeof(uint32_t) < kHeaderBytes || length > kMaxFrameBytes) {
+        return DecodeStatus::Malformed;
+    }
+    if (size < length + sizeof(uint32_t)) {
+        return DecodeStatus::Incomplete;
+    }
+    consumed = length + sizeof(uint32_t);
+    const char* p = data + sizeof(uint32_t);
+    end = data + consumed;
+    get(p, end, type);
+    get(p, end, id);
+    body = p;
+    return DecodeStatus::Ok;
+}
+
+} // namespace
+
+bool encodeOrder(std::string& out, uint64_t id, std::string_view shop,
+                 const std::vector<std::pair<std::string_view, uint32_t>>& lines, OrderClass order_class) {
+    size_t start = beginFrame(out, MessageType::Order, id);
+    bool ok = lines.size() <= 255 && putString(out, shop);
+    if (ok) {
+        put<uint8_t>(out, static_cast<uint8_t>(lines.size()));
+    }
+    for (size_t i = 0; ok && i < lines.size(); ++i) {
+        ok = putString(out, lines[i].first);
+        put<uint32_t>(out, lines[i].second);
+    }
+    put<uint8_t>(out, static_cast<uint8_t>(order_class));
+    return finishFrame(out, start, ok);
+}
+
+bool encodeProduction(std::string& out, uint64_t id, const ProductionMessage& production) {
+    size_t start = beginFrame(out, MessageType::Production, id);
+    bool ok = putString(out, production.product);
+    put<double>(out, production.weight);
+    ok = ok && putString(out, production.packaging);
+    put<uint32_t>(out, production.quantity);
+    return finishFrame(out, start, ok);
+}
+
+void encodeResponse(std::string& out, const Response& response) {
+    size_t start = beginFrame(out, MessageType::Response, response.id);
+    put<uint8_t>(out, static_cast<uint8_t>(response.status));
+    put<uint32_t>(out, response.requested);
+    put<uint32_t>(out, response.completed);
+    finishFrame(out, start, true);
+}
+
+DecodeStatus decodeRequest(const char* data, size_t size, size_t& consumed, Request& request) {
+    uint8_t type = 0;
+    const char* p = nullptr;
+    const char* end = nullptr;
+    DecodeStatus status = readHeader(data, size, consumed, type, request.id, p, end);
+    if (status != DecodeStatus::Ok) {
+        return status;
+    }
+    request.type = static_cast<MessageType>(type);
+    if (request.type == MessageType::Order) {
+        uint8_t count = 0;
+        request.lines.clear();
+        if (!getString(p, end, request.shop) || !get(p, end, count)) {
+            return DecodeStatus::Malformed;
+        }
+        std::string product;
+        for (uint8_t i = 0; i < count; ++i) {
+            uint32_t quantity = 0;
+            if (!getString(p, end, product) || !get(p, end, quantity)) {
+                return DecodeStatus::Malformed;
+            }
+            request.lines[product] += quantity;
+        }
+        request.order_class = OrderClass::Standard;
+        uint8_t order_class = 0;
+        if (p != end) {
+            if (!get(p, end, order_class) || order_class >= kOrderClasses) {
+                return DecodeStatus::Malformed;
+            }
+            request.order_class = static_cast<OrderClass>(order_class);
+        }
+    } else if (request.type == MessageType::Production) {
+        ProductionMessage& m = request.production;
+        if (!getString(p, end, m.product) || !get(p, end, m.weight) || !getString(p, end, m.packaging) ||
+            !get(p, end, m.quantity)) {
+            return DecodeStatus::Malformed;
+        }
+        // Кадр цел, но партия недопустима: Factory считает количество в int, вес идёт в расчёт вместимости
+        if (p == end && (!std::isfinite(m.weight) || m.weight < 0 || m.quantity > static_cast<uint32_t>(INT_MAX))) {
+            return DecodeStatus::Invalid;
+        }
+    } else {
+        return DecodeStatus::Malformed;
+    }
+    return p == end ? DecodeStatus::Ok : DecodeStatus::Malformed;
+}
+
+DecodeStatus decodeResponse(const char* data, size_t size, size_t& consumed, Response& response) {
+    uint8_t type = 0;
+    const char* p = nullptr;
+    const char* end = nullptr;
+    DecodeStatus status = readHeader(data, size, consumed, type, response.id, p, end);
+    if (status != DecodeStatus::Ok) {
+        return status;
+    }
+    uint8_t code = 0;
+    if (type != static_cast<uint8_t>(MessageType::Response) || !get(p, end, code) || !get(p, end, response.requested) ||
+        !get(p, end, response.completed) || p != end) {
+        return DecodeStatus::Malformed;
+    }
+    response.status = static_cast<ResponseStatus>(code);
+    return DecodeStatus::Ok;
+}
@@ -0,0 +1,86 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Двоичный протокол приёма заказов (order_server.h, клиент fgbu_client).
+// Кадр: [u32 длина остального кадра][u8 тип][u64 номер запроса][тело], порядок байт хоста.
+// Строки - [u8 длина][байты], длиннее 255 байт не кодируются. Клиент может отправлять запросы подряд, не дожидаясь
+// ответов; ответы приходят по мере выполнения и сопоставляются по номеру запроса.
+//   Order:      строка магазина, u8 число строк, строки: (строка продукта, u32 количество),
+//               [u8 класс заказа] - без него Standard
+//   Production: строка продукта, f64 вес единицы, строка упаковки, u32 количество;
+//               вес - конечный и неотрицательный, количество - не больше INT_MAX
+//   Response:   u8 статус, u32 запрошено, u32 выполнено (доставлено или размещено)
+
+enum class MessageType : uint8_t {
+    Order = 1,
+    Production = 2,
+    Response = 3
+};
+
+enum class ResponseStatus : uint8_t {
+    Ok = 0,
+    BadRequest = 1,
+    Overloaded = 2 // заказ не принят: очередь его класса переполнена, можно повторить позже
+};
+
+// Класс обслуживания заказа: определяет долю обработчиков и порядок отказа при перегрузке
+enum class OrderClass : uint8_t {
+    Express = 0,
+    Standard = 1,
+    Bulk = 2
+};
+
+constexpr size_t kOrderClasses = 3;
+
+enum class DecodeStatus : uint8_t {
+    Ok,
+    Incomplete, // кадр ещё не пришёл целиком
+    Malformed,  // соединение нужно закрыть
+    Invalid     // кадр разобран, но значения недопустимы: ответ BadRequest, соединение остаётся
+};
+
+constexpr size_t kMaxFrameBytes = 64 * 1024;
+
+struct ProductionMessage {
+    std::string product;
+    double weight = 0;
+    std::string packaging;
+    uint32_t quantity = 0;
+};
+
+struct Request {
+    MessageType type = MessageType::Order;
+    uint64_t id = 0;
+    std::string shop;                       // Order
+    std::map<std::string, size_t> lines;    // Order, в формате Truck::deliver
+    OrderClass order_class = OrderClass::Standard; // Order
+    ProductionMessage production;           // Production
+};
+
+struct Response {
+    uint64_t id = 0;
+    ResponseStatus status = ResponseStatus::Ok;
+    uint32_t requested = 0;
+    uint32_t completed = 0;
+};
+
+// false - строка длиннее 255 байт или строк заказа больше 255; out не меняется
+bool encodeOrder(std::string& out, uint64_t id, std::string_view shop,
+                 const std::vector<std::pair<std::string_view, uint32_t>>& lines,
+                 OrderClass order_class = OrderClass::Standard);
+bool encodeProduction(std::string& out, uint64_t id, const ProductionMessage& production);
+void encodeResponse(std::string& out, const Response& response);
+
+// Разбирает один кадр из начала data; consumed - его полная длина
+DecodeStatus decodeRequest(const char* data, size_t size, size_t& consumed, Request& request);
+DecodeStatus decodeResponse(const char* data, size_t size, size_t& consumed, Response& response);
+
+#endif // PROTOCOL_H
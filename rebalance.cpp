@@ -0,0 +1,469 @@
+#include "rebalance.h"
+#include "classes.h"
+#include "routing.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <queue>
+#include <thread>
+
+namespace {
+
+// Делит total на части пропорционально weights методом наибольших остатков;
+// часть не превышает свой вес, total не больше суммы весов
+void apportion(size_t total, const std::vector<size_t>& weights, std::vector<size_t>& parts) {
+    parts.assign(weights.size(), 0);
+    size_t sum = 0;
+    for (size_t w : weights) {
+        sum += w;
+    }
+    total = std::min(total, sum);
+    if (total == 0) {
+        return;
+    }
+    if (total == sum) {
+        parts = weights;
+        return;
+    }
+    std::vector<std::pair<double, size_t>> remainders;
+    size_t given = 0;
+    for (size_t i = 0; i < weights.size(); ++i) {
+        double exact = static_cast<double>(total) * static_cast<double>(weights[i]) / static_cast<double>(sum);
+        parts[i] = static_cast<size_t>(exact);
+        given += parts[i];
+        if (parts[i] < weights[i]) {
+            remainders.emplace_back(exact - static_cast<double>(parts[i]), i);
+        }
+    }
+    std::sort(remainders.begin(), remainders.end(), [](const auto& a, const auto& b) {
+        return a.first != b.first ? a.first > b.first : a.second < b.second;
+    });
+    for (size_t r = 0; given < total && r < remainders.size(); ++r, ++given) {
+        ++parts[remainders[r].second];
+    }
+}
+
+// Поставщик и получатель продукта на такте
+struct Supplier {
+    uint32_t site;
+    size_t forced;   // обязательный вывоз с переполненного склада
+    size_t optional; // излишек сверх прогноза
+};
+
+struct Receiver {
+    uint32_t site;
+    size_t deficit;  // нехватка под прогноз, в пределах доли места
+    size_t spill;    // место для обязательного вывоза
+};
+
+// Поток минимальной стоимости последовательными кратчайшими путями (Дейкстра с потенциалами).
+// Стоимости неотрицательны; augment останавливается, когда путь перестаёт быть выгодным.
+class MinCostFlow {
+public:
+    struct Edge {
+        uint32_t to;
+        uint32_t rev;
+        size_t cap;
+        double cost;
+    };
+
+    explicit MinCostFlow(size_t nodes) : graph(nodes) {}
+
+    // Возвращает номер ребра в списке from
+    size_t addEdge(uint32_t from, uint32_t to, size_t cap, double cost) {
+        graph[from].push_back({to, static_cast<uint32_t>(graph[to].size()), cap, cost});
+        graph[to].push_back({from, static_cast<uint32_t>(graph[from].size() - 1), 0, -cost});
+        return graph[from].size() - 1;
+    }
+
+    const Edge& edge(uint32_t from, size_t index) const { return graph[from][index]; }
+    size_t flowOn(uint32_t from, size_t index) const {
+        const Edge& e = graph[from][index];
+        return graph[e.to][e.rev].cap;
+    }
+
+    // Гонит поток, пока стоимость пути меньше limit
+    void run(uint32_t source, uint32_t sink, double limit) {
+        const double inf = std::numeric_limits<double>::infinity();
+        std::vector<double> potential(graph.size(), 0);
+        std::vector<double> dist(graph.size());
+        std::vector<std::pair<uint32_t, uint32_t>> prev(graph.size()); // (узел, ребро)
+        std::vector<char> done(graph.size());
+        using Item = std::pair<double, uint32_t>;
+        std::priority_queue<Item, std::vector<Item>, std::greater<>> heap;
+
+        while (true) {
+            std::fill(dist.begin(), dist.end(), inf);
+            std::fill(done.begin(), done.end(), 0);
+            dist[source] = 0;
+            heap.push({0, source});
+            while (!heap.empty()) {
+                auto [d, v] = heap.top();
+                heap.pop();
+                if (done[v]) {
+                    continue;
+                }
+                done[v] = 1;
+                if (v == sink) {
+                    break;
+                }
+                for (uint32_t i = 0; i < graph[v].size(); ++i) {
+                    const Edge& e = graph[v][i];
+                    // Просмотренные узлы не пересчитываются: погрешность сдвигов порядка 1e9
+                    // может дать слегка отрицательную стоимость и зациклить цепочку prev
+                    if (e.cap == 0 || done[e.to]) {
+                        continue;
+                    }
+                    double reduced = e.cost + potential[v] - potential[e.to];
+                    if (d + reduced < dist[e.to]) {
+                        dist[e.to] = d + reduced;
+                        prev[e.to] = {v, i};
+                        heap.push({dist[e.to], e.to});
+                    }
+                }
+            }
+            heap = {};
+            if (!done[sink]) {
+                return;
+            }
+            // Потенциалы сдвигаются только у просмотренных узлов, как у сокращённого Дейкстры
+            for (size_t v = 0; v < graph.size(); ++v) {
+                if (done[v]) {
+                    potential[v] += dist[v] - dist[sink];
+                }
+            }
+            double path_cost = potential[sink] - potential[source];
+            if (path_cost >= limit) {
+                return;
+            }
+            size_t push = std::numeric_limits<size_t>::max();
+            for (uint32_t v = sink; v != source; v = prev[v].first) {
+                push = std::min(push, graph[prev[v].first][prev[v].second].cap);
+            }
+            for (uint32_t v = sink; v != source; v = prev[v].first) {
+                Edge& e = graph[prev[v].first][prev[v].second];
+                e.cap -= push;
+                graph[e.to][e.rev].cap += push;
+            }
+        }
+    }
+
+private:
+    std::vector<std::vector<Edge>> graph;
+};
+
+// Итог одного продукта
+struct ProductResult {
+    std::vector<Transfer> transfers;
+    size_t forced_left = 0;
+    size_t demand_covered = 0;
+};
+
+// Сеть продукта: источник 0, поставщики 1..S, получатели S+1..S+R, сток S+R+1.
+// Ко всем рёбрам источника прибавлен сдвиг forced_bonus, ко всем рёбрам стока -
+// demand_value, чтобы стоимости стали неотрицательными; любой путь проходит ровно
+// по одному ребру источника и одному ребру стока, поэтому порядок путей не меняется.
+ProductResult solveProduct(uint32_t product, const std::vector<Supplier>& suppliers, const std::vector<Receiver>& receivers,
+                           const std::vector<int>& router_site, const Router& router, const RebalanceOptions& options) {
+    ProductResult result;
+    for (const auto& s : suppliers) {
+        result.forced_left += s.forced;
+    }
+    if (suppliers.empty() || receivers.empty()) {
+        return result;
+    }
+    const double forced_bonus = 1e9;
+    const size_t S = suppliers.size();
+    const size_t R = receivers.size();
+    auto travel = [&](uint32_t from, uint32_t to) {
+        int a = router_site[from];
+        int b = router_site[to];
+        return (a < 0 || b < 0) ? Router::kUnreachable
+                                : router.travelTime(static_cast<uint32_t>(a), static_cast<uint32_t>(b));
+    };
+
+    // Разреженные пары: каждому складу - neighbours ближайших партнёров с другой стороны
+    std::vector<std::pair<uint32_t, uint32_t>> pairs;
+    std::vector<std::pair<double, uint32_t>> candidates;
+    auto keepNearest = [&]() {
+        size_t k = std::min(options.neighbours, candidates.size());
+        std::partial_sort(candidates.begin(), candidates.begin() + static_cast<std::ptrdiff_t>(k), candidates.end());
+        candidates.resize(k);
+    };
+    for (uint32_t s = 0; s < S; ++s) {
+        candidates.clear();
+        for (uint32_t r = 0; r < R; ++r) {
+            double t = travel(suppliers[s].site, receivers[r].site);
+            if (t != Router::kUnreachable) {
+                candidates.emplace_back(t, r);
+            }
+        }
+        keepNearest();
+        for (const auto& c : candidates) {
+            pairs.emplace_back(s, c.second);
+        }
+    }
+    for (uint32_t r = 0; r < R; ++r) {
+        candidates.clear();
+        for (uint32_t s = 0; s < S; ++s) {
+            double t = travel(suppliers[s].site, receivers[r].site);
+            if (t != Router::kUnreachable) {
+                candidates.emplace_back(t, s);
+            }
+        }
+        keepNearest();
+        for (const auto& c : candidates) {
+            pairs.emplace_back(c.second, r);
+        }
+    }
+    std::sort(pairs.begin(), pairs.end());
+    pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+
+    const auto source = 0u;
+    const auto sink = static_cast<uint32_t>(S + R + 1);
+    MinCostFlow flow(S + R + 2);
+    std::vector<size_t> forced_edge(S, SIZE_MAX);
+    for (uint32_t s = 0; s < S; ++s) {
+        if (suppliers[s].forced) {
+            forced_edge[s] = flow.addEdge(source, 1 + s, suppliers[s].forced, 0);
+        }
+        if (suppliers[s].optional) {
+            flow.addEdge(source, 1 + s, suppliers[s].optional, forced_bonus);
+        }
+    }
+    std::vector<size_t> pair_edge(pairs.size());
+    for (size_t p = 0; p < pairs.size(); ++p) {
+        auto [s, r] = pairs[p];
+        size_t supply = suppliers[s].forced + suppliers[s].optional;
+        pair_edge[p] = flow.addEdge(1 + s, static_cast<uint32_t>(1 + S + r), supply,
+                                    travel(suppliers[s].site, receivers[r].site));
+    }
+    std::vector<size_t> deficit_edge(R, SIZE_MAX);
+    for (uint32_t r = 0; r < R; ++r) {
+        auto node = static_cast<uint32_t>(1 + S + r);
+        if (receivers[r].deficit) {
+            deficit_edge[r] = flow.addEdge(node, sink, receivers[r].deficit, 0);
+        }
+        if (receivers[r].spill) {
+            flow.addEdge(node, sink, receivers[r].spill, options.demand_value);
+        }
+    }
+    // Путь выгоден, пока его настоящая стоимость (без сдвигов) отрицательна
+    flow.run(source, sink, forced_bonus + options.demand_value);
+
+    for (size_t p = 0; p < pairs.size(); ++p) {
+        auto [s, r] = pairs[p];
+        size_t moved = flow.flowOn(1 + s, pair_edge[p]);
+        if (moved) {
+            double minutes = flow.edge(1 + s, pair_edge[p]).cost;
+            result.transfers.push_back({suppliers[s].site, receivers[r].site, product, moved, minutes * static_cast<double>(moved)});
+        }
+    }
+    for (uint32_t s = 0; s < S; ++s) {
+        if (forced_edge[s] != SIZE_MAX) {
+            result.forced_left -= flow.flowOn(source, forced_edge[s]);
+        }
+    }
+    for (uint32_t r = 0; r < R; ++r) {
+        if (deficit_edge[r] != SIZE_MAX) {
+            result.demand_covered += flow.flowOn(static_cast<uint32_t>(1 + S + r), deficit_edge[r]);
+        }
+    }
+    return result;
+}
+
+} // namespace
+
+RebalancePlanner::RebalancePlanner(const Router& router) : router(router) {}
+
+RebalancePlan RebalancePlanner::plan(const RebalanceInput& input, const RebalanceOptions& options) const {
+    RebalancePlan plan;
+    const size_t n = input.sites.size();
+    const size_t m = input.products.size();
+    if (n == 0 || m == 0) {
+        return plan;
+    }
+
+    std::vector<int> router_site(n);
+    for (size_t i = 0; i < n; ++i) {
+        router_site[i] = router.siteId(input.sites[i]);
+    }
+
+    // Распределение по продуктам: что склад обязан вывезти, что может отдать
+    // и сколько своего места отдаёт под нехватку каждого продукта
+    std::vector<std::vector<Supplier>> suppliers(m);
+    std::vector<std::vector<Receiver>> receivers(m);
+    std::vector<std::vector<std::pair<uint32_t, size_t>>> deficit_rooms(n); // склад -> (продукт, место)
+    std::vector<size_t> need(m), surplus(m), deficit(m), kept(m), forced(m), forced_from_kept(m), parts(m);
+    std::vector<size_t> forced_total(m, 0);
+    std::vector<size_t> room(n, 0);
+    for (size_t i = 0; i < n; ++i) {
+        size_t load = 0;
+        for (size_t k = 0; k < m; ++k) {
+            load += input.stockAt(i, k);
+        }
+        auto ceiling = static_cast<size_t>(options.watermark * static_cast<double>(input.capacity[i]));
+        auto target = static_cast<size_t>(options.target_fill * static_cast<double>(input.capacity[i]));
+        size_t excess = load > ceiling ? load - std::min(load, target) : 0;
+        room[i] = load < target ? target - load : 0;
+        plan.overflow += excess;
+
+        for (size_t k = 0; k < m; ++k) {
+            need[k] = static_cast<size_t>(std::ceil(std::max(0.0, input.demandAt(i, k))));
+            size_t stock = input.stockAt(i, k);
+            surplus[k] = stock > need[k] ? stock - need[k] : 0;
+            deficit[k] = need[k] > stock ? need[k] - stock : 0;
+            kept[k] = stock - surplus[k];
+        }
+        // Вывоз сначала из излишка, затем из запаса под прогноз
+        apportion(excess, surplus, forced);
+        size_t from_surplus = 0;
+        for (size_t f : forced) {
+            from_surplus += f;
+        }
+        apportion(excess - from_surplus, kept, forced_from_kept);
+        for (size_t k = 0; k < m; ++k) {
+            size_t out = forced[k] + forced_from_kept[k];
+            size_t optional = surplus[k] - forced[k];
+            if (out || optional) {
+                suppliers[k].push_back({static_cast<uint32_t>(i), out, optional});
+                forced_total[k] += out;
+            }
+        }
+        apportion(room[i], deficit, parts);
+        for (size_t k = 0; k < m; ++k) {
+            if (parts[k]) {
+                deficit_rooms[i].emplace_back(static_cast<uint32_t>(k), parts[k]);
+                room[i] -= parts[k];
+            }
+        }
+    }
+
+    // Оставшееся место делится пропорционально обязательному вывозу продуктов,
+    // которые склад сам не отдаёт
+    std::vector<size_t> weights(m);
+    for (size_t i = 0; i < n; ++i) {
+        std::fill(parts.begin(), parts.end(), 0);
+        if (room[i]) {
+            for (size_t k = 0; k < m; ++k) {
+                bool supplies = input.stockAt(i, k) > static_cast<size_t>(std::ceil(std::max(0.0, input.demandAt(i, k))));
+                weights[k] = supplies ? 0 : forced_total[k];
+            }
+            apportion(room[i], weights, parts);
+        }
+        auto deficit_it = deficit_rooms[i].begin();
+        for (size_t k = 0; k < m; ++k) {
+            size_t deficit_room = 0;
+            if (deficit_it != deficit_rooms[i].end() && deficit_it->first == k) {
+                deficit_room = deficit_it->second;
+                ++deficit_it;
+            }
+            if (deficit_room || parts[k]) {
+                receivers[k].push_back({static_cast<uint32_t>(i), deficit_room, parts[k]});
+            }
+        }
+    }
+
+    // Продукты независимы: потоки берут следующий по счётчику
+    std::vector<ProductResult> results(m);
+    unsigned threads = options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+    threads = static_cast<unsigned>(std::min<size_t>(threads, m));
+    std::atomic<size_t> next{0};
+    auto worker = [&] {
+        for (size_t k = next++; k < m; k = next++) {
+            results[k] = solveProduct(static_cast<uint32_t>(k), suppliers[k], receivers[k], router_site, router, options);
+        }
+    };
+    std::vector<std::thread> pool;
+    for (unsigned i = 1; i < threads; ++i) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto& t : pool) {
+        t.join();
+    }
+
+    for (auto& result : results) {
+        for (const auto& transfer : result.transfers) {
+            plan.cost += transfer.cost;
+            plan.moved += transfer.quantity;
+        }
+        plan.transfers.insert(plan.transfers.end(), result.transfers.begin(), result.transfers.end());
+        plan.overflow_left += result.forced_left;
+        plan.demand_covered += result.demand_covered;
+    }
+    return plan;
+}
+
+RebalanceInput collectRebalanceInput(const std::vector<Warehouse*>& warehouses, const DemandForecast& forecast) {
+    RebalanceInput input;
+    std::vector<InventorySnapshot> snapshots;
+    std::map<std::string, uint32_t> product_ids;
+    for (auto* warehouse : warehouses) {
+        input.sites.push_back(warehouse->getName());
+        input.capacity.push_back(warehouse->getLimits().units);
+        snapshots.push_back(warehouse->snapshot());
+        for (const auto& product : snapshots.back().products) {
+            product_ids.emplace(product.name, 0);
+        }
+    }
+    for (const auto& site : forecast) {
+        for (const auto& product : site.second) {
+            product_ids.emplace(product.first, 0);
+        }
+    }
+    for (auto& entry : product_ids) {
+        entry.second = static_cast<uint32_t>(input.products.size());
+        input.products.push_back(entry.first);
+    }
+
+    const size_t m = input.products.size();
+    input.stock.assign(warehouses.size() * m, 0);
+    input.demand.assign(warehouses.size() * m, 0);
+    for (size_t i = 0; i < warehouses.size(); ++i) {
+        for (const auto& product : snapshots[i].products) {
+            input.stockAt(i, product_ids[product.name]) = product.quantity;
+        }
+        auto site = forecast.find(input.sites[i]);
+        if (site == forecast.end()) {
+            continue;
+        }
+        for (const auto& product : site->second) {
+            input.demand[i * m + product_ids[product.first]] = product.second;
+        }
+    }
+    return input;
+}
+
+size_t applyRebalance(const RebalancePlan& plan, const RebalanceInput& input, const std::vector<Warehouse*>& warehouses,
+                      size_t* lost) {
+    size_t moved = 0;
+    size_t dropped = 0;
+    for (const auto& transfer : plan.transfers) {
+        Warehouse* from = warehouses[transfer.from];
+        Warehouse* to = warehouses[transfer.to];
+        const std::string& product_name = input.products[transfer.product];
+        // Со времени среза остаток мог измениться: перевозится то, что реально забрали
+        UnloadedLine taken = from->take(product_name, transfer.quantity);
+        if (taken.quantity == 0) {
+            continue;
+        }
+        Product batch(product_name, taken.weight, std::string(taken.packaging), taken.quantity);
+        // Получатель принимает, сколько поместится; в batch.quantity остаётся не принятое
+        moved += to->storeManifest(std::span<Product>(&batch, 1));
+        if (batch.quantity > 0) {
+            from->storeManifest(std::span<Product>(&batch, 1)); // остаток возвращаем на место
+        }
+        if (batch.quantity > 0) {
+            console() << "Ошибка: " << batch.quantity << " ед. продукта " << product_name << " не вернулись на склад "
+                      << from->getName() << " после переброски.\n";
+            dropped += batch.quantity;
+        }
+    }
+    if (lost) {
+        *lost = dropped;
+    }
+    return moved;
+}
@@ -0,0 +1,82 @@
+#ifndef REBALANCE_H
+#define REBALANCE_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+class Router;
+class Warehouse;
+
+// Состояние сети на такт планирования. Остатки и прогноз - матрицы
+// склад x продукт построчно (sites.size() строк по products.size()).
+struct RebalanceInput {
+    std::vector<std::string> sites;    // имена складов, как в Router
+    std::vector<std::string> products;
+    std::vector<size_t> capacity;      // вместимость склада в единицах
+    std::vector<size_t> stock;
+    std::vector<double> demand;        // ожидаемый спрос до следующего такта
+
+    size_t& stockAt(size_t site, size_t product) { return stock[site * products.size() + product]; }
+    size_t stockAt(size_t site, size_t product) const { return stock[site * products.size() + product]; }
+    double demandAt(size_t site, size_t product) const { return demand[site * products.size() + product]; }
+};
+
+// Переброска партии продукта между складами
+struct Transfer {
+    uint32_t from;
+    uint32_t to;
+    uint32_t product;
+    size_t quantity;
+    double cost; // минуты пути на единицу, умноженные на количество
+};
+
+struct RebalancePlan {
+    std::vector<Transfer> transfers;   // по продукту, затем по складам
+    double cost = 0;
+    size_t moved = 0;
+    size_t overflow = 0;               // единиц выше порога до переброски
+    size_t overflow_left = 0;          // сколько не удалось вывезти
+    size_t demand_covered = 0;         // единиц прогноза, закрытых переброской
+};
+
+struct RebalanceOptions {
+    double watermark = 0.95;        // выше этой доли склад разгружается (как порог autoUnload)
+    double target_fill = 0.85;      // получателей не заполнять выше этой доли
+    double demand_value = 240.0;    // выгода единицы покрытого прогноза в минутах пути
+    size_t neighbours = 8;          // ближайших партнёров на склад в сети продукта
+    unsigned threads = 0;           // 0 - все ядра
+};
+
+// Планировщик перебросок между складами. Для каждого продукта решается
+// задача потока минимальной стоимости (последовательные кратчайшие пути
+// с потенциалами): источник -> склады с излишком -> склады с нехваткой или
+// свободным местом -> сток. Вывоз выше watermark обязателен и идёт первым;
+// под прогноз товар перевозится, только если путь дешевле demand_value.
+// Общая вместимость получателя заранее делится между продуктами, поэтому
+// продукты решаются независимо и параллельно по ядрам. Каждый склад
+// связан только с neighbours ближайшими партнёрами, что держит сеть продукта
+// разреженной на тысячах складов.
+class RebalancePlanner {
+public:
+    explicit RebalancePlanner(const Router& router);
+
+    RebalancePlan plan(const RebalanceInput& input, const RebalanceOptions& options = RebalanceOptions()) const;
+
+private:
+    const Router& router;
+};
+
+// Прогноз спроса: склад -> продукт -> единиц до следующего такта
+using DemandForecast = std::map<std::string, std::map<std::string, double>>;
+
+// Срез живых складов без блокировки записи (Warehouse::snapshot)
+RebalanceInput collectRebalanceInput(const std::vector<Warehouse*>& warehouses, const DemandForecast& forecast);
+// Выполняет переброски: take на складе-источнике, storeManifest на получателе;
+// не поместившееся возвращается обратно. Возвращает перемещённые единицы, в lost -
+// единицы, которые не принял ни получатель, ни источник (их место успели занять)
+size_t applyRebalance(const RebalancePlan& plan, const RebalanceInput& input, const std::vector<Warehouse*>& warehouses,
+                      size_t* lost = nullptr);
+
+#endif // REBALANCE_H
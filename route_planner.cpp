@@ -0,0 +1,456 @@
+#include "route_planner.h"
+#include "classes.h"
+#include "routing.h"
+
+#include <random>
+#include <tuple>
+
+namespace {
+
+constexpr double kNoRoad = 1e6; // время для точек без узла на графе
+
+struct PlannerInput {
+    std::vector<int> site;            // узел 0 - депо, дальше остановки
+    std::vector<Capacity> demand;     // штуки, вес и объём каждой остановки
+    std::vector<std::vector<uint32_t>> near; // ближайшие остановки каждой остановки
+    const Router* router = nullptr;
+
+    double dist(uint32_t a, uint32_t b) const {
+        if (site[a] < 0 || site[b] < 0) {
+            return a == b ? 0 : kNoRoad;
+        }
+        double t = router->travelTime(static_cast<uint32_t>(site[a]), static_cast<uint32_t>(site[b]));
+        return t < kNoRoad ? t : kNoRoad;
+    }
+};
+
+struct Solution {
+    std::vector<std::vector<uint32_t>> routes;
+    std::vector<Capacity> capacity;
+    std::vector<size_t> truck;        // индекс грузовика в парке
+    std::vector<Capacity> load;
+    double cost = 0;
+};
+
+// Помещается ли остановка demand в кузов limits поверх загрузки load
+bool fits(const Capacity& limits, const Capacity& load, const Capacity& demand) {
+    return Capacity::fitCount(limits, load, demand) > 0;
+}
+
+double routeTime(const PlannerInput& in, const std::vector<uint32_t>& route) {
+    if (route.empty()) {
+        return 0;
+    }
+    double t = in.dist(0, route.front()) + in.dist(route.back(), 0);
+    for (size_t i = 1; i < route.size(); ++i) {
+        t += in.dist(route[i - 1], route[i]);
+    }
+    return t;
+}
+
+double totalCost(const PlannerInput& in, const Solution& s, double trip_penalty) {
+    double cost = 0;
+    for (const auto& route : s.routes) {
+        if (!route.empty()) {
+            cost += routeTime(in, route) + trip_penalty;
+        }
+    }
+    return cost;
+}
+
+// Жадное построение: рейс набирается ближайшими остановками, пока есть место
+Solution construct(const PlannerInput& in, const std::vector<Capacity>& fleet_caps, const std::vector<size_t>& fleet_order) {
+    Solution s;
+    size_t stops = in.demand.size() - 1;
+    std::vector<bool> visited(in.demand.size(), false);
+    size_t remaining = stops;
+    size_t idle = 0; // подряд идущие рейсы, в которые не встало ни одной остановки
+
+    // Круг парка без единой остановки - оставшиеся не помещаются ни в один кузов, защита от зацикливания
+    for (size_t trip = 0; remaining > 0 && idle < fleet_order.size(); ++trip) {
+        size_t truck = fleet_order[trip % fleet_order.size()];
+        const Capacity& cap = fleet_caps[truck];
+        std::vector<uint32_t> route;
+        Capacity load;
+        uint32_t cur = 0;
+        while (true) {
+            uint32_t best = 0;
+            double best_time = 0;
+            for (uint32_t v = 1; v <= stops; ++v) {
+                if (!visited[v] && fits(cap, load, in.demand[v])) {
+                    double t = in.dist(cur, v);
+                    if (best == 0 || t < best_time) {
+                        best = v;
+                        best_time = t;
+                    }
+                }
+            }
+            if (best == 0) {
+                break;
+            }
+            visited[best] = true;
+            --remaining;
+            load += in.demand[best];
+            route.push_back(best);
+            cur = best;
+        }
+        if (route.empty()) {
+            ++idle;
+            continue;
+        }
+        idle = 0;
+        s.routes.push_back(std::move(route));
+        s.capacity.push_back(cap);
+        s.truck.push_back(truck);
+        s.load.push_back(load);
+    }
+    return s;
+}
+
+class LocalSearch {
+public:
+    LocalSearch(const PlannerInput& in, double trip_penalty, uint64_t seed)
+            : in(in), trip_penalty(trip_penalty), rng(seed) {}
+
+    Solution run(Solution start, std::chrono::steady_clock::time_point deadline) {
+        current = std::move(start);
+        reindex();
+        descend(deadline);
+        current.cost = totalCost(in, current, trip_penalty);
+        Solution best = current;
+
+        // Итерированный локальный поиск: встряска лучшего решения и повторный спуск
+        while (std::chrono::steady_clock::now() < deadline) {
+            current = best;
+            reindex();
+            perturb();
+            descend(deadline);
+            current.cost = totalCost(in, current, trip_penalty);
+            if (current.cost < best.cost - 1e-9) {
+                best = current;
+            }
+        }
+        return best;
+    }
+
+private:
+    uint32_t prevOf(uint32_t v) const {
+        const auto& r = current.routes[route_of[v]];
+        return pos_of[v] == 0 ? 0 : r[pos_of[v] - 1];
+    }
+
+    uint32_t nextOf(uint32_t v) const {
+        const auto& r = current.routes[route_of[v]];
+        return pos_of[v] + 1 == r.size() ? 0 : r[pos_of[v] + 1];
+    }
+
+    void reindexRoute(size_t r) {
+        for (size_t i = 0; i < current.routes[r].size(); ++i) {
+            route_of[current.routes[r][i]] = static_cast<uint32_t>(r);
+            pos_of[current.routes[r][i]] = static_cast<uint32_t>(i);
+        }
+    }
+
+    void reindex() {
+        route_of.assign(in.demand.size(), 0);
+        pos_of.assign(in.demand.size(), 0);
+        for (size_t r = 0; r < current.routes.size(); ++r) {
+            reindexRoute(r);
+        }
+    }
+
+    void move(uint32_t v, size_t to_route, size_t to_pos) {
+        size_t from_route = route_of[v];
+        auto& from = current.routes[from_route];
+        from.erase(from.begin() + pos_of[v]);
+        current.load[from_route] -= in.demand[v];
+        auto& to = current.routes[to_route];
+        to.insert(to.begin() + static_cast<std::ptrdiff_t>(to_pos), v);
+        current.load[to_route] += in.demand[v];
+        reindexRoute(from_route);
+        reindexRoute(to_route);
+    }
+
+    // Перенос остановки в другой рейс рядом с одним из её ближайших соседей
+    bool relocate(uint32_t v) {
+        size_t r = route_of[v];
+        uint32_t p = prevOf(v);
+        uint32_t n = nextOf(v);
+        double gain = in.dist(p, v) + in.dist(v, n) - in.dist(p, n);
+        if (current.routes[r].size() == 1) {
+            gain += trip_penalty; // рейс исчезает целиком
+        }
+
+        double best_delta = gain - 1e-9;
+        size_t best_route = r;
+        size_t best_pos = 0;
+        for (uint32_t u : in.near[v]) {
+            size_t r2 = route_of[u];
+            if (r2 == r || !fits(current.capacity[r2], current.load[r2], in.demand[v])) {
+                continue;
+            }
+            uint32_t a = prevOf(u);
+            double before = in.dist(a, v) + in.dist(v, u) - in.dist(a, u);
+            if (before < best_delta) {
+                best_delta = before;
+                best_route = r2;
+                best_pos = pos_of[u];
+            }
+            uint32_t b = nextOf(u);
+            double after = in.dist(u, v) + in.dist(v, b) - in.dist(u, b);
+            if (after < best_delta) {
+                best_delta = after;
+                best_route = r2;
+                best_pos = pos_of[u] + 1;
+            }
+        }
+        if (best_route == r) {
+            return false;
+        }
+        move(v, best_route, best_pos);
+        return true;
+    }
+
+    // 2-opt внутри рейса: разворот участка [i, j]. Время пути может быть несимметричным,
+    // поэтому кроме двух заменяемых рёбер меняется и время самого участка: его прямой и
+    // обратный проходы наращиваются вместе с j, и каждый ход оценивается за O(1)
+    bool twoOpt(size_t r) {
+        auto& route = current.routes[r];
+        if (route.size() < 3) {
+            return false;
+        }
+        bool improved = false;
+        for (size_t i = 0; i + 1 < route.size(); ++i) {
+            uint32_t before = i == 0 ? 0 : route[i - 1];
+            double forward = 0;  // участок [i, j] в текущем порядке
+            double backward = 0; // он же, пройденный в обратную сторону
+            for (size_t j = i + 1; j < route.size(); ++j) {
+                forward += in.dist(route[j - 1], route[j]);
+                backward += in.dist(route[j], route[j - 1]);
+                uint32_t after = j + 1 == route.size() ? 0 : route[j + 1];
+                double delta = in.dist(before, route[j]) + backward + in.dist(route[i], after) -
+                               (in.dist(before, route[i]) + forward + in.dist(route[j], after));
+                if (delta < -1e-9) {
+                    std::reverse(route.begin() + static_cast<std::ptrdiff_t>(i), route.begin() + static_cast<std::ptrdiff_t>(j) + 1);
+                    std::swap(forward, backward); // развёрнутый участок - теперь текущий порядок
+                    improved = true;
+                }
+            }
+        }
+        if (improved) {
+            reindexRoute(r);
+        }
+        return improved;
+    }
+
+    void descend(std::chrono::steady_clock::time_point deadline) {
+        std::vector<uint32_t> order;
+        for (uint32_t v = 1; v < in.demand.size(); ++v) {
+            order.push_back(v);
+        }
+        bool improved = true;
+        size_t steps = 0;
+        while (improved) {
+            improved = false;
+            std::shuffle(order.begin(), order.end(), rng);
+            std::vector<bool> touched(current.routes.size(), false);
+            for (uint32_t v : order) {
+                if ((++steps & 63) == 0 && std::chrono::steady_clock::now() >= deadline) {
+                    return;
+                }
+                size_t from = route_of[v];
+                if (relocate(v)) {
+                    improved = true;
+                    touched[from] = true;
+                    touched[route_of[v]] = true;
+                }
+            }
+            for (size_t r = 0; r < current.routes.size(); ++r) {
+                if (touched[r] && twoOpt(r)) {
+                    improved = true;
+                }
+            }
+        }
+    }
+
+    void perturb() {
+        size_t stops = in.demand.size() - 1;
+        size_t kicks = std::max<size_t>(2, stops / 50);
+        std::uniform_int_distribution<uint32_t> pick_stop(1, static_cast<uint32_t>(stops));
+        std::uniform_int_distribution<size_t> pick_route(0, current.routes.size() - 1);
+        for (size_t k = 0; k < kicks; ++k) {
+            uint32_t v = pick_stop(rng);
+            size_t r2 = pick_route(rng);
+            if (r2 != route_of[v] && fits(current.capacity[r2], current.load[r2], in.demand[v])) {
+                std::uniform_int_distribution<size_t> pick_pos(0, current.routes[r2].size());
+                move(v, r2, pick_pos(rng));
+            }
+        }
+    }
+
+    const PlannerInput& in;
+    double trip_penalty;
+    std::mt19937_64 rng;
+    Solution current;
+    std::vector<uint32_t> route_of;
+    std::vector<uint32_t> pos_of;
+};
+
+} // namespace
+
+TourPlanner::TourPlanner(const Router& router, Warehouse& depot) : router(router), depot(depot) {}
+
+TourPlan TourPlanner::plan(const std::vector<ShopOrder>& orders, const std::vector<Truck*>& fleet,
+                           const PlannerOptions& options) const {
+    TourPlan result;
+    result.depot = &depot;
+    auto deadline = std::chrono::steady_clock::now() + options.time_budget;
+
+    std::vector<Capacity> fleet_caps;
+    std::vector<size_t> fleet_order;
+    for (size_t i = 0; i < fleet.size(); ++i) {
+        fleet_caps.push_back(fleet[i]->getLimits());
+        if (fleet_caps.back().units > 0) {
+            fleet_order.push_back(i);
+        }
+    }
+    if (fleet_order.empty() || orders.empty()) {
+        return result;
+    }
+    std::stable_sort(fleet_order.begin(), fleet_order.end(), [&](size_t a, size_t b) {
+        const Capacity& x = fleet_caps[a];
+        const Capacity& y = fleet_caps[b];
+        return std::tie(x.units, x.kg, x.volume) > std::tie(y.units, y.kg, y.volume);
+    });
+    const Capacity& max_cap = fleet_caps[fleet_order.front()];
+
+    // Заказы больше кузова делятся на остановки, каждая помещается в один рейс самого
+    // вместительного грузовика по штукам, весу и объёму
+    PlannerInput in;
+    in.router = &router;
+    in.site.push_back(router.siteOf(&depot));
+    in.demand.emplace_back();
+    std::vector<TourStop> stops(1);
+    for (size_t o = 0; o < orders.size(); ++o) {
+        int site = router.siteId(orders[o].shop_name);
+        TourStop piece{o, {}, {}};
+        for (const auto& request : orders[o].requests) {
+            Capacity unit = depot.unitOf(request.first);
+            if (unit.units == 0) {
+                unit = Capacity{1, 0, 0}; // продукта на складе нет: остановка нужна, чтобы поставить недостачу в дозаказ
+            }
+            if (!fits(max_cap, Capacity{}, unit)) {
+                continue; // единица не помещается и в пустой кузов - её пропускает и deliverTour
+            }
+            size_t left = request.second;
+            while (left > 0) {
+                size_t take = std::min(left, Capacity::fitCount(max_cap, piece.load, unit));
+                if (take == 0) {
+                    stops.push_back(piece);
+                    in.site.push_back(site);
+                    in.demand.push_back(piece.load);
+                    piece = TourStop{o, {}, {}};
+                    continue;
+                }
+                piece.requests[request.first] += take;
+                piece.load += unit * take;
+                left -= take;
+            }
+        }
+        if (piece.load.units > 0) {
+            stops.push_back(piece);
+            in.site.push_back(site);
+            in.demand.push_back(piece.load);
+        }
+    }
+    if (stops.size() == 1) {
+        return result;
+    }
+
+    unsigned threads = options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+
+    // Списки ближайших соседей считаются параллельно
+    in.near.resize(stops.size());
+    {
+        std::atomic<uint32_t> next{1};
+        auto worker = [&] {
+            std::vector<std::pair<double, uint32_t>> candidates;
+            for (uint32_t v = next++; v < stops.size(); v = next++) {
+                candidates.clear();
+                for (uint32_t u = 1; u < stops.size(); ++u) {
+                    if (u != v) {
+                        candidates.emplace_back(std::min(in.dist(v, u), in.dist(u, v)), u);
+                    }
+                }
+                size_t k = std::min(options.neighbours, candidates.size());
+                std::partial_sort(candidates.begin(), candidates.begin() + static_cast<std::ptrdiff_t>(k), candidates.end());
+                for (size_t i = 0; i < k; ++i) {
+                    in.near[v].push_back(candidates[i].second);
+                }
+            }
+        };
+        std::vector<std::thread> pool;
+        for (unsigned i = 1; i < threads; ++i) {
+            pool.emplace_back(worker);
+        }
+        worker();
+        for (auto& t : pool) {
+            t.join();
+        }
+    }
+
+    Solution start = construct(in, fleet_caps, fleet_order);
+
+    // Каждый поток улучшает одно и то же начальное решение со своим зерном
+    std::vector<Solution> found(threads);
+    {
+        std::vector<std::thread> pool;
+        for (unsigned i = 0; i < threads; ++i) {
+            pool.emplace_back([&, i] {
+                LocalSearch search(in, options.trip_penalty, options.seed + i * 0x9E3779B97F4A7C15ull);
+                found[i] = search.run(start, deadline);
+            });
+        }
+        for (auto& t : pool) {
+            t.join();
+        }
+    }
+    const Solution& best = *std::min_element(found.begin(), found.end(),
+                                             [](const Solution& a, const Solution& b) { return a.cost < b.cost; });
+
+    for (size_t r = 0; r < best.routes.size(); ++r) {
+        if (best.routes[r].empty()) {
+            continue;
+        }
+        Tour tour;
+        tour.truck = fleet[best.truck[r]];
+        tour.load = best.load[r];
+        tour.travel_time = routeTime(in, best.routes[r]);
+        for (uint32_t v : best.routes[r]) {
+            tour.stops.push_back(stops[v]);
+        }
+        result.travel_time += tour.travel_time;
+        result.tours.push_back(std::move(tour));
+    }
+    result.cost = result.travel_time + options.trip_penalty * static_cast<double>(result.tours.size());
+    return result;
+}
+
+void executePlan(const TourPlan& plan, const std::vector<ShopOrder>& orders) {
+    if (plan.tours.empty()) {
+        return;
+    }
+    // Рейсы начинаются в депо, поэтому грузятся только с его склада
+    const std::vector<Warehouse*> depot{plan.depot};
+    std::vector<DropOff> drops;
+    for (const auto& tour : plan.tours) {
+        console() << "Рейс грузовика " << tour.truck->getName() << ": " << tour.stops.size() << " остановок, "
+                  << tour.load.units << " ед., " << tour.load.kg << " кг, " << tour.travel_time << " мин.\n";
+        drops.clear();
+        for (const auto& stop : tour.stops) {
+            drops.push_back({orders[stop.order_index].shop_name, stop.requests});
+        }
+        std::lock_guard<std::mutex> truck_lock(tour.truck->mtx);
+        tour.truck->deliverTour(depot, drops);
+    }
+}
@@ -0,0 +1,72 @@
+#ifndef ROUTE_PLANNER_H
+#define ROUTE_PLANNER_H
+
+#include "capacity.h"
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+class Router;
+class Truck;
+class Warehouse;
+
+// Заказ магазина для планирования рейсов
+struct ShopOrder {
+    std::string shop_name;
+    std::map<std::string, size_t> requests;
+};
+
+// Остановка рейса: часть заказа, которая помещается в одну поездку
+struct TourStop {
+    size_t order_index;                     // номер заказа во входном векторе
+    std::map<std::string, size_t> requests; // что выгрузить на этой остановке
+    Capacity load;                          // штуки, вес и объём этих строк
+};
+
+// Многоостановочный рейс одного грузовика из депо и обратно
+struct Tour {
+    Truck* truck = nullptr;
+    std::vector<TourStop> stops;
+    Capacity load;
+    double travel_time = 0;
+};
+
+struct TourPlan {
+    Warehouse* depot = nullptr; // склад депо, с которого грузятся все рейсы
+    std::vector<Tour> tours;
+    double travel_time = 0;
+    double cost = 0; // время в пути плюс штраф за каждый рейс
+};
+
+struct PlannerOptions {
+    std::chrono::milliseconds time_budget{200};
+    unsigned threads = 0;           // 0 - все ядра
+    uint64_t seed = 1;
+    double trip_penalty = 60.0;     // стоимость лишнего рейса в минутах пути
+    size_t neighbours = 24;         // сколько ближайших остановок рассматривать при переносе
+};
+
+// Планировщик рейсов (VRP с ограничением вместимости): рейсы начинаются на складе депо
+// (его точка на маршрутизаторе - имя склада), вес и объём строк берутся по его ячейкам. Жадное построение
+// по ближайшему соседу, затем локальный поиск (перенос остановок между рейсами
+// и 2-opt внутри рейса) параллельно в нескольких потоках с разными зёрнами
+// в пределах бюджета времени. Берётся лучший план.
+class TourPlanner {
+public:
+    TourPlanner(const Router& router, Warehouse& depot);
+
+    TourPlan plan(const std::vector<ShopOrder>& orders, const std::vector<Truck*>& fleet,
+                  const PlannerOptions& options = PlannerOptions()) const;
+
+private:
+    const Router& router;
+    Warehouse& depot;
+};
+
+// Выполняет план: грузовик загружается на складе депо и проходит остановки рейса по порядку
+void executePlan(const TourPlan& plan, const std::vector<ShopOrder>& orders);
+
+#endif // ROUTE_PLANNER_H
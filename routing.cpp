@@ -0,0 +1,216 @@
+#include "routing.h"
+#include "classes.h"
+
+#include <atomic>
+#include <cmath>
+#include <fstream>
+#include <queue>
+#include <sstream>
+
+bool RoadGraph::load(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) {
+        console() << "Ошибка: не удалось открыть дорожный граф " << path << ".\n";
+        return false;
+    }
+    std::string line;
+    size_t line_no = 0;
+    while (std::getline(in, line)) {
+        ++line_no;
+        std::istringstream fields(line);
+        std::string kind;
+        if (!(fields >> kind) || kind[0] == '#') {
+            continue;
+        }
+        if (kind == "e" || kind == "a") {
+            uint32_t from = 0;
+            uint32_t to = 0;
+            double minutes = 0;
+            if (fields >> from >> to >> minutes && addRoad(from, to, minutes, kind == "e")) {
+                continue;
+            }
+        } else if (kind == "s") {
+            uint32_t node = 0;
+            std::string name;
+            if (fields >> node && std::getline(fields >> std::ws, name) && !name.empty()) {
+                site_nodes.emplace_back(name, node);
+                continue;
+            }
+        }
+        console() << "Предупреждение: строка " << line_no << " графа " << path << " пропущена.\n";
+    }
+    finalize();
+    return true;
+}
+
+bool RoadGraph::addRoad(uint32_t from, uint32_t to, double minutes, bool two_way) {
+    if (!std::isfinite(minutes) || minutes < 0) {
+        return false;
+    }
+    arcs.push_back({from, to, minutes});
+    if (two_way) {
+        arcs.push_back({to, from, minutes});
+    }
+    return true;
+}
+
+void RoadGraph::finalize() {
+    uint32_t nodes = 0;
+    for (const auto& arc : arcs) {
+        nodes = std::max({nodes, arc.from + 1, arc.to + 1});
+    }
+    for (const auto& site : site_nodes) {
+        nodes = std::max(nodes, site.second + 1);
+    }
+
+    offsets.assign(nodes + 1, 0);
+    for (const auto& arc : arcs) {
+        ++offsets[arc.from + 1];
+    }
+    for (uint32_t v = 0; v < nodes; ++v) {
+        offsets[v + 1] += offsets[v];
+    }
+    targets.resize(arcs.size());
+    weights.resize(arcs.size());
+    std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    for (const auto& arc : arcs) {
+        uint32_t slot = fill[arc.from]++;
+        targets[slot] = arc.to;
+        weights[slot] = arc.minutes;
+    }
+}
+
+Router::Router(const RoadGraph& graph) : graph(graph) {
+    for (const auto& site : graph.sites()) {
+        placeSite(site.first, site.second);
+    }
+}
+
+uint32_t Router::placeSite(const std::string& name, uint32_t node) {
+    // Посчитанная матрица не знает нового узла точки: она устаревает до следующего prepare()
+    site_count = 0;
+    matrix.clear();
+    auto it = site_ids.find(name);
+    if (it != site_ids.end()) {
+        site_node[it->second] = node;
+        return it->second;
+    }
+    uint32_t id = static_cast<uint32_t>(site_node.size());
+    site_ids.emplace(name, id);
+    site_node.push_back(node);
+    return id;
+}
+
+void Router::shortestPaths(uint32_t source, double* row) const {
+    std::vector<double> dist(graph.nodeCount(), kUnreachable);
+    using Item = std::pair<double, uint32_t>;
+    std::priority_queue<Item, std::vector<Item>, std::greater<>> heap;
+    if (source < dist.size()) {
+        dist[source] = 0;
+        heap.emplace(0.0, source);
+    }
+    while (!heap.empty()) {
+        auto [d, v] = heap.top();
+        heap.pop();
+        if (d > dist[v]) {
+            continue;
+        }
+        for (uint32_t e = graph.offsets[v]; e < graph.offsets[v + 1]; ++e) {
+            double nd = d + graph.weights[e];
+            uint32_t u = graph.targets[e];
+            if (nd < dist[u]) {
+                dist[u] = nd;
+                heap.emplace(nd, u);
+            }
+        }
+    }
+    for (size_t t = 0; t < site_count; ++t) {
+        uint32_t node = site_node[t];
+        row[t] = node < dist.size() ? dist[node] : kUnreachable;
+    }
+}
+
+void Router::prepare(unsigned threads) {
+    site_count = site_node.size();
+    matrix.assign(site_count * site_count, kUnreachable);
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads = static_cast<unsigned>(std::min<size_t>(threads, std::max<size_t>(site_count, 1)));
+
+    // Каждый поток берёт следующую точку-источник и заполняет её строку матрицы
+    std::atomic<size_t> next{0};
+    auto worker = [&] {
+        for (size_t s = next++; s < site_count; s = next++) {
+            shortestPaths(site_node[s], &matrix[s * site_count]);
+        }
+    };
+    std::vector<std::thread> pool;
+    for (unsigned i = 1; i < threads; ++i) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto& t : pool) {
+        t.join();
+    }
+}
+
+uint32_t Router::placeWarehouse(const Warehouse* warehouse, uint32_t node) {
+    uint32_t id = placeSite(warehouse->getName(), node);
+    warehouse_sites[warehouse] = id;
+    return id;
+}
+
+int Router::siteOf(const Warehouse* warehouse) const {
+    auto it = warehouse_sites.find(warehouse);
+    if (it == warehouse_sites.end()) {
+        return siteId(warehouse->getName());
+    }
+    return it->second < site_count ? static_cast<int>(it->second) : -1;
+}
+
+int Router::siteId(const std::string& name) const {
+    auto it = site_ids.find(name);
+    return (it != site_ids.end() && it->second < site_count) ? static_cast<int>(it->second) : -1;
+}
+
+double Router::travelTime(const std::string& from, const std::string& to) const {
+    int a = siteId(from);
+    int b = siteId(to);
+    return (a < 0 || b < 0) ? kUnreachable : travelTime(static_cast<uint32_t>(a), static_cast<uint32_t>(b));
+}
+
+double Router::travelTime(const Warehouse* from, int to_site) const {
+    int a = siteOf(from);
+    return (a < 0 || to_site < 0) ? kUnreachable : travelTime(static_cast<uint32_t>(a), static_cast<uint32_t>(to_site));
+}
+
+std::vector<double> Router::manyToMany(const std::vector<uint32_t>& sources, const std::vector<uint32_t>& targets) const {
+    std::vector<double> result;
+    result.reserve(sources.size() * targets.size());
+    for (uint32_t s : sources) {
+        for (uint32_t t : targets) {
+            result.push_back(travelTime(s, t));
+        }
+    }
+    return result;
+}
+
+void Router::nearestFirst(const std::vector<Warehouse*>& warehouses, const std::string& shop_name,
+                          std::pmr::vector<Warehouse*>& out) const {
+    std::pmr::vector<std::pair<double, size_t>> ranked(out.get_allocator().resource()); // (время, позиция в списке)
+    ranked.reserve(warehouses.size());
+    int shop = siteId(shop_name);
+    for (size_t i = 0; i < warehouses.size(); ++i) {
+        ranked.emplace_back(travelTime(warehouses[i], shop), i);
+    }
+    // Равные по времени остаются в исходном порядке: позиция - часть ключа, поэтому
+    // хватает std::sort без временного буфера stable_sort
+    std::sort(ranked.begin(), ranked.end());
+
+    out.clear();
+    out.reserve(ranked.size());
+    for (const auto& entry : ranked) {
+        out.push_back(warehouses[entry.second]);
+    }
+}
@@ -0,0 +1,87 @@
+#ifndef ROUTING_H
+#define ROUTING_H
+
+#include <cstdint>
+#include <limits>
+#include <memory_resource>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class Warehouse;
+
+// Дорожный граф в формате CSR. Формат файла (по строке на запись):
+//   e <от> <до> <минуты>   - двусторонняя дорога
+//   a <от> <до> <минуты>   - односторонняя дорога
+//   s <узел> <название>    - склад или магазин в узле графа
+//   # комментарий
+class RoadGraph {
+public:
+    bool load(const std::string& path);
+    // Время в пути - конечное и неотрицательное (Дейкстра), иначе дорога не добавляется
+    bool addRoad(uint32_t from, uint32_t to, double minutes, bool two_way = true);
+    void finalize(); // строит CSR после addRoad
+
+    size_t nodeCount() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+    const std::vector<std::pair<std::string, uint32_t>>& sites() const { return site_nodes; }
+
+private:
+    friend class Router;
+    struct Arc {
+        uint32_t from;
+        uint32_t to;
+        double minutes;
+    };
+    std::vector<Arc> arcs;
+    std::vector<uint32_t> offsets;  // начало списка смежности узла
+    std::vector<uint32_t> targets;
+    std::vector<double> weights;
+    std::vector<std::pair<std::string, uint32_t>> site_nodes;
+};
+
+// Маршрутизатор: размещает склады и магазины в узлах графа и заранее считает
+// матрицу времени в пути между всеми точками (Дейкстра из каждой точки
+// параллельно по ядрам). После prepare() запрос - одно обращение к матрице.
+// placeSite после prepare() сбрасывает матрицу: до следующего prepare() точки
+// неизвестны (siteId возвращает -1, время - kUnreachable).
+class Router {
+public:
+    static constexpr double kUnreachable = std::numeric_limits<double>::infinity();
+
+    explicit Router(const RoadGraph& graph);
+
+    // Возвращает номер точки; повторное размещение переносит точку в другой узел
+    uint32_t placeSite(const std::string& name, uint32_t node);
+    // Точка склада с именем склада; номер запоминается по указателю, и запросы
+    // по складу обходятся без копии имени и поиска по строке
+    uint32_t placeWarehouse(const Warehouse* warehouse, uint32_t node);
+    void prepare(unsigned threads = 0);
+
+    int siteId(const std::string& name) const;
+    // Номер точки склада; склад, размещённый только по имени (placeSite, файл графа), ищется по имени
+    int siteOf(const Warehouse* warehouse) const;
+    double travelTime(uint32_t from_site, uint32_t to_site) const {
+        return (from_site < site_count && to_site < site_count) ? matrix[static_cast<size_t>(from_site) * site_count + to_site]
+                                                                : kUnreachable;
+    }
+    double travelTime(const std::string& from, const std::string& to) const;
+    double travelTime(const Warehouse* from, int to_site) const;
+    // Матрица времени между наборами точек, построчно по sources
+    std::vector<double> manyToMany(const std::vector<uint32_t>& sources, const std::vector<uint32_t>& targets) const;
+    // Склады, отсортированные по времени до магазина; неизвестные - в конце в исходном порядке.
+    // Результат и рабочий массив размещаются в памяти out (например, в арене заказа)
+    void nearestFirst(const std::vector<Warehouse*>& warehouses, const std::string& shop_name,
+                      std::pmr::vector<Warehouse*>& out) const;
+
+private:
+    void shortestPaths(uint32_t source, double* row) const;
+
+    const RoadGraph& graph;
+    std::unordered_map<std::string, uint32_t> site_ids;
+    std::unordered_map<const Warehouse*, uint32_t> warehouse_sites;
+    std::vector<uint32_t> site_node;
+    size_t site_count = 0;
+    std::vector<double> matrix;
+};
+
+#endif // ROUTING_H
@@ -0,0 +1,440 @@
+#include "shared_inventory.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <pthread.h>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free && std::atomic<uint64_t>::is_always_lock_free &&
+              std::atomic<double>::is_always_lock_free,
+              "атомики в разделяемой памяти должны быть без блокировок");
+
+namespace {
+
+constexpr char kMagic[8] = {'F', 'G', 'B', 'U', 'S', 'H', 'M', '1'};
+constexpr uint32_t kVersion = 2; // 2: объём единицы хранится в ячейке продукта
+constexpr size_t kNameBytes = 64;
+constexpr size_t kProductBytes = 56;
+constexpr size_t kPackagingBytes = 24;
+
+uint32_t hashName(const std::string& s) {
+    uint32_t h = 2166136261u; // FNV-1a
+    for (char c : s) {
+        h = (h ^ static_cast<uint8_t>(c)) * 16777619u;
+    }
+    return h;
+}
+
+// Имя помещается в поле size байт целиком, с завершающим нулём и без нулей внутри:
+// обрезанные имена разных складов и продуктов совпали бы
+bool fitsField(const std::string& src, size_t size) {
+    return src.size() < size && src.find('\0') == std::string::npos;
+}
+
+// Вызывается только для имён, прошедших fitsField
+void copyName(char* dst, const std::string& src) {
+    std::memcpy(dst, src.data(), src.size());
+    dst[src.size()] = '\0';
+}
+
+bool initSharedMutex(pthread_mutex_t* mtx) {
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+    bool ok = pthread_mutex_init(mtx, &attr) == 0;
+    pthread_mutexattr_destroy(&attr);
+    return ok;
+}
+
+// Блокировка robust-мьютекса: если владелец умер, мьютекс помечается согласованным.
+// Каждое значение - атомик, но остаток ячейки и загрузка склада (штуки, вес, объём)
+// меняются по очереди, и умерший владелец мог успеть записать только часть:
+// при ownerDied() загрузку склада нужно пересчитать по ячейкам.
+class SharedLock {
+public:
+    explicit SharedLock(pthread_mutex_t* mtx) : mtx(mtx) {
+        if (pthread_mutex_lock(mtx) == EOWNERDEAD) {
+            pthread_mutex_consistent(mtx);
+            owner_died = true;
+        }
+    }
+    ~SharedLock() { pthread_mutex_unlock(mtx); }
+    SharedLock(const SharedLock&) = delete;
+    SharedLock& operator=(const SharedLock&) = delete;
+
+    bool ownerDied() const { return owner_died; }
+
+private:
+    pthread_mutex_t* mtx;
+    bool owner_died = false;
+};
+
+std::string segmentPath(const std::string& name) {
+    return name.empty() || name[0] != '/' ? "/" + name : name;
+}
+
+} // namespace
+
+struct SharedInventory::Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t max_warehouses;
+    uint32_t slot_count;         // ячеек продуктов на склад
+    uint32_t reserved;
+    uint64_t size;
+    uint64_t warehouses_offset;  // смещение массива WarehouseRecord
+    uint64_t slots_offset;       // смещение ячеек первого склада
+    pthread_mutex_t registry_lock;
+    std::atomic<uint32_t> warehouse_count;
+};
+
+struct SharedInventory::WarehouseRecord {
+    pthread_mutex_t lock;
+    char name[kNameBytes];
+    uint64_t capacity;
+    double max_kg;
+    double max_volume;
+    std::atomic<uint64_t> units;
+    std::atomic<double> kg;
+    std::atomic<double> volume;
+};
+
+struct SharedInventory::SlotRecord {
+    std::atomic<uint32_t> state; // 0 - свободна, 1 - занята продуктом
+    uint32_t hash;
+    char product[kProductBytes];
+    char packaging[kPackagingBytes];
+    double weight;
+    double volume; // м³ на единицу по таблице упаковок процесса, занявшего ячейку
+    std::atomic<uint64_t> quantity;
+
+    Capacity unit() const { return Capacity{1, weight, volume}; }
+};
+
+SharedInventory::~SharedInventory() {
+    close();
+}
+
+bool SharedInventory::map(size_t size) {
+    void* addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED) {
+        return false;
+    }
+    base = addr;
+    mapped = size;
+    return true;
+}
+
+bool SharedInventory::create(const std::string& name, uint32_t warehouses, uint32_t products) {
+    close();
+    if (warehouses == 0 || products == 0) {
+        return false;
+    }
+    segment = segmentPath(name);
+    fd = shm_open(segment.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        return false;
+    }
+    uint32_t slot_count = products * 2; // половина ячеек свободна: короткие цепочки пробирования
+    size_t warehouses_offset = (sizeof(Header) + 63) / 64 * 64;
+    size_t slots_offset = warehouses_offset + (warehouses * sizeof(WarehouseRecord) + 63) / 64 * 64;
+    size_t size = slots_offset + static_cast<size_t>(warehouses) * slot_count * sizeof(SlotRecord);
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0 || !map(size)) {
+        close();
+        shm_unlink(segment.c_str());
+        return false;
+    }
+
+    // ftruncate заполняет сегмент нулями: пустые ячейки и нулевые атомики уже готовы
+    Header* h = header();
+    h->version = kVersion;
+    h->max_warehouses = warehouses;
+    h->slot_count = slot_count;
+    h->size = size;
+    h->warehouses_offset = warehouses_offset;
+    h->slots_offset = slots_offset;
+    bool ok = initSharedMutex(&h->registry_lock);
+    for (uint32_t i = 0; ok && i < warehouses; ++i) {
+        ok = initSharedMutex(&record(i)->lock);
+    }
+    if (!ok) {
+        close();
+        shm_unlink(segment.c_str());
+        return false;
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(h->magic, kMagic, sizeof(kMagic)); // сегмент готов к открытию
+    return true;
+}
+
+bool SharedInventory::open(const std::string& name) {
+    close();
+    segment = segmentPath(name);
+    fd = shm_open(segment.c_str(), O_RDWR, 0600);
+    struct stat st {};
+    if (fd < 0 || fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(Header) ||
+        !map(static_cast<size_t>(st.st_size))) {
+        close();
+        return false;
+    }
+    const Header* h = header();
+    if (std::memcmp(h->magic, kMagic, sizeof(kMagic)) != 0 || h->version != kVersion || h->size != mapped) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void SharedInventory::close() {
+    if (base) {
+        munmap(base, mapped);
+        base = nullptr;
+        mapped = 0;
+    }
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+bool SharedInventory::remove(const std::string& name) {
+    return shm_unlink(segmentPath(name).c_str()) == 0;
+}
+
+SharedInventory::Header* SharedInventory::header() const {
+    return static_cast<Header*>(base);
+}
+
+SharedInventory::WarehouseRecord* SharedInventory::record(uint32_t warehouse) const {
+    return reinterpret_cast<WarehouseRecord*>(static_cast<char*>(base) + header()->warehouses_offset) + warehouse;
+}
+
+SharedInventory::SlotRecord* SharedInventory::slots(uint32_t warehouse) const {
+    return reinterpret_cast<SlotRecord*>(static_cast<char*>(base) + header()->slots_offset) +
+           static_cast<size_t>(warehouse) * header()->slot_count;
+}
+
+int32_t SharedInventory::addWarehouse(const std::string& name, const Capacity& limits) {
+    if (!base || !fitsField(name, kNameBytes)) {
+        return kNotFound;
+    }
+    Header* h = header();
+    SharedLock lock(&h->registry_lock);
+    int32_t existing = findWarehouse(name);
+    if (existing != kNotFound) {
+        return existing;
+    }
+    uint32_t id = h->warehouse_count.load(std::memory_order_relaxed);
+    if (id >= h->max_warehouses) {
+        return kNotFound;
+    }
+    WarehouseRecord* r = record(id);
+    copyName(r->name, name);
+    r->capacity = limits.units;
+    r->max_kg = limits.kg;
+    r->max_volume = limits.volume;
+    h->warehouse_count.store(id + 1, std::memory_order_release); // запись склада видна целиком
+    return static_cast<int32_t>(id);
+}
+
+int32_t SharedInventory::findWarehouse(const std::string& name) const {
+    if (!base) {
+        return kNotFound;
+    }
+    uint32_t count = warehouseCount();
+    for (uint32_t i = 0; i < count; ++i) {
+        if (std::string_view(record(i)->name) == name) {
+            return static_cast<int32_t>(i);
+        }
+    }
+    return kNotFound;
+}
+
+uint32_t SharedInventory::warehouseCount() const {
+    return base ? header()->warehouse_count.load(std::memory_order_acquire) : 0;
+}
+
+std::string SharedInventory::warehouseName(uint32_t warehouse) const {
+    return warehouse < warehouseCount() ? std::string(record(warehouse)->name) : std::string();
+}
+
+SharedInventory::SlotRecord* SharedInventory::findSlot(uint32_t warehouse, const std::string& product) const {
+    if (!fitsField(product, kProductBytes)) {
+        return nullptr;
+    }
+    uint32_t count = header()->slot_count;
+    uint32_t hash = hashName(product);
+    SlotRecord* table = slots(warehouse);
+    for (uint32_t i = 0, at = hash % count; i < count; ++i, at = (at + 1) % count) {
+        SlotRecord& slot = table[at];
+        if (slot.state.load(std::memory_order_acquire) == 0) {
+            return nullptr; // ячейки не освобождаются, поэтому пустая прерывает поиск
+        }
+        if (slot.hash == hash && std::strcmp(slot.product, product.c_str()) == 0) {
+            return &slot;
+        }
+    }
+    return nullptr;
+}
+
+// Вызывается под мьютексом склада
+SharedInventory::SlotRecord* SharedInventory::claimSlot(uint32_t warehouse, const std::string& product, double weight,
+                                                        const std::string& packaging) {
+    if (SlotRecord* slot = findSlot(warehouse, product)) {
+        return slot;
+    }
+    if (!fitsField(product, kProductBytes) || !fitsField(packaging, kPackagingBytes)) {
+        return nullptr;
+    }
+    uint32_t count = header()->slot_count;
+    uint32_t hash = hashName(product);
+    SlotRecord* table = slots(warehouse);
+    for (uint32_t i = 0, at = hash % count; i < count; ++i, at = (at + 1) % count) {
+        SlotRecord& slot = table[at];
+        if (slot.state.load(std::memory_order_relaxed) == 0) {
+            slot.hash = hash;
+            copyName(slot.product, product);
+            copyName(slot.packaging, packaging);
+            slot.weight = weight;
+            slot.volume = Capacity::unit(weight, packaging).volume;
+            slot.state.store(1, std::memory_order_release); // читатели видят ячейку заполненной
+            return &slot;
+        }
+    }
+    return nullptr;
+}
+
+bool SharedInventory::store(uint32_t warehouse, const std::string& product, double weight, const std::string& packaging,
+                            uint64_t quantity) {
+    if (warehouse >= warehouseCount()) {
+        return false;
+    }
+    WarehouseRecord* r = record(warehouse);
+    SharedLock lock(&r->lock);
+    if (lock.ownerDied()) {
+        recount(warehouse);
+    }
+    // Единица продукта, уже лежащего на складе, - из его ячейки: таблицы упаковок процессов могут различаться
+    const SlotRecord* existing = findSlot(warehouse, product);
+    Capacity unit = existing ? existing->unit() : Capacity::unit(weight, packaging);
+    if (Capacity::fitCount(limits(warehouse), load(warehouse), unit) < quantity) {
+        return false;
+    }
+    SlotRecord* slot = claimSlot(warehouse, product, weight, packaging);
+    if (!slot) {
+        return false;
+    }
+    Capacity added = unit * quantity;
+    slot->quantity.fetch_add(quantity, std::memory_order_release);
+    r->units.fetch_add(added.units, std::memory_order_relaxed);
+    r->kg.fetch_add(added.kg, std::memory_order_relaxed);
+    r->volume.fetch_add(added.volume, std::memory_order_relaxed);
+    return true;
+}
+
+uint64_t SharedInventory::take(uint32_t warehouse, const std::string& product, uint64_t max_quantity) {
+    if (warehouse >= warehouseCount()) {
+        return 0;
+    }
+    WarehouseRecord* r = record(warehouse);
+    SharedLock lock(&r->lock);
+    if (lock.ownerDied()) {
+        recount(warehouse);
+    }
+    SlotRecord* slot = findSlot(warehouse, product);
+    if (!slot) {
+        return 0;
+    }
+    uint64_t taken = std::min(slot->quantity.load(std::memory_order_relaxed), max_quantity);
+    if (taken == 0) {
+        return 0;
+    }
+    Capacity released = slot->unit() * taken;
+    slot->quantity.fetch_sub(taken, std::memory_order_release);
+    r->units.fetch_sub(released.units, std::memory_order_relaxed);
+    r->kg.store(std::max(0.0, r->kg.load(std::memory_order_relaxed) - released.kg), std::memory_order_relaxed);
+    r->volume.store(std::max(0.0, r->volume.load(std::memory_order_relaxed) - released.volume), std::memory_order_relaxed);
+    return taken;
+}
+
+bool SharedInventory::publish(uint32_t warehouse, const std::string& product, double weight, const std::string& packaging,
+                              uint64_t quantity, const Capacity& used) {
+    if (warehouse >= warehouseCount()) {
+        return false;
+    }
+    WarehouseRecord* r = record(warehouse);
+    SharedLock lock(&r->lock); // загрузка склада записывается целиком: пересчёт после упавшего владельца не нужен
+    SlotRecord* slot = claimSlot(warehouse, product, weight, packaging);
+    if (slot) {
+        slot->quantity.store(quantity, std::memory_order_release);
+    }
+    r->units.store(used.units, std::memory_order_relaxed);
+    r->kg.store(used.kg, std::memory_order_relaxed);
+    r->volume.store(used.volume, std::memory_order_relaxed);
+    return slot != nullptr;
+}
+
+// Вызывается под мьютексом склада: остатки ячеек - источник истины для загрузки склада
+void SharedInventory::recount(uint32_t warehouse) {
+    Capacity used;
+    const SlotRecord* table = slots(warehouse);
+    for (uint32_t i = 0; i < header()->slot_count; ++i) {
+        const SlotRecord& slot = table[i];
+        if (slot.state.load(std::memory_order_acquire) == 1) {
+            used += slot.unit() * slot.quantity.load(std::memory_order_relaxed);
+        }
+    }
+    WarehouseRecord* r = record(warehouse);
+    r->units.store(used.units, std::memory_order_relaxed);
+    r->kg.store(used.kg, std::memory_order_relaxed);
+    r->volume.store(used.volume, std::memory_order_relaxed);
+}
+
+uint64_t SharedInventory::quantity(uint32_t warehouse, const std::string& product) const {
+    if (warehouse >= warehouseCount()) {
+        return 0;
+    }
+    const SlotRecord* slot = findSlot(warehouse, product);
+    return slot ? slot->quantity.load(std::memory_order_acquire) : 0;
+}
+
+Capacity SharedInventory::load(uint32_t warehouse) const {
+    if (warehouse >= warehouseCount()) {
+        return Capacity{};
+    }
+    const WarehouseRecord* r = record(warehouse);
+    return Capacity{r->units.load(std::memory_order_relaxed), r->kg.load(std::memory_order_relaxed),
+                    r->volume.load(std::memory_order_relaxed)};
+}
+
+Capacity SharedInventory::limits(uint32_t warehouse) const {
+    if (warehouse >= warehouseCount()) {
+        return Capacity{};
+    }
+    const WarehouseRecord* r = record(warehouse);
+    return Capacity{r->capacity, r->max_kg, r->max_volume};
+}
+
+std::vector<SharedStock> SharedInventory::stock(uint32_t warehouse) const {
+    std::vector<SharedStock> result;
+    if (warehouse >= warehouseCount()) {
+        return result;
+    }
+    const SlotRecord* table = slots(warehouse);
+    for (uint32_t i = 0; i < header()->slot_count; ++i) {
+        const SlotRecord& slot = table[i];
+        if (slot.state.load(std::memory_order_acquire) == 1) {
+            result.push_back({slot.product, slot.weight, slot.packaging, slot.quantity.load(std::memory_order_acquire), slot.volume});
+        }
+    }
+    std::sort(result.begin(), result.end(),
+              [](const SharedStock& a, const SharedStock& b) { return a.product < b.product; });
+    return result;
+}
@@ -0,0 +1,90 @@
+#ifndef SHARED_INVENTORY_H
+#define SHARED_INVENTORY_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "capacity.h"
+
+// Остаток продукта на складе в разделяемом сегменте
+struct SharedStock {
+    std::string product;
+    double weight = 0;
+    std::string packaging;
+    uint64_t quantity = 0;
+    double volume = 0; // м³ на единицу, как его учитывает сегмент
+};
+
+// Инвентарь складов в сегменте POSIX shared memory, общий для нескольких процессов
+// (приём заказов, отчёты, перебалансировка).
+// В сегменте нет указателей, только смещения от его начала, поэтому каждый процесс
+// может отобразить его по своему адресу. Остатки и загрузка - атомики без блокировок,
+// читатели обращаются к ним прямо в отображённой памяти. Изменения, которые проверяют
+// вместимость или занимают новую ячейку продукта, идут под мьютексом склада:
+// он process-shared и robust, так что упавший процесс не оставит склад заблокированным,
+// а загрузка склада, которую тот не дописал, пересчитывается по ячейкам продуктов.
+// Объём единицы записывается в ячейку при её занятии, и все процессы считают
+// загрузку по нему, а не по своей таблице упаковок.
+class SharedInventory {
+public:
+    static constexpr int32_t kNotFound = -1;
+
+    SharedInventory() = default;
+    ~SharedInventory();
+    SharedInventory(const SharedInventory&) = delete;
+    SharedInventory& operator=(const SharedInventory&) = delete;
+
+    // Создаёт новый сегмент /name на warehouses складов по products ячеек продуктов
+    bool create(const std::string& name, uint32_t warehouses, uint32_t products);
+    // Подключается к существующему сегменту
+    bool open(const std::string& name);
+    void close();
+    // Удаляет имя сегмента; подключённые процессы продолжают работать с ним
+    static bool remove(const std::string& name);
+
+    bool isOpen() const { return base != nullptr; }
+
+    // Регистрирует склад (или возвращает уже зарегистрированный с тем же именем).
+    // Имена хранятся целиком: склад - до 63 байт, продукт - до 55, упаковка - до 23;
+    // длиннее (и с нулём внутри) отклоняются, а не обрезаются. kNotFound - отказ
+    int32_t addWarehouse(const std::string& name, const Capacity& limits);
+    int32_t findWarehouse(const std::string& name) const;
+    uint32_t warehouseCount() const;
+    std::string warehouseName(uint32_t warehouse) const;
+
+    // Изменения с проверкой вместимости - для процессов, работающих с сегментом напрямую
+    bool store(uint32_t warehouse, const std::string& product, double weight, const std::string& packaging, uint64_t quantity);
+    uint64_t take(uint32_t warehouse, const std::string& product, uint64_t max_quantity);
+
+    // Зеркалирование живого Warehouse: записывает остаток и загрузку склада как есть.
+    // false - остаток продукта не отражён (неизвестный склад, длинное имя, нет свободной ячейки)
+    bool publish(uint32_t warehouse, const std::string& product, double weight, const std::string& packaging,
+                 uint64_t quantity, const Capacity& used);
+
+    // Чтение без блокировок
+    uint64_t quantity(uint32_t warehouse, const std::string& product) const;
+    Capacity load(uint32_t warehouse) const;
+    Capacity limits(uint32_t warehouse) const;
+    std::vector<SharedStock> stock(uint32_t warehouse) const;
+
+private:
+    struct Header;
+    struct WarehouseRecord;
+    struct SlotRecord;
+
+    std::string segment;
+    int fd = -1;
+    void* base = nullptr;
+    size_t mapped = 0;
+
+    bool map(size_t size);
+    Header* header() const;
+    WarehouseRecord* record(uint32_t warehouse) const;
+    SlotRecord* slots(uint32_t warehouse) const;
+    SlotRecord* findSlot(uint32_t warehouse, const std::string& product) const;
+    SlotRecord* claimSlot(uint32_t warehouse, const std::string& product, double weight, const std::string& packaging);
+    // Загрузка склада заново по остаткам ячеек - после владельца мьютекса, умершего посреди изменения
+    void recount(uint32_t warehouse);
+};
+
+#endif // SHARED_INVENTORY_H
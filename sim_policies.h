@@ -0,0 +1,250 @@
+#ifndef SIM_POLICIES_H
+#define SIM_POLICIES_H
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <vector>
+#include "capacity.h"
+
+// Политики для шаблонных BasicWarehouse/BasicTruck (basic_warehouse.h).
+// Выбираются при компиляции: однопоточные прогоны не платят за синхронизацию,
+// а живой сервис получает мьютексы или сегментированные блокировки.
+
+using ProductId = uint32_t;
+// Номер «нет такого продукта» (ProductCatalog::id для неизвестного имени); склады его не принимают
+inline constexpr ProductId kUnknownProduct = std::numeric_limits<ProductId>::max();
+
+// ---- Политики синхронизации ----
+// KeyGuard          - блокировка записи одного продукта;
+// TotalsGuard       - чтение общей загрузки склада без других блокировок;
+// NestedTotalsGuard - общая загрузка под уже взятым KeyGuard или AllGuard;
+// AllGuard          - весь склад целиком (авторазгрузка, обход инвентаря).
+
+// Без синхронизации: однопоточная симуляция и прогоны Монте-Карло
+struct NoLock {
+    static constexpr bool kSharded = false;
+
+    struct KeyGuard {
+        KeyGuard(NoLock&, ProductId) {}
+    };
+    struct TotalsGuard {
+        explicit TotalsGuard(NoLock&) {}
+    };
+    using NestedTotalsGuard = TotalsGuard;
+    struct AllGuard {
+        explicit AllGuard(NoLock&) {}
+    };
+};
+
+// Один мьютекс на весь объект, как у Warehouse
+struct MutexLock {
+    static constexpr bool kSharded = false;
+    std::mutex mtx;
+
+    struct KeyGuard {
+        KeyGuard(MutexLock& policy, ProductId) : lock(policy.mtx) {}
+        std::lock_guard<std::mutex> lock;
+    };
+    struct TotalsGuard {
+        explicit TotalsGuard(MutexLock& policy) : lock(policy.mtx) {}
+        std::lock_guard<std::mutex> lock;
+    };
+    struct NestedTotalsGuard {
+        explicit NestedTotalsGuard(MutexLock&) {} // мьютекс уже взят
+    };
+    struct AllGuard {
+        explicit AllGuard(MutexLock& policy) : lock(policy.mtx) {}
+        std::lock_guard<std::mutex> lock;
+    };
+};
+
+// Сегменты по номеру продукта: операции с разными продуктами не мешают друг другу.
+// Общая загрузка склада защищена отдельным мьютексом, он берётся последним.
+template <size_t Shards = 16>
+struct ShardedLock {
+    static constexpr bool kSharded = true;
+    std::array<std::mutex, Shards> shards;
+    std::mutex totals;
+
+    struct KeyGuard {
+        KeyGuard(ShardedLock& policy, ProductId product) : lock(policy.shards[product % Shards]) {}
+        std::lock_guard<std::mutex> lock;
+    };
+    struct TotalsGuard {
+        explicit TotalsGuard(ShardedLock& policy) : lock(policy.totals) {}
+        std::lock_guard<std::mutex> lock;
+    };
+    using NestedTotalsGuard = TotalsGuard;
+    struct AllGuard {
+        explicit AllGuard(ShardedLock& policy) : policy(policy) {
+            for (auto& shard : policy.shards) {
+                shard.lock(); // всегда по возрастанию номера сегмента
+            }
+        }
+        ~AllGuard() {
+            for (auto it = policy.shards.rbegin(); it != policy.shards.rend(); ++it) {
+                it->unlock();
+            }
+        }
+        AllGuard(const AllGuard&) = delete;
+        AllGuard& operator=(const AllGuard&) = delete;
+        ShardedLock& policy;
+    };
+};
+
+// ---- Политики хранения инвентаря ----
+// Хранение на каталог, известный при компиляции, - CatalogStorage (catalog.h).
+
+struct StockEntry {
+    Capacity unit;        // одна единица продукта
+    size_t quantity = 0;
+    bool present = false; // продукт хоть раз поступал на склад
+};
+
+// Упорядоченная карта, как у Warehouse. Вставка меняет структуру,
+// поэтому с сегментированными блокировками не используется.
+class MapStorage {
+public:
+    static constexpr bool kStableSlots = false;
+    static constexpr size_t kFixedProducts = 0; // 0 - каталог задаётся во время работы
+
+    void reserve(size_t) {}
+    StockEntry* find(ProductId product) {
+        auto it = entries.find(product);
+        return it != entries.end() ? &it->second : nullptr;
+    }
+    const StockEntry* find(ProductId product) const {
+        auto it = entries.find(product);
+        return it != entries.end() ? &it->second : nullptr;
+    }
+    StockEntry& slot(ProductId product) { return entries[product]; }
+    template <class F>
+    void forEach(F&& visit) {
+        for (auto& entry : entries) {
+            visit(entry.first, entry.second);
+        }
+    }
+
+private:
+    std::map<ProductId, StockEntry> entries;
+};
+
+// Открытая адресация с линейным пробированием: одна таблица без узлов в куче
+class FlatHashStorage {
+public:
+    static constexpr bool kStableSlots = false;
+    static constexpr size_t kFixedProducts = 0;
+
+    void reserve(size_t products) {
+        size_t wanted = 8;
+        while (wanted * 7 < products * 10) {
+            wanted *= 2;
+        }
+        if (wanted > keys.size()) {
+            rehash(wanted);
+        }
+    }
+    StockEntry* find(ProductId product) {
+        size_t i = locate(product);
+        return i != kMissing && keys[i] == product ? &values[i] : nullptr;
+    }
+    const StockEntry* find(ProductId product) const {
+        return const_cast<FlatHashStorage*>(this)->find(product);
+    }
+    StockEntry& slot(ProductId product) {
+        if ((used + 1) * 10 > keys.size() * 7) {
+            rehash(keys.empty() ? 8 : keys.size() * 2);
+        }
+        size_t i = locate(product);
+        if (keys[i] != product) {
+            keys[i] = product;
+            ++used;
+        }
+        return values[i];
+    }
+    template <class F>
+    void forEach(F&& visit) {
+        for (size_t i = 0; i < keys.size(); ++i) {
+            if (keys[i] != kEmpty) {
+                visit(keys[i], values[i]);
+            }
+        }
+    }
+
+private:
+    static constexpr ProductId kEmpty = std::numeric_limits<ProductId>::max();
+    static constexpr size_t kMissing = std::numeric_limits<size_t>::max();
+
+    std::vector<ProductId> keys;
+    std::vector<StockEntry> values;
+    size_t used = 0;
+
+    // Ячейка с ключом product или первая пустая на пути пробирования
+    size_t locate(ProductId product) const {
+        if (keys.empty()) {
+            return kMissing;
+        }
+        size_t mask = keys.size() - 1;
+        size_t i = (product * 0x9E3779B1u) & mask;
+        while (keys[i] != product && keys[i] != kEmpty) {
+            i = (i + 1) & mask;
+        }
+        return i;
+    }
+
+    void rehash(size_t size) {
+        std::vector<ProductId> old_keys(size, kEmpty);
+        std::vector<StockEntry> old_values(size);
+        old_keys.swap(keys);
+        old_values.swap(values);
+        for (size_t i = 0; i < old_keys.size(); ++i) {
+            if (old_keys[i] != kEmpty) {
+                size_t j = locate(old_keys[i]);
+                keys[j] = old_keys[i];
+                values[j] = old_values[i];
+            }
+        }
+    }
+};
+
+// Плотный массив по номеру продукта: для каталога с номерами 0..N-1.
+// После reserve(N) ячейки не перемещаются, поэтому годится для ShardedLock.
+class DenseArrayStorage {
+public:
+    static constexpr bool kStableSlots = true;
+    static constexpr size_t kFixedProducts = 0;
+
+    void reserve(size_t products) {
+        if (products > entries.size()) {
+            entries.resize(products);
+        }
+    }
+    StockEntry* find(ProductId product) {
+        return product < entries.size() && entries[product].present ? &entries[product] : nullptr;
+    }
+    const StockEntry* find(ProductId product) const {
+        return product < entries.size() && entries[product].present ? &entries[product] : nullptr;
+    }
+    StockEntry& slot(ProductId product) {
+        if (product >= entries.size()) {
+            entries.resize(product + 1);
+        }
+        return entries[product];
+    }
+    template <class F>
+    void forEach(F&& visit) {
+        for (size_t i = 0; i < entries.size(); ++i) {
+            if (entries[i].present) {
+                visit(static_cast<ProductId>(i), entries[i]);
+            }
+        }
+    }
+
+private:
+    std::vector<StockEntry> entries;
+};
+
+#endif // SIM_POLICIES_H
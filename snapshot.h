@@ -0,0 +1,194 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Примитивы для чтения состояния без блокировки пишущих потоков.
+// Отчёты (журнал поступлений, статистика грузовиков, остатки) читают
+// склад и грузовик, пока обработка заказов продолжается под mtx.
+
+// Счётчик последовательности seqlock. Писатель один (остальные
+// исключены внешним мьютексом) и никогда не ждёт читателей; читатель
+// повторяет чтение, если за это время началась или прошла запись.
+// Защищаемые данные должны быть атомарными и читаться relaxed.
+class SeqCounter {
+public:
+    void writeBegin() {
+        sequence.store(sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+    void writeEnd() {
+        sequence.store(sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    uint64_t readBegin() const {
+        uint64_t seq = sequence.load(std::memory_order_acquire);
+        while (seq & 1) {
+            seq = sequence.load(std::memory_order_acquire); // запись в процессе
+        }
+        return seq;
+    }
+    // true - прочитанное могло быть разорвано записью, читать заново
+    bool readRetry(uint64_t seq) const {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return sequence.load(std::memory_order_relaxed) != seq;
+    }
+    // Число завершённых записей
+    uint64_t version() const { return sequence.load(std::memory_order_acquire) / 2; }
+
+private:
+    std::atomic<uint64_t> sequence{0};
+};
+
+// Журнал только на добавление: элементы лежат в цепочке блоков и не
+// перемещаются, поэтому читатели обходят уже опубликованную часть без
+// блокировки, пока писатель дописывает новые. Писатель один.
+template <typename T, size_t ChunkSize = 256>
+class AppendLog {
+public:
+    AppendLog() = default;
+    AppendLog(const AppendLog&) = delete;
+    AppendLog& operator=(const AppendLog&) = delete;
+
+    ~AppendLog() {
+        size_t remaining = count.load(std::memory_order_relaxed);
+        Chunk* chunk = head;
+        while (chunk) {
+            size_t in_chunk = remaining < ChunkSize ? remaining : ChunkSize;
+            for (size_t i = 0; i < in_chunk; ++i) {
+                chunk->at(i).~T();
+            }
+            remaining -= in_chunk;
+            Chunk* next = chunk->next.load(std::memory_order_relaxed);
+            delete chunk;
+            chunk = next;
+        }
+    }
+
+    // Элемент конструируется на месте и становится виден читателям после возврата
+    template <typename... Args>
+    T& emplace_back(Args&&... args) {
+        size_t n = count.load(std::memory_order_relaxed);
+        size_t offset = n % ChunkSize;
+        if (offset == 0) {
+            Chunk* chunk = new Chunk;
+            if (tail) {
+                tail->next.store(chunk, std::memory_order_release);
+            } else {
+                head = chunk;
+            }
+            tail = chunk;
+        }
+        T* item = ::new (tail->slot(offset)) T(std::forward<Args>(args)...);
+        count.store(n + 1, std::memory_order_release);
+        return *item;
+    }
+
+    size_t size() const { return count.load(std::memory_order_acquire); }
+
+    // Обход опубликованных на момент вызова элементов в порядке добавления
+    template <typename Fn>
+    void forEach(Fn&& fn) const {
+        size_t n = count.load(std::memory_order_acquire);
+        const Chunk* chunk = n ? head : nullptr; // head записан до публикации первого элемента
+        for (size_t i = 0; i < n; ++i) {
+            if (i > 0 && i % ChunkSize == 0) {
+                chunk = chunk->next.load(std::memory_order_acquire);
+            }
+            fn(chunk->at(i % ChunkSize));
+        }
+    }
+
+private:
+    struct Chunk {
+        alignas(T) std::array<std::byte, sizeof(T) * ChunkSize> storage;
+        std::atomic<Chunk*> next{nullptr};
+
+        void* slot(size_t i) { return storage.data() + i * sizeof(T); }
+        T& at(size_t i) { return *std::launder(reinterpret_cast<T*>(slot(i))); }
+        const T& at(size_t i) const {
+            return *std::launder(reinterpret_cast<const T*>(storage.data() + i * sizeof(T)));
+        }
+    };
+
+    Chunk* head = nullptr;
+    Chunk* tail = nullptr;
+    std::atomic<size_t> count{0};
+};
+
+// Поиск записи по имени без блокировки: открытая адресация, писатель один,
+// записи не удаляются. При росте таблица копируется в новую вдвое больше;
+// старые таблицы живут до уничтожения справочника, поэтому читатель,
+// начавший поиск в старой, дочитает её корректно. Все таблицы вместе
+// занимают не больше удвоенной последней. T - запись с полем name.
+template <typename T>
+class NameDirectory {
+public:
+    NameDirectory() { grow(16); }
+    NameDirectory(const NameDirectory&) = delete;
+    NameDirectory& operator=(const NameDirectory&) = delete;
+
+    T* find(std::string_view name) const {
+        const Table* table = current.load(std::memory_order_acquire);
+        size_t mask = table->buckets.size() - 1;
+        for (size_t i = std::hash<std::string_view>{}(name) & mask;; i = (i + 1) & mask) {
+            T* item = table->buckets[i].load(std::memory_order_acquire);
+            if (!item || item->name == name) {
+                return item;
+            }
+        }
+    }
+
+    // Только писатель; записи с таким именем ещё нет
+    void insert(T* item) {
+        Table* table = tables.back().get();
+        if ((count + 1) * 2 > table->buckets.size()) {
+            table = grow(table->buckets.size() * 2);
+        }
+        place(*table, item);
+        ++count;
+    }
+
+private:
+    struct Table {
+        explicit Table(size_t size) : buckets(size) {}
+        std::vector<std::atomic<T*>> buckets;
+    };
+
+    static void place(Table& table, T* item) {
+        size_t mask = table.buckets.size() - 1;
+        size_t i = std::hash<std::string_view>{}(item->name) & mask;
+        while (table.buckets[i].load(std::memory_order_relaxed)) {
+            i = (i + 1) & mask;
+        }
+        table.buckets[i].store(item, std::memory_order_release);
+    }
+
+    Table* grow(size_t size) {
+        auto table = std::make_unique<Table>(size);
+        if (!tables.empty()) {
+            for (const auto& bucket : tables.back()->buckets) {
+                if (T* item = bucket.load(std::memory_order_relaxed)) {
+                    place(*table, item);
+                }
+            }
+        }
+        tables.push_back(std::move(table));
+        current.store(tables.back().get(), std::memory_order_release);
+        return tables.back().get();
+    }
+
+    std::vector<std::unique_ptr<Table>> tables; // сторона писателя
+    std::atomic<const Table*> current{nullptr};
+    size_t count = 0;
+};
+
+#endif // SNAPSHOT_H
@@ -0,0 +1,225 @@
+#include "stock_history.h"
+
+#include <algorithm>
+#include <chrono>
+#include <queue>
+
+namespace {
+
+void putVarint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+uint64_t getVarint(const uint8_t*& in) {
+    uint64_t value = 0;
+    for (int shift = 0;; shift += 7) {
+        uint8_t byte = *in++;
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return value;
+        }
+    }
+}
+
+uint64_t zigzag(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+int64_t unzigzag(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+} // namespace
+
+int64_t StockSeries::append(int64_t time, size_t quantity, size_t block_samples, bool& sealed) {
+    sealed = false;
+    if (blocks.empty() || blocks.back().count >= block_samples) {
+        Block& block = blocks.emplace_back();
+        block.first_time = block.last_time = time;
+        block.first_value = block.last_value = quantity;
+        block.count = 1;
+        return static_cast<int64_t>(block.footprint());
+    }
+    Block& block = blocks.back();
+    size_t before = block.footprint();
+    time = std::max(time, block.last_time);
+    putVarint(block.bytes, static_cast<uint64_t>(time - block.last_time));
+    putVarint(block.bytes, zigzag(static_cast<int64_t>(quantity) - static_cast<int64_t>(block.last_value)));
+    block.last_time = time;
+    block.last_value = quantity;
+    if (++block.count == block_samples) {
+        block.bytes.shrink_to_fit(); // запечатанный блок больше не растёт
+        sealed = true;
+    }
+    return static_cast<int64_t>(block.footprint()) - static_cast<int64_t>(before);
+}
+
+size_t StockSeries::dropOldest(uint64_t& dropped_samples) {
+    if (blocks.size() < 2) {
+        return 0;
+    }
+    size_t freed = blocks.front().footprint();
+    dropped_samples += blocks.front().count;
+    blocks.pop_front();
+    return freed;
+}
+
+void StockSeries::collect(int64_t from, int64_t to, std::vector<StockSample>& out) const {
+    // Первый блок, который может содержать отсчёт не раньше from
+    auto it = std::partition_point(blocks.begin(), blocks.end(), [&](const Block& b) { return b.last_time < from; });
+    bool known = it != blocks.begin();
+    StockSample before;
+    if (known) {
+        before = {std::prev(it)->last_time, std::prev(it)->last_value};
+    }
+    size_t start = out.size();
+    for (; it != blocks.end() && it->first_time <= to; ++it) {
+        StockSample sample{it->first_time, it->first_value};
+        const uint8_t* in = it->bytes.data();
+        for (uint32_t i = 0; i < it->count; ++i) {
+            if (i > 0) {
+                sample.time += static_cast<int64_t>(getVarint(in));
+                sample.quantity = static_cast<size_t>(static_cast<int64_t>(sample.quantity) + unzigzag(getVarint(in)));
+            }
+            if (sample.time < from) {
+                before = sample;
+                known = true;
+            } else if (sample.time <= to) {
+                out.push_back(sample);
+            } else {
+                break;
+            }
+        }
+    }
+    if (known) {
+        out.insert(out.begin() + static_cast<std::ptrdiff_t>(start), before);
+    }
+}
+
+StockHistory::StockHistory(const StockHistoryOptions& options) : options(options) {}
+
+int64_t StockHistory::now() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+StockSeries* StockHistory::series(std::string_view warehouse, std::string_view product) {
+    std::lock_guard<std::mutex> lock(map_mtx);
+    auto site = series_map.find(warehouse);
+    if (site == series_map.end()) {
+        site = series_map.emplace(std::string(warehouse), ProductSeries()).first;
+    }
+    auto it = site->second.find(product);
+    if (it == site->second.end()) {
+        it = site->second.emplace(std::string(product), std::make_unique<StockSeries>(std::string(warehouse), std::string(product)))
+                     .first;
+    }
+    return it->second.get();
+}
+
+void StockHistory::record(StockSeries& series, int64_t time, size_t quantity) {
+    bool sealed = false;
+    {
+        std::lock_guard<std::mutex> lock(series.mtx);
+        int64_t grown = series.append(time, quantity, options.block_samples, sealed);
+        bytes.fetch_add(static_cast<size_t>(grown), std::memory_order_relaxed); // по модулю 2^64 и для отрицательного
+    }
+    samples.fetch_add(1, std::memory_order_relaxed);
+    if (!sealed) {
+        return;
+    }
+    // Уборка после запечатывания блока: сразу при превышении бюджета, иначе не чаще 1/64 срока хранения.
+    // Вне блокировки ряда: compact сам берёт блокировки в порядке map_mtx -> ряд
+    int64_t last = last_compact.load(std::memory_order_relaxed);
+    bool over_budget = bytes.load(std::memory_order_relaxed) > options.max_bytes;
+    if ((over_budget || time - last >= options.retention_ms / 64) &&
+        last_compact.compare_exchange_strong(last, time, std::memory_order_relaxed)) {
+        compact(time);
+    }
+}
+
+const StockSeries* StockHistory::find(std::string_view warehouse, std::string_view product) const {
+    std::lock_guard<std::mutex> lock(map_mtx);
+    auto site = series_map.find(warehouse);
+    if (site == series_map.end()) {
+        return nullptr;
+    }
+    auto it = site->second.find(product);
+    return it == site->second.end() ? nullptr : it->second.get();
+}
+
+std::vector<StockSample> StockHistory::range(std::string_view warehouse, std::string_view product, int64_t from,
+                                             int64_t to) const {
+    std::vector<StockSample> result;
+    if (const StockSeries* series = find(warehouse, product)) {
+        std::lock_guard<std::mutex> lock(series->mtx);
+        series->collect(from, to, result);
+    }
+    return result;
+}
+
+std::optional<size_t> StockHistory::at(std::string_view warehouse, std::string_view product, int64_t time) const {
+    std::vector<StockSample> samples_at = range(warehouse, product, time, time);
+    if (samples_at.empty()) {
+        return std::nullopt;
+    }
+    return samples_at.back().quantity; // последний из отсчётов ровно в time или остаток до него
+}
+
+size_t StockHistory::compact(int64_t now_ms) {
+    std::lock_guard<std::mutex> lock(map_mtx);
+    size_t dropped = 0;
+    uint64_t dropped_samples = 0;
+    size_t freed = 0;
+    const int64_t horizon = now_ms - options.retention_ms;
+    // Самые старые блоки рядов для удаления сверх бюджета: (время начала, ряд)
+    using Oldest = std::pair<int64_t, StockSeries*>;
+    std::priority_queue<Oldest, std::vector<Oldest>, std::greater<>> oldest;
+    for (auto& site : series_map) {
+        for (auto& entry : site.second) {
+            StockSeries& series = *entry.second;
+            std::lock_guard<std::mutex> series_lock(series.mtx);
+            while (series.blocks.size() > 1 && series.blocks.front().last_time < horizon) {
+                freed += series.dropOldest(dropped_samples);
+                ++dropped;
+            }
+            if (series.blocks.size() > 1) {
+                oldest.emplace(series.blocks.front().first_time, &series);
+            }
+        }
+    }
+    bytes.fetch_sub(freed, std::memory_order_relaxed);
+
+    // Бюджет: освобождаем до 7/8, чтобы не убирать на каждом запечатанном блоке
+    const size_t target = options.max_bytes - options.max_bytes / 8;
+    while (bytes.load(std::memory_order_relaxed) > target && !oldest.empty()) {
+        StockSeries* series = oldest.top().second;
+        oldest.pop();
+        std::lock_guard<std::mutex> series_lock(series->mtx);
+        bytes.fetch_sub(series->dropOldest(dropped_samples), std::memory_order_relaxed);
+        ++dropped;
+        if (series->blocks.size() > 1) {
+            oldest.emplace(series->blocks.front().first_time, series);
+        }
+    }
+    samples.fetch_sub(dropped_samples, std::memory_order_relaxed);
+    return dropped;
+}
+
+StockHistoryStats StockHistory::stats() const {
+    StockHistoryStats result;
+    std::lock_guard<std::mutex> lock(map_mtx);
+    for (const auto& site : series_map) {
+        for (const auto& entry : site.second) {
+            std::lock_guard<std::mutex> series_lock(entry.second->mtx);
+            ++result.series;
+            result.blocks += entry.second->blocks.size();
+        }
+    }
+    result.samples = samples.load(std::memory_order_relaxed);
+    result.bytes = bytes.load(std::memory_order_relaxed);
+    return result;
+}
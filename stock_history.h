@@ -0,0 +1,115 @@
+#ifndef STOCK_HISTORY_H
+#define STOCK_HISTORY_H
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Остаток продукта на складе в момент времени (мс от эпохи Unix)
+struct StockSample {
+    int64_t time = 0;
+    size_t quantity = 0;
+};
+
+struct StockHistoryOptions {
+    int64_t retention_ms = 30LL * 24 * 3600 * 1000; // старше - удаляется при compact
+    size_t block_samples = 512;                     // отсчётов в блоке до запечатывания
+    size_t max_bytes = 256u << 20;                  // бюджет памяти на все ряды
+};
+
+struct StockHistoryStats {
+    size_t series = 0;
+    size_t blocks = 0;
+    uint64_t samples = 0;
+    size_t bytes = 0;
+};
+
+// Ряд остатков одной пары (склад, продукт). Отсчёты лежат в блоках:
+// заголовок блока хранит первое и последнее время и значение, по нему
+// ищется нужный блок; внутри - приращения времени и остатка в varint
+// (остаток в zigzag), обычно 2-4 байта на отсчёт.
+class StockSeries {
+public:
+    StockSeries(std::string warehouse, std::string product) : warehouse(std::move(warehouse)), product(std::move(product)) {}
+
+    const std::string warehouse;
+    const std::string product;
+
+private:
+    friend class StockHistory;
+
+    struct Block {
+        int64_t first_time = 0;
+        int64_t last_time = 0;
+        size_t first_value = 0;
+        size_t last_value = 0;
+        uint32_t count = 0;
+        std::vector<uint8_t> bytes; // отсчёты после первого
+
+        size_t footprint() const { return sizeof(Block) + bytes.capacity(); }
+    };
+
+    mutable std::mutex mtx;
+    std::deque<Block> blocks; // по времени; последний - открытый
+
+    // Возвращает изменение занятой памяти в байтах; sealed - блок запечатан этим отсчётом
+    int64_t append(int64_t time, size_t quantity, size_t block_samples, bool& sealed);
+    // Удаляет самый старый блок, кроме открытого; возвращает освобождённые байты
+    size_t dropOldest(uint64_t& dropped_samples);
+    void collect(int64_t from, int64_t to, std::vector<StockSample>& out) const;
+};
+
+// История остатков по складам и продуктам для аналитики. Склад с
+// attachHistory пишет отсчёт при каждом изменении остатка. Запросы
+// «остаток X на складе A за последние 7 дней» ищут начальный блок двоичным
+// поиском по заголовкам и распаковывают только блоки диапазона. Память
+// ограничена сроком хранения и бюджетом байт: compact выбрасывает самые
+// старые запечатанные блоки; открытый блок ряда не удаляется никогда,
+// поэтому последний известный остаток сохраняется.
+class StockHistory {
+public:
+    explicit StockHistory(const StockHistoryOptions& options = StockHistoryOptions());
+    StockHistory(const StockHistory&) = delete;
+    StockHistory& operator=(const StockHistory&) = delete;
+
+    static int64_t now();
+
+    // Ряд пары; указатель стабилен до уничтожения истории
+    StockSeries* series(std::string_view warehouse, std::string_view product);
+    // Время отсчётов ряда не убывает: более раннее приравнивается к последнему
+    void record(StockSeries& series, int64_t time, size_t quantity);
+    void record(std::string_view warehouse, std::string_view product, size_t quantity) {
+        record(*series(warehouse, product), now(), quantity);
+    }
+
+    // Отсчёты в [from, to]; первым идёт последний отсчёт до from - остаток на момент from, если он известен
+    std::vector<StockSample> range(std::string_view warehouse, std::string_view product, int64_t from, int64_t to) const;
+    // Остаток на момент time; пусто, если отсчётов до time нет или они удалены
+    std::optional<size_t> at(std::string_view warehouse, std::string_view product, int64_t time) const;
+
+    // Удаляет блоки старше срока хранения и сверх бюджета. Возвращает число удалённых блоков
+    size_t compact(int64_t now_ms);
+    StockHistoryStats stats() const;
+
+private:
+    using ProductSeries = std::map<std::string, std::unique_ptr<StockSeries>, std::less<>>;
+
+    StockHistoryOptions options;
+    mutable std::mutex map_mtx;
+    std::map<std::string, ProductSeries, std::less<>> series_map; // склад -> продукт -> ряд
+    std::atomic<size_t> bytes{0};
+    std::atomic<uint64_t> samples{0};
+    std::atomic<int64_t> last_compact{0};
+
+    const StockSeries* find(std::string_view warehouse, std::string_view product) const;
+};
+
+#endif // STOCK_HISTORY_H
@@ -0,0 +1,201 @@
+#include "sweep.h"
+#include "basic_warehouse.h"
+#include "logging.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <thread>
+
+namespace {
+
+// Прогоны однопоточные: без блокировок, продукты - плотные номера 0..N-1
+using SimWarehouse = BasicWarehouse<NoLock, DenseArrayStorage>;
+using SimTruck = BasicTruck<NoLock>;
+
+size_t sampleCount(std::mt19937_64& rng, const ParamRange& range) {
+    std::uniform_int_distribution<size_t> dist(static_cast<size_t>(range.min), static_cast<size_t>(range.max));
+    return dist(rng);
+}
+
+// Перемешивание номера прогона, чтобы соседние прогоны не получали похожие зёрна
+uint64_t splitmix(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+Percentiles summarize(std::vector<double> values) {
+    Percentiles p;
+    if (values.empty()) {
+        return p;
+    }
+    std::sort(values.begin(), values.end());
+    auto at = [&](double q) { return values[static_cast<size_t>(q * static_cast<double>(values.size() - 1))]; };
+    p.p5 = at(0.05);
+    p.p50 = at(0.5);
+    p.p95 = at(0.95);
+    double sum = 0;
+    for (double v : values) {
+        sum += v;
+    }
+    p.mean = sum / static_cast<double>(values.size());
+    return p;
+}
+
+} // namespace
+
+ScenarioResult runScenario(const SweepConfig& config, uint64_t seed) {
+    std::mt19937_64 rng(seed);
+    ScenarioResult result;
+
+    result.warehouses = sampleCount(rng, config.warehouses);
+    result.warehouse_capacity = sampleCount(rng, config.warehouse_capacity);
+    result.trucks = sampleCount(rng, config.trucks);
+    result.truck_capacity = sampleCount(rng, config.truck_capacity);
+    size_t product_count = sampleCount(rng, config.products);
+    size_t shop_count = sampleCount(rng, config.shops);
+    double orders_per_day = std::uniform_real_distribution<double>(config.orders_per_day.min, config.orders_per_day.max)(rng);
+
+    std::vector<std::unique_ptr<SimWarehouse>> warehouse_pool;
+    std::vector<SimWarehouse*> warehouses;
+    for (size_t i = 0; i < result.warehouses; ++i) {
+        warehouse_pool.push_back(std::make_unique<SimWarehouse>("Склад " + std::to_string(i + 1),
+                                                                Capacity::limits(result.warehouse_capacity), product_count));
+        warehouses.push_back(warehouse_pool.back().get());
+    }
+    std::vector<std::unique_ptr<SimTruck>> truck_pool;
+    std::vector<SimTruck*> trucks;
+    for (size_t i = 0; i < result.trucks; ++i) {
+        truck_pool.push_back(std::make_unique<SimTruck>("Грузовик " + std::to_string(i + 1), Capacity::limits(result.truck_capacity)));
+        trucks.push_back(truck_pool.back().get());
+    }
+    const Capacity unit = Capacity::unit(10.0, "Коробка");
+    std::vector<BasicFactory> factories;
+    size_t factory_count = sampleCount(rng, config.factories);
+    for (size_t i = 0; i < factory_count; ++i) {
+        factories.emplace_back(static_cast<ProductId>(i % product_count), unit, sampleCount(rng, config.production_rate));
+    }
+
+    std::poisson_distribution<size_t> orders_dist(orders_per_day);
+    std::uniform_int_distribution<size_t> pick_product(1, product_count);
+    std::uniform_int_distribution<size_t> pick_shop(1, shop_count);
+    std::uniform_int_distribution<size_t> pick_lines(1, std::min<size_t>(3, product_count));
+
+    size_t produced = 0;
+    size_t placed = 0;
+    size_t requested = 0;
+    size_t delivered = 0;
+    size_t overloaded = 0;
+    double utilisation = 0;
+    size_t next_truck = 0;
+
+    for (size_t day = 0; day < config.days; ++day) {
+        for (auto& factory : factories) {
+            produced += factory.getProductionRate();
+            placed += factory.storage(warehouses);
+        }
+        for (auto* warehouse : warehouses) {
+            if (warehouse->isOverloaded()) {
+                ++overloaded;
+                warehouse->autoUnload(trucks); // синхронно: прогон однопоточный
+            }
+        }
+
+        size_t orders = orders_dist(rng);
+        for (size_t o = 0; o < orders; ++o) {
+            // Строки заказа по возрастанию номера продукта, повторы складываются
+            SimLine request[3];
+            size_t line_count = 0;
+            size_t lines = pick_lines(rng);
+            for (size_t l = 0; l < lines; ++l) {
+                size_t units = sampleCount(rng, config.order_units);
+                auto product = static_cast<ProductId>(pick_product(rng) - 1);
+                size_t at = 0;
+                while (at < line_count && request[at].product < product) {
+                    ++at;
+                }
+                if (at < line_count && request[at].product == product) {
+                    request[at].quantity += units;
+                } else {
+                    std::move_backward(request + at, request + line_count, request + line_count + 1);
+                    request[at] = SimLine{product, units};
+                    ++line_count;
+                }
+                requested += units;
+            }
+            pick_shop(rng); // магазин не влияет на итоги, но сохраняет последовательность случайных чисел
+            SimTruck* truck = trucks[next_truck++ % trucks.size()];
+            delivered += truck->deliver(warehouses, std::span<const SimLine>(request, line_count));
+        }
+
+        for (auto* warehouse : warehouses) {
+            utilisation += static_cast<double>(warehouse->getLoad().units) / static_cast<double>(result.warehouse_capacity);
+        }
+    }
+
+    size_t trips = 0;
+    for (auto* truck : trucks) {
+        trips += truck->getTrips();
+    }
+    double warehouse_days = static_cast<double>(config.days * result.warehouses);
+    result.fill_rate = requested ? static_cast<double>(delivered) / static_cast<double>(requested) : 1.0;
+    result.unplaced_share = produced ? static_cast<double>(produced - placed) / static_cast<double>(produced) : 0.0;
+    result.trips_per_day = static_cast<double>(trips) / static_cast<double>(config.days);
+    result.utilisation = warehouse_days > 0 ? utilisation / warehouse_days : 0;
+    result.overload_days = warehouse_days > 0 ? static_cast<double>(overloaded) / warehouse_days : 0;
+    return result;
+}
+
+SweepReport runSweep(const SweepConfig& config, size_t runs, uint64_t seed, unsigned threads) {
+    SweepReport report;
+    report.runs = runs;
+    report.results.resize(runs);
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    // Прогоны независимы: потоки разбирают номера прогонов и пишут каждый в свою ячейку
+    std::atomic<size_t> next{0};
+    auto worker = [&] {
+        for (size_t run = next++; run < runs; run = next++) {
+            report.results[run] = runScenario(config, splitmix(seed + run));
+        }
+    };
+    std::vector<std::thread> pool;
+    for (unsigned i = 1; i < threads; ++i) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto& t : pool) {
+        t.join();
+    }
+    report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    auto metric = [&](const char* name, double ScenarioResult::*field) {
+        std::vector<double> values;
+        values.reserve(runs);
+        for (const auto& r : report.results) {
+            values.push_back(r.*field);
+        }
+        report.metrics.emplace_back(name, summarize(std::move(values)));
+    };
+    metric("Доля выполненного спроса", &ScenarioResult::fill_rate);
+    metric("Доля неразмещённой продукции", &ScenarioResult::unplaced_share);
+    metric("Рейсов в день", &ScenarioResult::trips_per_day);
+    metric("Заполненность складов", &ScenarioResult::utilisation);
+    metric("Доля дней с перегрузкой", &ScenarioResult::overload_days);
+    return report;
+}
+
+void printSweepReport(const SweepReport& report) {
+    console() << "Прогонов: " << report.runs << ", время: " << report.seconds << " с\n";
+    for (const auto& entry : report.metrics) {
+        console() << entry.first << ": p5=" << entry.second.p5 << ", p50=" << entry.second.p50
+                  << ", p95=" << entry.second.p95 << ", среднее=" << entry.second.mean << "\n";
+    }
+}
@@ -0,0 +1,64 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Диапазон параметра; значение для прогона выбирается равномерно
+struct ParamRange {
+    double min;
+    double max;
+};
+
+// Пространство параметров для планирования мощностей
+struct SweepConfig {
+    ParamRange warehouses{2, 6};
+    ParamRange warehouse_capacity{200, 2000};
+    ParamRange trucks{2, 12};
+    ParamRange truck_capacity{8, 40};
+    ParamRange factories{2, 8};
+    ParamRange production_rate{20, 200};
+    ParamRange products{2, 10};
+    ParamRange shops{1, 10};
+    ParamRange orders_per_day{5, 60};
+    ParamRange order_units{1, 30};
+    size_t days = 30;
+};
+
+// Параметры и итоги одного прогона
+struct ScenarioResult {
+    size_t warehouses = 0;
+    size_t warehouse_capacity = 0;
+    size_t trucks = 0;
+    size_t truck_capacity = 0;
+    double fill_rate = 0;        // доля выполненного спроса
+    double unplaced_share = 0;   // доля продукции, не поместившейся на склады
+    double trips_per_day = 0;
+    double utilisation = 0;      // средняя заполненность складов на конец дня
+    double overload_days = 0;    // доля склад-дней с перегрузкой
+};
+
+struct Percentiles {
+    double p5 = 0;
+    double p50 = 0;
+    double p95 = 0;
+    double mean = 0;
+};
+
+struct SweepReport {
+    size_t runs = 0;
+    double seconds = 0;
+    std::vector<std::pair<std::string, Percentiles>> metrics;
+    std::vector<ScenarioResult> results;
+};
+
+// Один прогон: свой мир складов, грузовиков и фабрик, вывод подавлен
+ScenarioResult runScenario(const SweepConfig& config, uint64_t seed);
+
+// Независимые прогоны параллельно на всех ядрах (threads = 0) и сводка по перцентилям
+SweepReport runSweep(const SweepConfig& config, size_t runs, uint64_t seed = 1, unsigned threads = 0);
+void printSweepReport(const SweepReport& report);
+
+#endif // SWEEP_H
@@ -0,0 +1,267 @@
+#include "timer_wheel.h"
+
+#include <algorithm>
+#include <bit>
+
+TimerWheel::TimerWheel(uint64_t start_tick) : current(start_tick) {
+    heads.fill(kNil);
+}
+
+TimerId TimerWheel::schedule(uint64_t expiry, Callback callback) {
+    uint32_t index;
+    if (free_head != kNil) {
+        index = free_head;
+        free_head = nodes[index].next;
+    } else {
+        index = static_cast<uint32_t>(nodes.size());
+        nodes.emplace_back();
+    }
+    Node& node = nodes[index];
+    node.callback = std::move(callback);
+    node.expiry = std::max(expiry, current + 1); // текущий тик уже обработан
+    place(index, node.expiry);
+    ++active;
+    return (static_cast<uint64_t>(node.generation) << 32) | (index + 1);
+}
+
+bool TimerWheel::cancel(TimerId id) {
+    auto index = static_cast<uint32_t>(id & 0xffffffffu) - 1;
+    auto generation = static_cast<uint32_t>(id >> 32);
+    if (id == 0 || index >= nodes.size() || nodes[index].generation != generation || nodes[index].list == kFree) {
+        return false;
+    }
+    unlink(index);
+    release(index);
+    return true;
+}
+
+// Уровень выбирается по расстоянию до срока, ячейка - по битам самого срока.
+// Перенос ячейки уровня L происходит, когда младшие 6L бит времени обнуляются,
+// и к этому моменту срок таймера ещё не наступил
+void TimerWheel::place(uint32_t index, uint64_t expiry) {
+    uint64_t delta = expiry - current; // при переносе бывает 0: срабатывает на этом же тике
+    unsigned level = delta < kSlots ? 0 : (static_cast<unsigned>(std::bit_width(delta)) - 1) / kLevelBits;
+    if (level >= kLevels) {
+        level = kLevels - 1;
+        expiry = current + kHorizon - 1; // дальний срок ждёт на верхнем уровне и переносится повторно
+    }
+    auto slot = static_cast<size_t>((expiry >> (level * kLevelBits)) & (kSlots - 1));
+    link(index, static_cast<uint32_t>(level * kSlots + slot));
+}
+
+void TimerWheel::link(uint32_t index, uint32_t list) {
+    Node& node = nodes[index];
+    node.list = list;
+    node.prev = kNil;
+    node.next = heads[list];
+    if (node.next != kNil) {
+        nodes[node.next].prev = index;
+    }
+    heads[list] = index;
+    if (list < kFiring) {
+        occupied[list / kSlots] |= uint64_t{1} << (list % kSlots);
+    }
+}
+
+void TimerWheel::unlink(uint32_t index) {
+    Node& node = nodes[index];
+    if (node.prev != kNil) {
+        nodes[node.prev].next = node.next;
+    } else {
+        heads[node.list] = node.next;
+    }
+    if (node.next != kNil) {
+        nodes[node.next].prev = node.prev;
+    }
+    if (node.list < kFiring && heads[node.list] == kNil) {
+        occupied[node.list / kSlots] &= ~(uint64_t{1} << (node.list % kSlots));
+    }
+}
+
+void TimerWheel::release(uint32_t index) {
+    Node& node = nodes[index];
+    node.callback = nullptr;
+    node.list = kFree;
+    ++node.generation; // старые номера таймера больше не совпадут
+    node.next = free_head;
+    free_head = index;
+    --active;
+}
+
+void TimerWheel::cascade(unsigned level, size_t slot) {
+    uint32_t list = static_cast<uint32_t>(level * kSlots + slot);
+    uint32_t index = heads[list];
+    heads[list] = kNil;
+    occupied[level] &= ~(uint64_t{1} << slot);
+    while (index != kNil) {
+        uint32_t next = nodes[index].next;
+        place(index, nodes[index].expiry);
+        index = next;
+    }
+}
+
+size_t TimerWheel::fire() {
+    for (unsigned level = kLevels - 1; level > 0; --level) {
+        if ((current & ((uint64_t{1} << (level * kLevelBits)) - 1)) == 0) {
+            cascade(level, static_cast<size_t>((current >> (level * kLevelBits)) & (kSlots - 1)));
+        }
+    }
+    // Ячейка тика целиком уходит в отдельный список: обработчики могут ставить
+    // таймеры в неё же на следующий круг и отменять ещё не вызванные
+    auto slot = static_cast<uint32_t>(current & (kSlots - 1));
+    uint32_t index = heads[slot];
+    heads[slot] = kNil;
+    occupied[0] &= ~(uint64_t{1} << slot);
+    for (uint32_t i = index; i != kNil; i = nodes[i].next) {
+        nodes[i].list = kFiring;
+    }
+    heads[kFiring] = index;
+
+    size_t fired = 0;
+    while (heads[kFiring] != kNil) {
+        uint32_t i = heads[kFiring];
+        unlink(i);
+        Callback callback = std::move(nodes[i].callback);
+        release(i);
+        callback();
+        ++fired;
+    }
+    return fired;
+}
+
+uint64_t TimerWheel::nextTick() const {
+    if (active == 0) {
+        return kNever;
+    }
+    uint64_t best = kNever;
+    for (unsigned level = 0; level < kLevels; ++level) {
+        if (!occupied[level]) {
+            continue;
+        }
+        // Ячейки уровня проходятся по кругу начиная со следующей после текущей
+        uint64_t base = current >> (level * kLevelBits);
+        auto start = static_cast<int>((base + 1) & (kSlots - 1));
+        uint64_t step = static_cast<uint64_t>(std::countr_zero(std::rotr(occupied[level], start)));
+        best = std::min(best, (base + 1 + step) << (level * kLevelBits));
+    }
+    return best;
+}
+
+size_t TimerWheel::advance(uint64_t tick) {
+    size_t fired = 0;
+    while (current < tick) {
+        uint64_t next = nextTick();
+        if (next > tick) {
+            current = tick;
+            break;
+        }
+        current = next;
+        fired += fire();
+    }
+    return fired;
+}
+
+TimerService::TimerService(std::chrono::milliseconds tick)
+        : tick(std::max(tick, std::chrono::milliseconds(1))), origin(clock::now()), worker([this] { run(); }) {}
+
+TimerService::~TimerService() {
+    stop();
+}
+
+void TimerService::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopping = true;
+    }
+    cv.notify_one();
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+uint64_t TimerService::ticksFrom(clock::time_point time) const {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(time - origin) / tick);
+}
+
+TimerId TimerService::after(std::chrono::milliseconds delay, TimerWheel::Callback callback) {
+    // Срок округляется вверх до тика: таймер не срабатывает раньше delay
+    auto ticks = static_cast<uint64_t>((delay + tick - std::chrono::milliseconds(1)) / tick);
+    TimerId id;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        id = wheel.schedule(ticksFrom(clock::now()) + ticks, [this, callback = std::move(callback)]() mutable {
+            due.push_back(std::move(callback));
+        });
+    }
+    cv.notify_one();
+    return id;
+}
+
+TimerId TimerService::every(std::chrono::milliseconds period, TimerWheel::Callback callback) {
+    TimerId id;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        // Номера повторов не пересекаются с номерами колеса: старший бит поднят
+        id = (uint64_t{1} << 63) | ++next_repeat;
+        repeats.emplace(id, Repeat{std::max(period, tick), std::make_shared<TimerWheel::Callback>(std::move(callback)), 0});
+        arm(id, ticksFrom(clock::now()));
+    }
+    cv.notify_one();
+    return id;
+}
+
+void TimerService::arm(TimerId repeat_id, uint64_t from) {
+    Repeat& repeat = repeats.at(repeat_id);
+    auto ticks = static_cast<uint64_t>(repeat.period / tick);
+    repeat.armed = wheel.schedule(from + ticks, [this, repeat_id] {
+        auto it = repeats.find(repeat_id);
+        if (it == repeats.end()) {
+            return;
+        }
+        due.push_back([callback = it->second.callback] { (*callback)(); });
+        arm(repeat_id, wheel.now()); // под mtx: advance вызывается в run под блокировкой
+    });
+}
+
+bool TimerService::cancel(TimerId id) {
+    std::lock_guard<std::mutex> lock(mtx);
+    auto it = repeats.find(id);
+    if (it != repeats.end()) {
+        wheel.cancel(it->second.armed);
+        repeats.erase(it);
+        return true;
+    }
+    return wheel.cancel(id);
+}
+
+size_t TimerService::pending() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return wheel.size();
+}
+
+void TimerService::run() {
+    std::unique_lock<std::mutex> lock(mtx);
+    std::vector<TimerWheel::Callback> ready;
+    while (!stopping) {
+        uint64_t next = wheel.nextTick();
+        if (next == TimerWheel::kNever) {
+            cv.wait(lock);
+        } else {
+            cv.wait_until(lock, origin + tick * static_cast<int64_t>(next));
+        }
+        if (stopping) {
+            break;
+        }
+        wheel.advance(ticksFrom(clock::now()));
+        if (due.empty()) {
+            continue;
+        }
+        ready.swap(due);
+        lock.unlock();
+        for (auto& callback : ready) {
+            callback();
+        }
+        ready.clear();
+        lock.lock();
+    }
+}
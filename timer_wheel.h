@@ -0,0 +1,126 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Номер таймера: индекс узла и поколение; 0 - таймера нет.
+// Отмена уже сработавшего или отменённого таймера ничего не делает.
+using TimerId = uint64_t;
+
+// Иерархическое колесо таймеров (hashed hierarchical timing wheel).
+// Время - целые тики; уровень L делит 64^(L+1) тиков на 64 ячейки, и таймер
+// лежит в ячейке по своему сроку. Когда младший уровень проходит круг,
+// ячейка старшего переносится вниз. Вставка и отмена - O(1): узлы в
+// общем массиве, ячейки - двусвязные списки по индексам. Пустые тики
+// пропускаются по битовым картам занятых ячеек, поэтому симуляция может
+// перескакивать сутки. Однопоточное; для живого сервиса - TimerService.
+class TimerWheel {
+public:
+    using Callback = std::function<void()>;
+
+    static constexpr unsigned kLevelBits = 6;
+    static constexpr size_t kSlots = size_t{1} << kLevelBits;
+    static constexpr unsigned kLevels = 6;                                 // 64^6 тиков: 795 суток при тике 1 мс
+    static constexpr uint64_t kHorizon = uint64_t{1} << (kLevelBits * kLevels); // дальше - переносится с верхнего уровня
+    static constexpr uint64_t kNever = UINT64_MAX;
+
+    explicit TimerWheel(uint64_t start_tick = 0);
+
+    uint64_t now() const { return current; }
+    size_t size() const { return active; }
+
+    // Срабатывает на тике expiry; прошедший срок - на следующем тике
+    TimerId schedule(uint64_t expiry, Callback callback);
+    TimerId scheduleAfter(uint64_t ticks, Callback callback) { return schedule(current + ticks, std::move(callback)); }
+    bool cancel(TimerId id);
+
+    // Продвигает время до tick включительно и вызывает наступившие таймеры
+    // в порядке тиков. Обработчик может ставить и отменять таймеры.
+    // Возвращает число вызванных
+    size_t advance(uint64_t tick);
+    // Ближайший тик, на котором что-то сработает или перенесётся; kNever - таймеров нет
+    uint64_t nextTick() const;
+
+private:
+    static constexpr uint32_t kNil = UINT32_MAX;
+    static constexpr uint32_t kFree = UINT32_MAX;                 // узел в списке свободных
+    static constexpr uint32_t kFiring = kLevels * kSlots;         // список срабатывающих на текущем тике
+
+    struct Node {
+        Callback callback;
+        uint64_t expiry = 0;
+        uint32_t prev = kNil;
+        uint32_t next = kNil;
+        uint32_t generation = 1;
+        uint32_t list = kFree;
+    };
+
+    std::vector<Node> nodes;
+    uint32_t free_head = kNil;
+    std::array<uint32_t, kLevels * kSlots + 1> heads;
+    std::array<uint64_t, kLevels> occupied{}; // бит - в ячейке уровня есть таймеры
+    uint64_t current;
+    size_t active = 0;
+
+    void place(uint32_t index, uint64_t expiry);
+    void link(uint32_t index, uint32_t list);
+    void unlink(uint32_t index);
+    void release(uint32_t index);
+    void cascade(unsigned level, size_t slot);
+    size_t fire();
+};
+
+// Таймеры реального времени для сервиса: колесо с тиком tick в своём потоке.
+// Ставить и отменять можно из любого потока; обработчики выполняются
+// в потоке таймеров без блокировки колеса и могут ставить новые таймеры.
+class TimerService {
+public:
+    explicit TimerService(std::chrono::milliseconds tick = std::chrono::milliseconds(1));
+    ~TimerService();
+    TimerService(const TimerService&) = delete;
+    TimerService& operator=(const TimerService&) = delete;
+
+    TimerId after(std::chrono::milliseconds delay, TimerWheel::Callback callback);
+    // Повтор каждые period до cancel; номер остаётся прежним
+    TimerId every(std::chrono::milliseconds period, TimerWheel::Callback callback);
+    bool cancel(TimerId id);
+    size_t pending() const;
+    // Останавливает поток; несработавшие таймеры отбрасываются
+    void stop();
+
+private:
+    using clock = std::chrono::steady_clock;
+
+    // Повторяющийся таймер: внешний номер и текущий таймер в колесе
+    struct Repeat {
+        std::chrono::milliseconds period;
+        std::shared_ptr<TimerWheel::Callback> callback;
+        TimerId armed = 0;
+    };
+
+    const std::chrono::milliseconds tick;
+    const clock::time_point origin;
+    mutable std::mutex mtx;
+    std::condition_variable cv;
+    TimerWheel wheel;
+    std::unordered_map<TimerId, Repeat> repeats;
+    TimerId next_repeat = 0;
+    std::vector<TimerWheel::Callback> due; // сработавшие, ждут вызова вне mtx
+    bool stopping = false;
+    std::thread worker;
+
+    uint64_t ticksFrom(clock::time_point time) const;
+    void arm(TimerId repeat_id, uint64_t from); // под mtx; from - тик, от которого отсчитывается период
+    void run();
+};
+
+#endif // TIMER_WHEEL_H
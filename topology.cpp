@@ -0,0 +1,100 @@
+#include "topology.h"
+#include "availability_index.h"
+#include "backorder.h"
+#include "classes.h"
+
+#include <algorithm>
+
+Topology::Topology() : current(new TopologyList) {}
+
+Topology::~Topology() {
+    const TopologyList* list = current.load(std::memory_order_relaxed);
+    for (auto* warehouse : list->warehouses) {
+        delete warehouse;
+    }
+    for (auto* truck : list->trucks) {
+        delete truck;
+    }
+    delete list;
+    // Выведенное ранее освобождается в collect; читателей уже нет, две эпохи проходят сразу
+    epoch::collect();
+    epoch::collect();
+}
+
+void Topology::attachBackorders(BackorderQueue* queue) {
+    std::lock_guard<std::mutex> lock(mtx);
+    backorders = queue;
+}
+
+Warehouse* Topology::addWarehouse(std::unique_ptr<Warehouse> warehouse) {
+    std::lock_guard<std::mutex> lock(mtx);
+    auto next = std::make_unique<TopologyList>(*current.load(std::memory_order_relaxed));
+    next->warehouses.push_back(warehouse.release());
+    Warehouse* added = next->warehouses.back();
+    publish(std::move(next));
+    return added;
+}
+
+Truck* Topology::addTruck(std::unique_ptr<Truck> truck) {
+    std::lock_guard<std::mutex> lock(mtx);
+    auto next = std::make_unique<TopologyList>(*current.load(std::memory_order_relaxed));
+    next->trucks.push_back(truck.release());
+    Truck* added = next->trucks.back();
+    publish(std::move(next));
+    return added;
+}
+
+bool Topology::retireWarehouse(const std::string& name) {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        auto next = std::make_unique<TopologyList>(*current.load(std::memory_order_relaxed));
+        auto it = std::find_if(next->warehouses.begin(), next->warehouses.end(),
+                               [&](Warehouse* w) { return w->getName() == name; });
+        if (it == next->warehouses.end()) {
+            return false;
+        }
+        Warehouse* retired = *it;
+        next->warehouses.erase(it);
+        publish(std::move(next));
+        // Держатели из индекса тоже ведут на склад: убираем их до освобождения
+        if (AvailabilityIndex* index = retired->getIndex()) {
+            index->unregisterWarehouse(retired->getIndexId());
+        }
+        epoch::retire(retired);
+    }
+    collect();
+    return true;
+}
+
+bool Topology::retireTruck(const std::string& name) {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        auto next = std::make_unique<TopologyList>(*current.load(std::memory_order_relaxed));
+        auto it = std::find_if(next->trucks.begin(), next->trucks.end(), [&](Truck* t) { return t->getName() == name; });
+        if (it == next->trucks.end()) {
+            return false;
+        }
+        Truck* retired = *it;
+        next->trucks.erase(it);
+        Truck* replacement = next->trucks.empty() ? nullptr : next->trucks.front();
+        publish(std::move(next));
+        if (backorders) {
+            backorders->reassignTruck(retired, replacement);
+        }
+        epoch::retire(retired);
+    }
+    collect();
+    return true;
+}
+
+size_t Topology::collect() {
+    return epoch::collect();
+}
+
+// Вызывается под mtx: старый список уходит на освобождение по эпохам
+void Topology::publish(std::unique_ptr<TopologyList> next) {
+    const TopologyList* previous = current.load(std::memory_order_relaxed);
+    next->version = previous->version + 1;
+    current.store(next.release(), std::memory_order_seq_cst);
+    epoch::retire(previous);
+}
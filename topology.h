@@ -0,0 +1,71 @@
+#ifndef TOPOLOGY_H
+#define TOPOLOGY_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "epoch.h"
+
+class BackorderQueue;
+class Truck;
+class Warehouse;
+
+// Опубликованный состав сети: неизменяем, пока его видит хоть один читатель
+struct TopologyList {
+    uint64_t version = 0;
+    std::vector<Warehouse*> warehouses;
+    std::vector<Truck*> trucks;
+};
+
+// Реестр складов и грузовиков, которые добавляются и выводятся на ходу.
+// Читатели (Factory::storage, Truck::deliver, Warehouse::autoUnload) обходят
+// опубликованный список без блокировок внутри Topology::Reader. Изменения
+// сериализуются мьютексом реестра: список копируется, правится и публикуется
+// целиком, а старый список и выведенные объекты освобождаются по эпохам (epoch.h).
+class Topology {
+public:
+    // Область чтения: список и все объекты в нём живы, пока Reader открыт
+    class Reader {
+    public:
+        explicit Reader(const Topology& topology)
+                : list(topology.current.load(std::memory_order_seq_cst)) {}
+        const std::vector<Warehouse*>& warehouses() const { return list->warehouses; }
+        const std::vector<Truck*>& trucks() const { return list->trucks; }
+        uint64_t version() const { return list->version; }
+
+    private:
+        EpochGuard guard; // закрепляется до чтения указателя на список
+        const TopologyList* list;
+    };
+
+    Topology();
+    // Освобождает всё сразу: читателей к этому моменту быть не должно
+    ~Topology();
+    Topology(const Topology&) = delete;
+    Topology& operator=(const Topology&) = delete;
+
+    Warehouse* addWarehouse(std::unique_ptr<Warehouse> warehouse);
+    Truck* addTruck(std::unique_ptr<Truck> truck);
+    // Вывод по имени: склад пропадает из индекса наличия, дозаказы грузовика
+    // переходят к другому грузовику (без них - отменяются). false - не найден.
+    bool retireWarehouse(const std::string& name);
+    bool retireTruck(const std::string& name);
+
+    // Очередь дозаказов, которой передаются дозаказы выведенных грузовиков
+    void attachBackorders(BackorderQueue* queue);
+    // Продвигает эпоху и освобождает то, что больше никто не читает
+    size_t collect();
+    size_t pendingReclaim() const { return epoch::pending(); }
+
+private:
+    mutable std::mutex mtx; // только для писателей
+    std::atomic<const TopologyList*> current;
+    BackorderQueue* backorders = nullptr;
+
+    void publish(std::unique_ptr<TopologyList> next);
+};
+
+#endif // TOPOLOGY_H
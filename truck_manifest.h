@@ -0,0 +1,68 @@
+#ifndef TRUCK_MANIFEST_H
+#define TRUCK_MANIFEST_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Содержимое кузова без выделений памяти: до kSlots строк (номер продукта,
+// количество) прямо в объекте грузовика. Строка упакована в одно 64-битное
+// слово; слова - атомики с relaxed-доступом, чтобы манифест можно было читать
+// под seqlock грузовика. Пишет один поток - владелец блокировки грузовика.
+// Продукты сверх kSlots различных не теряются: их единицы учитываются в untracked().
+class TruckManifest {
+public:
+    static constexpr size_t kSlots = 32;
+
+    struct Line {
+        uint32_t product = 0;
+        uint32_t quantity = 0;
+    };
+
+    void add(uint32_t product, size_t quantity) {
+        size_t n = used.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < n; ++i) {
+            Line line = unpack(slots[i].load(std::memory_order_relaxed));
+            if (line.product == product) {
+                size_t room = UINT32_MAX - line.quantity;
+                size_t added = quantity < room ? quantity : room;
+                slots[i].store(pack(product, line.quantity + added), std::memory_order_relaxed);
+                spill(quantity - added);
+                return;
+            }
+        }
+        if (n == kSlots) {
+            spill(quantity);
+            return;
+        }
+        size_t added = quantity < UINT32_MAX ? quantity : UINT32_MAX;
+        slots[n].store(pack(product, added), std::memory_order_relaxed);
+        used.store(n + 1, std::memory_order_relaxed);
+        spill(quantity - added);
+    }
+
+    void clear() {
+        used.store(0, std::memory_order_relaxed);
+        overflow.store(0, std::memory_order_relaxed);
+    }
+
+    size_t lines() const { return used.load(std::memory_order_relaxed); }
+    Line line(size_t i) const { return unpack(slots[i].load(std::memory_order_relaxed)); }
+    size_t untracked() const { return overflow.load(std::memory_order_relaxed); }
+
+private:
+    std::array<std::atomic<uint64_t>, kSlots> slots{};
+    std::atomic<size_t> used{0};
+    std::atomic<size_t> overflow{0};
+
+    static uint64_t pack(uint32_t product, size_t quantity) { return (uint64_t{product} << 32) | quantity; }
+    static Line unpack(uint64_t word) { return Line{static_cast<uint32_t>(word >> 32), static_cast<uint32_t>(word)}; }
+    void spill(size_t quantity) {
+        if (quantity) {
+            overflow.store(overflow.load(std::memory_order_relaxed) + quantity, std::memory_order_relaxed);
+        }
+    }
+};
+
+#endif // TRUCK_MANIFEST_H
@@ -0,0 +1,467 @@
+#include "wal.h"
+#include "classes.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <unistd.h>
+#include <unordered_map>
+
+namespace {
+
+// Файл журнала: заголовок [8 байт магии][u64 базовый LSN], затем записи.
+// Базовый LSN - последний номер, удалённый truncateUpTo: пустой после усечения
+// журнал продолжает нумерацию с него. Файлы без заголовка читаются с базой 0.
+// Формат записи: [u32 длина тела][u32 crc32 тела][тело]
+// Тело: u64 lsn, u8 тип, u64 количество, f64 вес, затем три строки (u16 длина + байты)
+constexpr size_t kFrameHeader = 8;
+constexpr char kWalMagic[8] = {'F', 'G', 'B', 'U', 'W', 'A', 'L', '1'};
+constexpr size_t kWalHeader = sizeof(kWalMagic) + sizeof(uint64_t);
+constexpr char kSnapshotMagic[8] = {'F', 'G', 'B', 'U', 'S', 'N', 'P', '1'};
+
+uint32_t crc32(const char* data, size_t size) {
+    static const std::array<uint32_t, 256> table = [] {
+        std::array<uint32_t, 256> t{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            t[i] = c;
+        }
+        return t;
+    }();
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; ++i) {
+        crc = table[(crc ^ static_cast<uint8_t>(data[i])) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+template <typename T>
+void put(std::string& out, T value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void putString(std::string& out, const std::string& s) {
+    put<uint16_t>(out, static_cast<uint16_t>(s.size()));
+    out.append(s.data(), s.size());
+}
+
+template <typename T>
+bool get(const char*& p, const char* end, T& value) {
+    if (static_cast<size_t>(end - p) < sizeof(T)) {
+        return false;
+    }
+    std::memcpy(&value, p, sizeof(T));
+    p += sizeof(T);
+    return true;
+}
+
+bool getString(const char*& p, const char* end, std::string& s) {
+    uint16_t len = 0;
+    if (!get(p, end, len) || static_cast<size_t>(end - p) < len) {
+        return false;
+    }
+    s.assign(p, len);
+    p += len;
+    return true;
+}
+
+bool writeAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = ::write(fd, data, size);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+void encodeHeader(std::string& out, uint64_t base_lsn) {
+    out.append(kWalMagic, sizeof(kWalMagic));
+    put<uint64_t>(out, base_lsn);
+}
+
+void encodeRecord(std::string& out, const WalRecord& r) {
+    size_t frame = out.size();
+    out.append(kFrameHeader, '\0');
+    put<uint64_t>(out, r.lsn);
+    put<uint8_t>(out, static_cast<uint8_t>(r.type));
+    put<uint64_t>(out, r.quantity);
+    put<double>(out, r.weight);
+    putString(out, r.warehouse);
+    putString(out, r.product);
+    putString(out, r.packaging);
+
+    uint32_t body_size = static_cast<uint32_t>(out.size() - frame - kFrameHeader);
+    uint32_t crc = crc32(out.data() + frame + kFrameHeader, body_size);
+    std::memcpy(&out[frame], &body_size, sizeof(body_size));
+    std::memcpy(&out[frame + 4], &crc, sizeof(crc));
+}
+
+} // namespace
+
+WriteAheadLog::WriteAheadLog(std::chrono::microseconds flush_interval)
+        : flush_interval(flush_interval) {}
+
+WriteAheadLog::~WriteAheadLog() {
+    close();
+}
+
+bool WriteAheadLog::open(const std::string& wal_path) {
+    close();
+
+    // Продолжаем нумерацию LSN с последней целой записи, а в пустом журнале - с базы заголовка
+    uint64_t base_lsn = 0;
+    size_t valid_bytes = 0;
+    std::vector<WalRecord> existing = readAll(wal_path, &base_lsn, &valid_bytes);
+    uint64_t lsn = existing.empty() ? base_lsn : std::max(base_lsn, existing.back().lsn);
+
+    fd = ::open(wal_path.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644); // O_RDWR: хвост обрезается только у файла, который readAll смог прочитать
+    if (fd < 0) {
+        console() << "Ошибка: не удалось открыть журнал " << wal_path << ".\n";
+        return false;
+    }
+    // Оборванный или испорченный хвост отрезается: иначе новые записи встали бы за ним,
+    // и восстановление, остановившись на нём, потеряло бы их
+    off_t size = ::lseek(fd, 0, SEEK_END);
+    if (size > static_cast<off_t>(valid_bytes)) {
+        if (::ftruncate(fd, static_cast<off_t>(valid_bytes)) != 0 || ::fdatasync(fd) != 0) {
+            console() << "Ошибка: не удалось обрезать повреждённый хвост журнала " << wal_path << ".\n";
+            ::close(fd);
+            fd = -1;
+            return false;
+        }
+        console() << "Журнал " << wal_path << ": отброшено " << size - static_cast<off_t>(valid_bytes)
+                  << " байт повреждённого хвоста.\n";
+    }
+    if (::lseek(fd, 0, SEEK_END) == 0) {
+        std::string header;
+        encodeHeader(header, 0);
+        if (!writeAll(fd, header.data(), header.size()) || ::fdatasync(fd) != 0) {
+            console() << "Ошибка: не удалось записать заголовок журнала " << wal_path << ".\n";
+            ::close(fd);
+            fd = -1;
+            return false;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mtx);
+    path = wal_path;
+    last_lsn = lsn;
+    durable_lsn = lsn;
+    stopping = false;
+    failed = false;
+    flusher = std::thread(&WriteAheadLog::flusherLoop, this);
+    return true;
+}
+
+void WriteAheadLog::close() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (fd < 0) {
+            return;
+        }
+        stopping = true;
+    }
+    work_cv.notify_one();
+    if (flusher.joinable()) {
+        flusher.join();
+    }
+    ::close(fd);
+    fd = -1;
+}
+
+uint64_t WriteAheadLog::appendLocked(WalRecordType type, const std::string& warehouse, const std::string& product_name,
+                                     double weight, const std::string& packaging, uint64_t quantity) {
+    WalRecord record;
+    record.lsn = ++last_lsn;
+    record.type = type;
+    record.warehouse = warehouse;
+    record.product = product_name;
+    record.weight = weight;
+    record.packaging = packaging;
+    record.quantity = quantity;
+    encodeRecord(pending, record);
+    return record.lsn;
+}
+
+uint64_t WriteAheadLog::append(WalRecordType type, const std::string& warehouse, const Product& product) {
+    std::lock_guard<std::mutex> lock(mtx);
+    return appendLocked(type, warehouse, product.name, product.weight, product.packaging, product.quantity);
+}
+
+uint64_t WriteAheadLog::append(WalRecordType type, const std::string& warehouse, const std::string& product_name,
+                               uint64_t quantity) {
+    std::lock_guard<std::mutex> lock(mtx);
+    return appendLocked(type, warehouse, product_name, 0, "", quantity);
+}
+
+bool WriteAheadLog::waitDurable(uint64_t lsn) {
+    std::unique_lock<std::mutex> lock(mtx);
+    if (durable_lsn >= lsn) {
+        return !failed;
+    }
+    ++sync_waiters;
+    work_cv.notify_one();
+    durable_cv.wait(lock, [&] { return durable_lsn >= lsn || failed || fd < 0; });
+    --sync_waiters;
+    return durable_lsn >= lsn && !failed;
+}
+
+bool WriteAheadLog::commit(uint64_t lsn, Durability durability) {
+    return durability != Durability::Sync || waitDurable(lsn);
+}
+
+bool WriteAheadLog::healthy() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return fd >= 0 && !failed;
+}
+
+uint64_t WriteAheadLog::lastLsn() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return last_lsn;
+}
+
+uint64_t WriteAheadLog::durableLsn() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return durable_lsn;
+}
+
+void WriteAheadLog::flusherLoop() {
+    std::unique_lock<std::mutex> lock(mtx);
+    while (true) {
+        // Буферизованные записи ждут интервал, синхронные будят поток сразу.
+        // Пока идёт fsync, новые записи копятся в pending и уйдут следующей пачкой.
+        work_cv.wait_for(lock, flush_interval, [&] { return stopping || (sync_waiters > 0 && !pending.empty()); });
+        if (pending.empty()) {
+            if (stopping) {
+                break;
+            }
+            continue;
+        }
+
+        spare.swap(pending);
+        uint64_t batch_lsn = last_lsn;
+        writing = true;
+        lock.unlock();
+
+        bool ok = writeAll(fd, spare.data(), spare.size()) && ::fdatasync(fd) == 0;
+        spare.clear();
+
+        lock.lock();
+        writing = false;
+        if (ok) {
+            durable_lsn = batch_lsn;
+        } else if (!failed) {
+            failed = true;
+            console() << "Ошибка: не удалось записать журнал " << path << ".\n";
+        }
+        durable_cv.notify_all();
+    }
+    durable_cv.notify_all();
+}
+
+bool WriteAheadLog::truncateUpTo(uint64_t lsn) {
+    std::unique_lock<std::mutex> lock(mtx);
+    if (fd < 0) {
+        return false;
+    }
+    // Дожидаемся сброса всего, что уже в буфере, и переписываем файл без старых записей
+    ++sync_waiters;
+    work_cv.notify_one();
+    uint64_t target = last_lsn;
+    durable_cv.wait(lock, [&] { return (durable_lsn >= target && !writing) || failed; });
+    --sync_waiters;
+    if (failed) {
+        return false;
+    }
+
+    // База не убывает: усечение по старому снимку не откатывает нумерацию
+    uint64_t base_lsn = 0;
+    std::vector<WalRecord> records = readAll(path, &base_lsn);
+    std::string kept;
+    encodeHeader(kept, std::max(base_lsn, std::min(lsn, last_lsn)));
+    for (const auto& record : records) {
+        if (record.lsn > lsn) {
+            encodeRecord(kept, record);
+        }
+    }
+    std::string tmp_path = path + ".tmp";
+    int tmp = ::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (tmp < 0) {
+        return false;
+    }
+    bool ok = writeAll(tmp, kept.data(), kept.size()) && ::fdatasync(tmp) == 0;
+    ::close(tmp);
+    if (!ok || ::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        return false;
+    }
+    // Новые записи до завершения pending держатся в буфере под mtx, поэтому файл можно подменить
+    ::close(fd);
+    fd = ::open(path.c_str(), O_WRONLY | O_APPEND, 0644);
+    return fd >= 0;
+}
+
+std::vector<WalRecord> WriteAheadLog::readAll(const std::string& wal_path, uint64_t* base_lsn, size_t* valid_bytes) {
+    std::vector<WalRecord> records;
+    if (base_lsn) {
+        *base_lsn = 0;
+    }
+    if (valid_bytes) {
+        *valid_bytes = 0;
+    }
+    std::ifstream in(wal_path, std::ios::binary);
+    if (!in) {
+        return records;
+    }
+    std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    size_t pos = 0;
+    if (data.size() >= kWalHeader && std::memcmp(data.data(), kWalMagic, sizeof(kWalMagic)) == 0) {
+        if (base_lsn) {
+            std::memcpy(base_lsn, data.data() + sizeof(kWalMagic), sizeof(uint64_t));
+        }
+        pos = kWalHeader;
+    }
+    while (data.size() - pos >= kFrameHeader) {
+        uint32_t body_size = 0;
+        uint32_t crc = 0;
+        std::memcpy(&body_size, data.data() + pos, sizeof(body_size));
+        std::memcpy(&crc, data.data() + pos + 4, sizeof(crc));
+        if (data.size() - pos - kFrameHeader < body_size) {
+            break; // оборванная запись в конце файла
+        }
+        const char* p = data.data() + pos + kFrameHeader;
+        const char* end = p + body_size;
+        if (crc32(p, body_size) != crc) {
+            break;
+        }
+
+        WalRecord r;
+        uint8_t type = 0;
+        if (!get(p, end, r.lsn) || !get(p, end, type) || !get(p, end, r.quantity) || !get(p, end, r.weight) ||
+            !getString(p, end, r.warehouse) || !getString(p, end, r.product) || !getString(p, end, r.packaging)) {
+            break;
+        }
+        r.type = static_cast<WalRecordType>(type);
+        records.push_back(std::move(r));
+        pos += kFrameHeader + body_size;
+    }
+    if (valid_bytes) {
+        *valid_bytes = pos;
+    }
+    return records;
+}
+
+bool writeSnapshot(const std::string& path, const std::vector<Warehouse*>& warehouses, uint64_t* covered_lsn) {
+    std::string out(kSnapshotMagic, sizeof(kSnapshotMagic));
+    put<uint32_t>(out, static_cast<uint32_t>(warehouses.size()));
+    uint64_t covered = warehouses.empty() ? 0 : UINT64_MAX;
+    for (auto* warehouse : warehouses) {
+        WarehouseCheckpoint cp = warehouse->checkpoint();
+        covered = std::min(covered, cp.lsn);
+        putString(out, warehouse->getName());
+        put<uint64_t>(out, cp.lsn);
+        put<uint32_t>(out, static_cast<uint32_t>(cp.products.size()));
+        for (const auto& product : cp.products) {
+            putString(out, product.name);
+            put<double>(out, product.weight);
+            putString(out, product.packaging);
+            put<uint64_t>(out, product.quantity);
+        }
+    }
+    put<uint32_t>(out, crc32(out.data(), out.size()));
+
+    // Пишем во временный файл и атомарно подменяем старый снимок
+    std::string tmp_path = path + ".tmp";
+    int fd = ::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        console() << "Ошибка: не удалось создать снимок " << path << ".\n";
+        return false;
+    }
+    bool ok = writeAll(fd, out.data(), out.size()) && ::fsync(fd) == 0;
+    ::close(fd);
+    if (!ok || ::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        console() << "Ошибка: не удалось записать снимок " << path << ".\n";
+        return false;
+    }
+    if (covered_lsn) {
+        *covered_lsn = covered;
+    }
+    return true;
+}
+
+uint64_t recoverWarehouses(const std::string& snapshot_path, const std::string& wal_path,
+                           const std::vector<Warehouse*>& warehouses) {
+    std::unordered_map<std::string, Warehouse*> by_name;
+    std::unordered_map<std::string, uint64_t> snapshot_lsn;
+    for (auto* warehouse : warehouses) {
+        by_name[warehouse->getName()] = warehouse;
+    }
+
+    std::ifstream in(snapshot_path, std::ios::binary);
+    if (in) {
+        std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        bool valid = data.size() >= sizeof(kSnapshotMagic) + 8 &&
+                     std::memcmp(data.data(), kSnapshotMagic, sizeof(kSnapshotMagic)) == 0;
+        if (valid) {
+            uint32_t crc = 0;
+            std::memcpy(&crc, data.data() + data.size() - 4, sizeof(crc));
+            valid = crc32(data.data(), data.size() - 4) == crc;
+        }
+        if (!valid) {
+            console() << "Предупреждение: снимок " << snapshot_path << " повреждён и пропущен.\n";
+        } else {
+            const char* p = data.data() + sizeof(kSnapshotMagic);
+            const char* end = data.data() + data.size() - 4;
+            uint32_t warehouse_count = 0;
+            get(p, end, warehouse_count);
+            for (uint32_t i = 0; i < warehouse_count; ++i) {
+                std::string name;
+                uint64_t lsn = 0;
+                uint32_t product_count = 0;
+                getString(p, end, name);
+                get(p, end, lsn);
+                get(p, end, product_count);
+                auto it = by_name.find(name);
+                for (uint32_t j = 0; j < product_count; ++j) {
+                    Product product;
+                    getString(p, end, product.name);
+                    get(p, end, product.weight);
+                    getString(p, end, product.packaging);
+                    uint64_t quantity = 0;
+                    get(p, end, quantity);
+                    product.quantity = quantity;
+                    if (it != by_name.end()) {
+                        it->second->replayStore(product);
+                    }
+                }
+                snapshot_lsn[name] = lsn;
+            }
+        }
+    }
+
+    uint64_t applied = 0;
+    for (const auto& record : WriteAheadLog::readAll(wal_path)) {
+        auto it = by_name.find(record.warehouse);
+        if (it == by_name.end() || record.lsn <= snapshot_lsn[record.warehouse]) {
+            continue; // склад неизвестен или запись уже учтена в снимке
+        }
+        if (record.type == WalRecordType::Store) {
+            it->second->replayStore(Product(record.product, record.weight, record.packaging, record.quantity));
+        } else {
+            it->second->replayUnload(record.product, record.quantity);
+        }
+        applied = record.lsn;
+    }
+    return applied;
+}
@@ -0,0 +1,107 @@
+#ifndef WAL_H
+#define WAL_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class Product;
+class Warehouse;
+
+// Уровень надёжности для одной операции с инвентарём
+enum class Durability : uint8_t {
+    None,     // операция не журналируется
+    Buffered, // запись попадёт на диск при ближайшем групповом сбросе, вызывающий не ждёт
+    Sync      // вызывающий ждёт fsync своей записи (групповой коммит)
+};
+
+enum class WalRecordType : uint8_t {
+    Store = 1,  // поступление продукции на склад
+    Unload = 2  // отгрузка продукции со склада
+};
+
+struct WalRecord {
+    uint64_t lsn = 0;
+    WalRecordType type = WalRecordType::Store;
+    std::string warehouse;
+    std::string product;
+    double weight = 0;
+    std::string packaging;
+    uint64_t quantity = 0;
+};
+
+// Журнал предзаписи (write-ahead log) для изменений инвентаря.
+// Записи копятся в общем буфере, фоновый поток сбрасывает их на диск одним
+// write + fdatasync, поэтому много параллельных писателей платят за один fsync.
+class WriteAheadLog {
+public:
+    explicit WriteAheadLog(std::chrono::microseconds flush_interval = std::chrono::milliseconds(2));
+    ~WriteAheadLog();
+
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+
+    // Добавляет запись в буфер и возвращает её LSN. Не ждёт диска.
+    uint64_t append(WalRecordType type, const std::string& warehouse, const Product& product);
+    uint64_t append(WalRecordType type, const std::string& warehouse, const std::string& product_name, uint64_t quantity);
+    // Ждёт, пока запись с указанным LSN станет надёжной (Durability::Sync).
+    bool waitDurable(uint64_t lsn);
+    // false - Durability::Sync и запись не стала надёжной (сбой записи или fdatasync)
+    bool commit(uint64_t lsn, Durability durability);
+    // Журнал открыт и не было сбоя записи: после сбоя Sync-операции не подтверждаются
+    bool healthy() const;
+
+    uint64_t lastLsn() const;
+    uint64_t durableLsn() const;
+    // Удаляет из файла записи с LSN <= lsn (после снимка). Удалённый LSN
+    // остаётся базой в заголовке, и после перезапуска нумерация идёт дальше.
+    bool truncateUpTo(uint64_t lsn);
+
+    // Читает все целые записи журнала; оборванный хвост отбрасывается.
+    // base_lsn - база из заголовка (0, если заголовка нет), valid_bytes - длина файла
+    // до конца последней целой записи: open() обрезает по ней хвост перед дозаписью.
+    static std::vector<WalRecord> readAll(const std::string& path, uint64_t* base_lsn = nullptr,
+                                          size_t* valid_bytes = nullptr);
+
+private:
+    void flusherLoop();
+    uint64_t appendLocked(WalRecordType type, const std::string& warehouse, const std::string& product_name,
+                          double weight, const std::string& packaging, uint64_t quantity);
+
+    std::string path;
+    int fd = -1;
+    std::chrono::microseconds flush_interval;
+
+    mutable std::mutex mtx;
+    std::condition_variable work_cv;
+    std::condition_variable durable_cv;
+    std::string pending;       // записи, ещё не отданные на диск
+    std::string spare;         // второй буфер, чтобы не перевыделять память
+    uint64_t last_lsn = 0;
+    uint64_t durable_lsn = 0;
+    size_t sync_waiters = 0;
+    bool writing = false;      // фоновый поток пишет пачку без удержания mtx
+    bool stopping = false;
+    bool failed = false;
+    std::thread flusher;
+};
+
+// Снимок инвентаря складов. Для каждого склада хранится LSN последней
+// учтённой записи журнала, поэтому снимок можно делать без остановки записи.
+// covered_lsn, если задан, получает наименьший из этих LSN: до него журнал
+// можно усечь (truncateUpTo), не потеряв записей ни одного склада.
+bool writeSnapshot(const std::string& path, const std::vector<Warehouse*>& warehouses, uint64_t* covered_lsn = nullptr);
+
+// Восстанавливает склады: загружает снимок и проигрывает поверх него журнал.
+// Вызывать до attachJournal. Возвращает LSN последней применённой записи.
+uint64_t recoverWarehouses(const std::string& snapshot_path, const std::string& wal_path,
+                           const std::vector<Warehouse*>& warehouses);
+
+#endif // WAL_H
@@ -0,0 +1,180 @@
+#include "workload.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+uint64_t rotl(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+uint64_t splitmix(uint64_t& x) {
+    uint64_t z = (x += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+} // namespace
+
+WorkloadGenerator::WorkloadGenerator(const WorkloadConfig& config) : config(config) {
+    uint64_t seed = config.seed;
+    for (auto& word : state) {
+        word = splitmix(seed);
+    }
+    this->config.products = std::max<size_t>(1, config.products);
+    this->config.shops = std::max<size_t>(1, config.shops);
+    this->config.max_lines = std::clamp(config.max_lines, 1u, GeneratedOrder::kMaxLines);
+    this->config.min_lines = std::clamp(config.min_lines, 1u, this->config.max_lines);
+
+    size_t n = this->config.products;
+    for (size_t i = 0; i < n; ++i) {
+        product_names.push_back("Продукт " + std::to_string(i + 1));
+    }
+    for (size_t i = 0; i < this->config.shops; ++i) {
+        shop_names.push_back("Магазин " + std::to_string(i + 1));
+    }
+
+    // Таблица псевдонимов Уокера-Воуза для распределения Ципфа
+    std::vector<double> weights(n);
+    double total = 0;
+    for (size_t i = 0; i < n; ++i) {
+        weights[i] = 1.0 / std::pow(static_cast<double>(i + 1), config.zipf_exponent);
+        total += weights[i];
+    }
+    alias_prob.assign(n, 0);
+    alias_index.assign(n, 0);
+    std::vector<uint32_t> small;
+    std::vector<uint32_t> large;
+    std::vector<double> scaled(n);
+    for (size_t i = 0; i < n; ++i) {
+        scaled[i] = weights[i] * static_cast<double>(n) / total;
+        (scaled[i] < 1.0 ? small : large).push_back(static_cast<uint32_t>(i));
+    }
+    while (!small.empty() && !large.empty()) {
+        uint32_t s = small.back();
+        small.pop_back();
+        uint32_t l = large.back();
+        alias_prob[s] = scaled[s];
+        alias_index[s] = l;
+        scaled[l] -= 1.0 - scaled[s];
+        if (scaled[l] < 1.0) {
+            large.pop_back();
+            small.push_back(l);
+        }
+    }
+    for (uint32_t i : large) {
+        alias_prob[i] = 1.0;
+    }
+    for (uint32_t i : small) {
+        alias_prob[i] = 1.0;
+    }
+
+    regime_end = exponential(config.mean_calm_seconds);
+    for (uint32_t f = 0; f < config.factories; ++f) {
+        production_queue.emplace(uniform() * config.production_period_seconds, f);
+    }
+}
+
+uint64_t WorkloadGenerator::nextRandom() {
+    uint64_t result = rotl(state[1] * 5, 7) * 9;
+    uint64_t t = state[1] << 17;
+    state[2] ^= state[0];
+    state[3] ^= state[1];
+    state[1] ^= state[2];
+    state[0] ^= state[3];
+    state[2] ^= t;
+    state[3] = rotl(state[3], 45);
+    return result;
+}
+
+double WorkloadGenerator::uniform() {
+    return static_cast<double>(nextRandom() >> 11) * 0x1.0p-53;
+}
+
+uint32_t WorkloadGenerator::uniformInt(uint32_t lo, uint32_t hi) {
+    // Умножение вместо деления по модулю: смещение пренебрежимо для таких диапазонов
+    uint64_t span = static_cast<uint64_t>(hi - lo) + 1;
+    return lo + static_cast<uint32_t>(((nextRandom() >> 32) * span) >> 32);
+}
+
+double WorkloadGenerator::exponential(double mean) {
+    return -std::log1p(-uniform()) * mean;
+}
+
+uint32_t WorkloadGenerator::sampleProduct() {
+    uint32_t column = uniformInt(0, static_cast<uint32_t>(alias_prob.size() - 1));
+    return uniform() < alias_prob[column] ? column : alias_index[column];
+}
+
+GeneratedOrder WorkloadGenerator::nextOrder() {
+    GeneratedOrder order;
+    // Интервал до следующего заказа зависит от режима; смена режима по экспоненциальному таймеру
+    while (true) {
+        double rate = config.orders_per_second * (bursting ? config.burst_multiplier : 1.0);
+        double candidate = order_clock + exponential(1.0 / rate);
+        if (candidate <= regime_end) {
+            order_clock = candidate;
+            break;
+        }
+        order_clock = regime_end;
+        bursting = !bursting;
+        regime_end += exponential(bursting ? config.mean_burst_seconds : config.mean_calm_seconds);
+    }
+
+    order.time = order_clock;
+    order.shop = uniformInt(0, static_cast<uint32_t>(config.shops - 1));
+    order.line_count = uniformInt(config.min_lines, config.max_lines);
+    for (uint32_t i = 0; i < order.line_count; ++i) {
+        order.lines[i].product = sampleProduct();
+        order.lines[i].quantity = uniformInt(config.min_units, config.max_units);
+    }
+    return order;
+}
+
+ProductionRun WorkloadGenerator::nextProduction() {
+    ProductionRun run;
+    if (production_queue.empty()) {
+        return run;
+    }
+    auto [time, factory] = production_queue.top();
+    production_queue.pop();
+    run.time = time;
+    run.factory = factory;
+    run.product = factory % static_cast<uint32_t>(config.products);
+    run.quantity = uniformInt(config.min_batch, config.max_batch);
+    // Небольшой разброс периода, чтобы фабрики не выпускали партии синхронно
+    production_queue.emplace(time + config.production_period_seconds * (0.8 + 0.4 * uniform()), factory);
+    return run;
+}
+
+WorkloadEvent WorkloadGenerator::nextEvent() {
+    if (!has_order) {
+        pending_order = nextOrder();
+        has_order = true;
+    }
+    if (!has_production && !production_queue.empty()) {
+        pending_production = nextProduction();
+        has_production = true;
+    }
+
+    WorkloadEvent event;
+    if (has_production && pending_production.time < pending_order.time) {
+        event.is_order = false;
+        event.production = pending_production;
+        has_production = false;
+    } else {
+        event.order = pending_order;
+        has_order = false;
+    }
+    return event;
+}
+
+std::map<std::string, size_t> WorkloadGenerator::toRequest(const GeneratedOrder& order) const {
+    std::map<std::string, size_t> request;
+    for (uint32_t i = 0; i < order.line_count; ++i) {
+        request[product_names[order.lines[i].product]] += order.lines[i].quantity;
+    }
+    return request;
+}
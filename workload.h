@@ -0,0 +1,103 @@
+#ifndef WORKLOAD_H
+#define WORKLOAD_H
+
+#include <cstdint>
+#include <map>
+#include <queue>
+#include <string>
+#include <vector>
+
+struct WorkloadConfig {
+    uint64_t seed = 1;
+    size_t products = 100;
+    double zipf_exponent = 1.1;        // перекос популярности продуктов
+    size_t shops = 50;
+
+    double orders_per_second = 1000;   // интенсивность в обычном режиме
+    double burst_multiplier = 8;       // во сколько раз чаще заказы во время всплеска
+    double mean_calm_seconds = 60;     // средняя длительность спокойного периода
+    double mean_burst_seconds = 5;     // средняя длительность всплеска
+
+    uint32_t min_lines = 1;
+    uint32_t max_lines = 4;
+    uint32_t min_units = 1;
+    uint32_t max_units = 20;
+
+    size_t factories = 20;             // фабрика i выпускает i-й по популярности продукт
+    double production_period_seconds = 1;
+    uint32_t min_batch = 500;
+    uint32_t max_batch = 2000;
+};
+
+struct OrderLine {
+    uint32_t product;
+    uint32_t quantity;
+};
+
+// Заказ фиксированного размера, генерация не выделяет память
+struct GeneratedOrder {
+    static constexpr uint32_t kMaxLines = 8;
+    double time = 0;
+    uint32_t shop = 0;
+    uint32_t line_count = 0;
+    OrderLine lines[kMaxLines];
+};
+
+struct ProductionRun {
+    double time = 0;
+    uint32_t factory = 0;
+    uint32_t product = 0;
+    uint32_t quantity = 0;
+};
+
+struct WorkloadEvent {
+    bool is_order = true;
+    GeneratedOrder order;
+    ProductionRun production;
+};
+
+// Воспроизводимый генератор нагрузки: популярность продуктов по закону Ципфа
+// (выбор за O(1) по таблице псевдонимов), всплески заказов (поток Пуассона
+// с переключением спокойного режима и всплеска), партии производства фабрик.
+class WorkloadGenerator {
+public:
+    explicit WorkloadGenerator(const WorkloadConfig& config);
+
+    GeneratedOrder nextOrder();
+    ProductionRun nextProduction();
+    // Заказы и производство вместе в порядке времени
+    WorkloadEvent nextEvent();
+
+    const std::string& productName(uint32_t product) const { return product_names[product]; }
+    const std::string& shopName(uint32_t shop) const { return shop_names[shop]; }
+    // Заказ в формате Truck::deliver
+    std::map<std::string, size_t> toRequest(const GeneratedOrder& order) const;
+    const WorkloadConfig& getConfig() const { return config; }
+
+private:
+    uint64_t nextRandom();
+    double uniform();
+    uint32_t uniformInt(uint32_t lo, uint32_t hi);
+    double exponential(double mean);
+    uint32_t sampleProduct();
+
+    WorkloadConfig config;
+    uint64_t state[4];                  // xoshiro256**
+    std::vector<double> alias_prob;
+    std::vector<uint32_t> alias_index;
+    std::vector<std::string> product_names;
+    std::vector<std::string> shop_names;
+
+    double order_clock = 0;
+    bool bursting = false;
+    double regime_end = 0;
+
+    using Scheduled = std::pair<double, uint32_t>; // время следующей партии, фабрика
+    std::priority_queue<Scheduled, std::vector<Scheduled>, std::greater<>> production_queue;
+    bool has_order = false;
+    bool has_production = false;
+    GeneratedOrder pending_order;
+    ProductionRun pending_production;
+};
+
+#endif // WORKLOAD_H